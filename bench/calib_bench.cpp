@@ -0,0 +1,76 @@
+// Host benchmark: integer calibration kernels from pm_calib.h against the
+// float conversion block loop() used before them. Reports the worst error in
+// milli-units over every 10-bit reading and the time per conversion.
+//
+//   g++ -O2 -Isrc bench/calib_bench.cpp -o calib_bench && ./calib_bench
+//
+// Host timings only show the relative cost, AVR cycle counts come from the
+// simavr runs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "pm_calib.h"
+
+static const int benchRounds = 2000;    // passes over the full 0..1023 range
+
+// the float block from loop(), kept verbatim apart from returning milli-units
+static int32_t floatCurrent(long rawAdc) {
+  float acsmvA = 0.136;
+  float sysVcc = CAL_VCC_MV / 1000.0;
+  float Volts  = (float)(rawAdc * (sysVcc / 1024.0)) - (sysVcc / 2);
+  float Amps   = (float)Volts / acsmvA;
+  return (int32_t) (Amps * 1000.0);
+}
+
+static int32_t floatVoltage(long rawAdc, float vDiv) {
+  float sysVcc = CAL_VCC_MV / 1000.0;
+  float Volts  = (float)(rawAdc * (sysVcc / 1024.0)) / vDiv;
+  return (int32_t) (Volts * 1000.0);
+}
+
+// exact reference in double, rounded to the nearest milli-unit
+static double exactMilli(uint8_t ch, long raw) {
+  double mvPerLsb = CAL_VCC_MV / 1024.0;
+  if (ch == 0) return (raw - CAL_ZERO_LSB) * mvPerLsb / (CAL_SENSE_UV_PER_A / 1000000.0);
+  double ppm = (ch == 1) ? CAL_VDIV_BUS_PPM : CAL_VDIV_PACK_PPM;
+  return raw * mvPerLsb / (ppm / 1000000.0);
+}
+
+template <typename F>
+static double nsPerOp(F fn) {
+  volatile int32_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < benchRounds; round++) {
+    for (long raw = 0; raw < 1024; raw++) sink = sink + fn(raw);
+  }
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(stop - start).count() / (benchRounds * 1024.0);
+}
+
+int main() {
+  const char *names[calChannels] = { "current", "bus", "pack" };
+  const float vDiv[calChannels]  = { 0, CAL_VDIV_BUS_PPM / 1000000.0f, CAL_VDIV_PACK_PPM / 1000000.0f };
+
+  printf("[\n");
+  for (uint8_t ch = 0; ch < calChannels; ch++) {
+    double floatErr = 0, intErr = 0;
+    for (long raw = 0; raw < 1024; raw++) {
+      double exact  = exactMilli(ch, raw);
+      double viaFlt = (ch == 0) ? floatCurrent(raw) : floatVoltage(raw, vDiv[ch]);
+      double viaInt = calApply(calDefaults[ch], (uint16_t) raw);
+      if (abs(viaFlt - exact) > floatErr) floatErr = abs(viaFlt - exact);
+      if (abs(viaInt - exact) > intErr)   intErr   = abs(viaInt - exact);
+    }
+
+    double fltNs = (ch == 0) ? nsPerOp([](long raw) { return floatCurrent(raw); })
+                             : nsPerOp([&](long raw) { return floatVoltage(raw, vDiv[ch]); });
+    double intNs = nsPerOp([&](long raw) { return calApply(calDefaults[ch], (uint16_t) raw); });
+
+    printf("  {\"channel\": \"%s\", \"gain_q16\": %ld, \"float_max_err_milli\": %.3f, \"int_max_err_milli\": %.3f, "
+           "\"float_ns\": %.2f, \"int_ns\": %.2f}%s\n",
+           names[ch], (long) calDefaults[ch].gainQ16, floatErr, intErr, fltNs, intNs, (ch + 1 < calChannels) ? "," : "");
+  }
+  printf("]\n");
+  return 0;
+}
@@ -0,0 +1,162 @@
+// Host benchmark: the delta codec from pm_codec.h on pack traces, packed into
+// blocks the way the FRAM log packs them. Checks that every trace decodes back
+// to the exact samples and reports the log bytes per sample against fixed
+// width records, plus the encode and decode time per sample.
+//
+//   g++ -O2 -Isrc bench/codec_bench.cpp src/pm_codec.cpp -o codec_bench && ./codec_bench [trace.csv ...]
+//
+// A trace is one sample per line: current mA, pack mV, temperature mdegC,
+// separated by commas, lines that do not start with a number are skipped.
+// Without arguments three synthetic traces are used: a resting pack, a steady
+// discharge and charge/discharge steps, all with sensor noise.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+#include "pm_codec.h"
+
+static const uint8_t benchFields  = 3;          // current, pack voltage, temperature
+static const uint8_t benchPayload = 44;         // LOG_BLOCK payload, see pm_logblock.h
+static const uint8_t benchBlock   = 64;         // log block on FRAM and on the wire
+static const int     benchRounds  = 50;         // timing passes over each trace
+
+struct BENCH_SAMPLE {
+  int32_t value[benchFields];
+};
+
+struct BENCH_BLOCK {
+  int32_t key[benchFields];                     // keyframe, the log keeps it in the block header
+  uint8_t used;
+  uint8_t payload[benchPayload];
+};
+
+// quantised like the log keyframe: 10 mA, 10 mV, 0.1 degC
+static BENCH_SAMPLE quantise(long ma, long mv, long mdeg) {
+  BENCH_SAMPLE sample = { { (int32_t) (ma / 10), (int32_t) (mv / 10), (int32_t) (mdeg / 100) } };
+  return sample;
+}
+
+static bool loadTrace(const char *path, std::vector<BENCH_SAMPLE> &trace) {
+  FILE *file = fopen(path, "r");
+  if (!file) return false;
+  char line[128];
+  while (fgets(line, sizeof(line), file)) {
+    long ma, mv, mdeg;
+    if (sscanf(line, "%ld ,%ld ,%ld", &ma, &mv, &mdeg) == 3) trace.push_back(quantise(ma, mv, mdeg));
+  }
+  fclose(file);
+  return !trace.empty();
+}
+
+static uint32_t benchRandom = 12345;
+static long noise(long span) {                  // uniform in -span..span, fixed seed
+  benchRandom = benchRandom * 1103515245 + 12345;
+  return (long) ((benchRandom >> 16) % (2 * span + 1)) - span;
+}
+
+static void synthTrace(int kind, std::vector<BENCH_SAMPLE> &trace) {
+  long mv = 13300, mdeg = 25000;
+  for (int n = 0; n < 20000; n++) {
+    long ma = 0;
+    if (kind == 1) {
+      ma   = -2000;
+      mv   = 13300 - n / 40;
+      mdeg = 25000 + n / 2;
+    } else if (kind == 2) {
+      ma   = ((n / 500) % 2) ? 3000 : -5000;
+      mv   = 13200 + ma / 50;
+      mdeg = 25000 + ((n / 500) % 2) * 2000;
+    }
+    trace.push_back(quantise(ma + noise(kind ? 30 : 5), mv + noise(kind ? 15 : 5), mdeg + noise(50)));
+  }
+}
+
+static void encode(const std::vector<BENCH_SAMPLE> &trace, std::vector<BENCH_BLOCK> &blocks) {
+  CODEC_STREAM stream;
+  blocks.clear();
+  for (const BENCH_SAMPLE &sample : trace) {
+    if (!blocks.empty() && codecAppend(stream, blocks.back().payload, blocks.back().used, benchPayload, sample.value)) continue;
+    BENCH_BLOCK block = { };
+    for (uint8_t field = 0; field < benchFields; field++) block.key[field] = sample.value[field];
+    blocks.push_back(block);
+    codecKey(stream, sample.value, benchFields);
+  }
+}
+
+static bool decode(const std::vector<BENCH_BLOCK> &blocks, std::vector<BENCH_SAMPLE> &out) {
+  CODEC_STREAM stream;
+  out.clear();
+  for (const BENCH_BLOCK &block : blocks) {
+    codecKey(stream, block.key, benchFields);
+    BENCH_SAMPLE sample;
+    for (uint8_t field = 0; field < benchFields; field++) sample.value[field] = block.key[field];
+    out.push_back(sample);
+    for (uint8_t pos = 0; pos < block.used; ) {
+      uint8_t samples;
+      uint8_t read = codecNext(stream, &block.payload[pos], block.used - pos, samples);
+      if (!read) return false;
+      pos += read;
+      for (uint8_t field = 0; field < benchFields; field++) sample.value[field] = stream.last[field];
+      while (samples--) out.push_back(sample);
+    }
+  }
+  return true;
+}
+
+static bool sameTrace(const std::vector<BENCH_SAMPLE> &a, const std::vector<BENCH_SAMPLE> &b) {
+  if (a.size() != b.size()) return false;
+  for (size_t n = 0; n < a.size(); n++) {
+    for (uint8_t field = 0; field < benchFields; field++) {
+      if (a[n].value[field] != b[n].value[field]) return false;
+    }
+  }
+  return true;
+}
+
+template <typename F>
+static double nsPerSample(size_t samples, F fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < benchRounds; round++) fn();
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(stop - start).count() / ((double) benchRounds * samples);
+}
+
+static void report(const char *name, const std::vector<BENCH_SAMPLE> &trace, bool last) {
+  std::vector<BENCH_BLOCK>  blocks;
+  std::vector<BENCH_SAMPLE> decoded;
+  encode(trace, blocks);
+  bool ok = decode(blocks, decoded) && sameTrace(trace, decoded);
+
+  double encNs = nsPerSample(trace.size(), [&]() { encode(trace, blocks); });
+  double decNs = nsPerSample(trace.size(), [&]() { decode(blocks, decoded); });
+
+  double perSample = (double) blocks.size() * benchBlock / trace.size();
+  printf("  {\"trace\": \"%s\", \"samples\": %lu, \"blocks\": %lu, \"roundtrip\": %s, \"bytes_per_sample\": %.3f, "
+         "\"ratio_vs_int16\": %.2f, \"ratio_vs_binary_regs\": %.2f, \"encode_ns\": %.1f, \"decode_ns\": %.1f}%s\n",
+         name, (unsigned long) trace.size(), (unsigned long) blocks.size(), ok ? "true" : "false", perSample,
+         6.0 / perSample, 12.0 / perSample, encNs, decNs, last ? "" : ",");
+}
+
+int main(int argc, char **argv) {
+  printf("[\n");
+  if (argc > 1) {
+    for (int arg = 1; arg < argc; arg++) {
+      std::vector<BENCH_SAMPLE> trace;
+      if (!loadTrace(argv[arg], trace)) {
+        fprintf(stderr, "%s: no samples\n", argv[arg]);
+        return 1;
+      }
+      report(argv[arg], trace, arg + 1 == argc);
+    }
+  } else {
+    const char *names[] = { "synthetic-rest", "synthetic-discharge", "synthetic-steps" };
+    for (int kind = 0; kind < 3; kind++) {
+      std::vector<BENCH_SAMPLE> trace;
+      synthTrace(kind, trace);
+      report(names[kind], trace, kind == 2);
+    }
+  }
+  printf("]\n");
+  return 0;
+}
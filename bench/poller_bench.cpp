@@ -0,0 +1,115 @@
+// Host benchmark: one refresh of a simulated rack with the multi-pack poller
+// from host/pm_poller.h against the per-value reads of the old host helpers
+// (src/pm_i2croutines.c~~), which switch the mux for every pack and read each
+// value as its own ASCII transaction. Reports transactions, mux writes and
+// bus time per refresh, and checks the telemetry table against the packs.
+//
+//   g++ -O2 -Isrc -Ihost bench/poller_bench.cpp host/pm_*.cpp src/pm_codec.cpp -o poller_bench && ./poller_bench
+//
+// Bus time is the wire time at the bus clock, host and driver latency per
+// transaction comes on top and favours the batched reads even more.
+
+#include <stdio.h>
+#include <vector>
+#include "pm_poller.h"
+#include "pm_host_sim.h"
+
+static const uint8_t benchMuxes    = 2;
+static const uint8_t benchChannels = 4;
+static const uint8_t benchAddrs[]  = { 0x37, 0x39 };   // two packs per mux channel, reused on every channel
+
+// values a controller refreshes per pack: the snapshot fields, then state of charge, remaining and time to empty
+static const uint8_t benchAscii[][2] = {   // register, ascii reply bytes
+  { 0x33, 11 }, { 0x39, 11 }, { 0x3E, 11 }, { 0x41, 6 }, { 0x44, 6 }, { 0x4E, 6 },
+  { 0x31, 6 },  { 0x2C, 1 },  { 0x2D, 1 },  { 0x7B, 11 }, { 0x7C, 11 }, { 0x7D, 6 },
+};
+static const POLL_REGISTER benchExtra[] = { { 0x7B, 4, false }, { 0x7C, 4, false }, { 0x7D, 2, false } };
+
+struct BENCH_RACK {
+  std::vector<HostSimPack *> packs;
+  std::vector<POLL_TARGET>   targets;
+};
+
+static void buildRack(HostSimBus &bus, BENCH_RACK &rack) {
+  for (uint8_t m = 0; m < benchMuxes; m++) {
+    for (uint8_t ch = 0; ch < benchChannels; ch++) {
+      for (uint8_t addr : benchAddrs) {
+        HostSimPack *pack = new HostSimPack(addr);
+        int32_t      n    = (int32_t) rack.packs.size();
+        pack->frame.current     = -1000 * n;
+        pack->frame.packVoltage = 13000 + n;
+        pack->set(0x7B, 4, 50000 + n);
+        pack->set(0x7C, 4, 4000 + n);
+        pack->set(0x7D, 2, 120 + n);
+        for (auto &reg : benchAscii) {
+          if (reg[0] < 0x7B) pack->set(reg[0], 4, n);
+        }
+        bus.attach(pack, pollMuxFirst + m, ch);
+        rack.packs.push_back(pack);
+        rack.targets.push_back({ addr, (uint8_t) (pollMuxFirst + m), ch });
+      }
+    }
+  }
+}
+
+// the old helpers: mux switch per pack, one write and repeated start read per value
+static void refreshPerValue(HostSimBus &bus, const BENCH_RACK &rack) {
+  for (const POLL_TARGET &t : rack.targets) {
+    uint8_t off = 0, on = (uint8_t) (1 << t.channel);
+    for (uint8_t m = 0; m < benchMuxes; m++) {
+      HOST_I2C_MSG msg = { (uint8_t) (pollMuxFirst + m), 0, 1, (pollMuxFirst + m == t.mux) ? &on : &off };
+      bus.transfer(&msg, 1);
+    }
+    for (auto &reg : benchAscii) {
+      uint8_t      cmd = reg[0];
+      uint8_t      reply[16];
+      HOST_I2C_MSG msgs[2] = { { t.addr, 0, 1, &cmd }, { t.addr, hostMsgRead, reg[1], reply } };
+      bus.transfer(msgs, 2);
+    }
+  }
+}
+
+static void report(const char *name, const HostSimBus &bus, uint32_t refreshes, uint8_t packs, bool last) {
+  printf("  {\"method\": \"%s\", \"packs\": %u, \"transfers\": %.1f, \"mux_writes\": %.1f, \"bus_ms_100k\": %.2f, \"bus_ms_400k\": %.2f}%s\n",
+         name, packs, (double) bus.transfers / refreshes, (double) bus.muxWrites / refreshes,
+         bus.busUs / 1000.0 / refreshes, bus.busUs / 4000.0 / refreshes, last ? "" : ",");
+}
+
+int main() {
+  const uint32_t refreshes = 100;
+
+  HostSimBus naiveBus;
+  BENCH_RACK naiveRack;
+  buildRack(naiveBus, naiveRack);
+  for (uint32_t r = 0; r < refreshes; r++) refreshPerValue(naiveBus, naiveRack);
+
+  HostSimBus pollBus;
+  BENCH_RACK pollRack;
+  buildRack(pollBus, pollRack);
+  PackPoller poller(pollBus);
+  for (const POLL_TARGET &t : pollRack.targets) poller.addPack(t.addr, t.mux, t.channel);
+  for (const POLL_REGISTER &reg : benchExtra) poller.addRegister(reg.reg, reg.width, reg.isSigned);
+  uint32_t good = 0;
+  for (uint32_t r = 0; r < refreshes; r++) good += poller.refresh();
+
+  bool match = good == refreshes * pollRack.packs.size();
+  for (uint8_t x = 0; x < poller.packCount(); x++) {
+    const PACK_TELEMETRY &entry = poller.pack(x);
+    const HostSimPack    *pack  = pollRack.packs[x];
+    match = match && entry.valid && entry.snapshot.current == pack->frame.current
+            && entry.snapshot.packVoltage == pack->frame.packVoltage && entry.extra[0] == 50000 + x
+            && entry.extra[1] == 4000 + x && entry.extra[2] == 120 + x;
+  }
+
+  // a pulled pack costs its own entry only
+  pollRack.packs[5]->present = false;
+  uint8_t withMissing = poller.refresh();
+  bool isolated = withMissing == pollRack.packs.size() - 1 && poller.pack(5).errors == 1;
+
+  printf("[\n");
+  report("per_value_ascii", naiveBus, refreshes, naiveRack.packs.size(), false);
+  report("poller_batched", pollBus, refreshes, pollRack.packs.size(), false);
+  printf("  {\"table_matches\": %s, \"missing_pack_isolated\": %s}\n", match ? "true" : "false", isolated ? "true" : "false");
+  printf("]\n");
+  return 0;
+}
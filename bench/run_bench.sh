@@ -0,0 +1,25 @@
+#!/bin/sh
+# Hot path benchmarks from src/pm_bench.h, prints one JSON object keyed by target.
+#
+#   bench/run_bench.sh
+#
+# Needs platformio, and simavr on the PATH for the atmega328p run. simavr has
+# no megaAVR core, for the 4809 flash env:bench_4809, open the monitor at
+# 921600 and reset the board; the same JSON is printed between BENCH-BEGIN and
+# BENCH-END.
+
+set -e
+cd "$(dirname "$0")/.."
+
+# the document between the markers, simavr colours its uart lines
+extract() {
+  sed -e 's/\x1b\[[0-9;]*m//g' -e 's/\r$//' | sed -n '/^BENCH-BEGIN/,/^BENCH-END/p' | sed -e '1d' -e '$d'
+}
+
+pio run -s -e bench_native
+native=$(.pio/build/bench_native/program 2>/dev/null | extract)
+
+pio run -s -e bench_328p
+avr=$(timeout 300 simavr -m atmega328p -f 16000000 .pio/build/bench_328p/firmware.elf 2>&1 | extract)
+
+printf '{\n"native": %s,\n"atmega328p": %s\n}\n' "${native:-null}" "${avr:-null}"
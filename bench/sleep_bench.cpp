@@ -0,0 +1,221 @@
+// Host benchmark: the firmware on the native HAL through a minute of load
+// steps with a host polling it at random moments, once kept at idle sleep
+// (config2 bit 1) and once sleeping through to the next release. The host acts
+// from inside simulated time, so its transactions land while the firmware
+// sleeps and have to wake it. Checks that both runs take the same samples,
+// count the same charge, close to the load integrated analytically, and lose
+// no host transaction, then reports wakeups per second and register 0x1F.
+//
+//   g++ -O2 -std=gnu++11 -DPM_NATIVE -DI2C_SLAVE_ADDR=0x37 -Isrc/native -Isrc
+//       bench/sleep_bench.cpp $(ls src/*.cpp) src/native/pm_native_hal.cpp -o sleep_bench && ./sleep_bench
+//
+// Simulated time does not advance while the firmware runs, so the native duty
+// cycle only shows how much of the time the sleep ends early, not what the
+// code costs on a part.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Arduino.h"
+#include "pm_pins.h"
+#include "pm_native_hal.h"
+#include "pm_native_devices.h"
+#include "pm_adc.h"
+#include "pm_calib.h"
+#include "pm_codec.h"
+#include "pm_power.h"
+#include "pm_snapshot.h"
+
+void setup();
+void loop();
+
+struct BENCH_STEP {
+  uint32_t ms;                          // how long the load holds
+  int      lsb;                         // current channel reading, 512 is no load
+};
+
+// rest, a 2A discharge, an 8A burst and rest again, the rate level follows
+static const BENCH_STEP benchLoad[] = { { 15000, 512 }, { 20000, 450 }, { 5000, 262 }, { 20000, 512 } };
+static const uint8_t    benchSteps  = sizeof(benchLoad) / sizeof(benchLoad[0]);
+static const uint32_t   benchMaxGapUs = 30000;    // host transactions 1 to 30ms apart
+static const uint32_t   benchSettleUs = 2000000;  // at rest after the run, before the counters are read
+
+struct BENCH_RESULT {
+  uint32_t samples;                     // adc conversions
+  int32_t  coulomb;                     // 0x31, mAh
+  uint32_t snapshots;                   // 0x4B reads that decoded
+  uint32_t snapshotErrors;              // bad version, bad crc or sequence going back
+  uint32_t writes;                      // 0x5C channel writes
+  uint32_t writeErrors;                 // read back something other than the last write
+  uint32_t overruns;                    // 0x6E
+  uint32_t dropped;                     // 0x6F
+  uint32_t wakeups;
+  uint32_t duty;                        // 0x1F at the end, milli-percent
+  double   expectedMah;                 // load integrated over the run
+};
+
+static FramMock     framMem;
+static FramTarget   framTarget(framMem);
+static uint64_t     benchStart   = 0;       // simulated micros the load profile started, 0 outside the run
+static uint64_t     benchNext    = 0;       // next host transaction
+static uint8_t      benchChannel = 0;       // last 0x5C written
+static bool         benchPending = false;   // a 0x5C write waits for its read back
+static uint16_t     benchSeq     = 0;       // last snapshot sequence number
+static BENCH_RESULT result;
+
+static int benchLevel(uint64_t us) {
+  uint64_t at = us - benchStart;
+  for (uint8_t x = 0; x < benchSteps; x++) {
+    if (at < (uint64_t) benchLoad[x].ms * 1000) return benchLoad[x].lsb;
+    at -= (uint64_t) benchLoad[x].ms * 1000;
+  }
+  return 512;
+}
+
+static int currentWave(uint8_t pin, uint64_t us) {
+  return benchStart ? benchLevel(us) : 512;
+}
+
+static uint32_t readBinary(uint8_t reg, uint8_t len) {
+  uint8_t cmd      = reg | 0x80;
+  uint8_t reply[8] = {};
+  nativeMasterWrite(&cmd, 1);
+  nativeMasterRead(reply, len);
+  return (uint32_t) reply[0] | (uint32_t) reply[1] << 8 | (uint32_t) reply[2] << 16 | (uint32_t) reply[3] << 24;
+}
+
+// one host transaction at a random moment, called from inside simulated time
+static void hostHook(uint64_t us) {
+  if (!benchStart || us < benchNext) return;
+  benchNext = us + 1000 + (uint64_t) (rand() % benchMaxGapUs);
+
+  if (benchPending) {                   // the write before this one has been executed
+    if (readBinary(0x5C, 1) != benchChannel) result.writeErrors++;
+    benchPending = false;
+    return;
+  }
+
+  if (rand() % 4) {
+    uint8_t     cmd   = snapshotRegister;
+    PM_SNAPSHOT frame;
+    nativeMasterWrite(&cmd, 1);
+    nativeMasterRead((uint8_t *) &frame, sizeof(frame));
+    bool valid = frame.version == snapshotVersion && crc8((uint8_t *) &frame, sizeof(frame) - 1) == frame.crc;
+    if (!valid || (int16_t) (frame.seq - benchSeq) < 0) result.snapshotErrors++;
+    else result.snapshots++;
+    if (valid) benchSeq = frame.seq;
+  } else {
+    uint8_t frame[2] = { 0x5C, (uint8_t) (rand() % 4) };
+    nativeMasterWrite(frame, 2);
+    benchChannel = frame[1];
+    benchPending = true;
+    result.writes++;
+  }
+}
+
+static double expectedMah() {
+  const CAL_CHANNEL &cal = calChannel(0);
+  double             mah = 0;
+  for (uint8_t x = 0; x < benchSteps; x++) {
+    double ma = (double) (benchLoad[x].lsb - cal.offset) * cal.gainQ16 / 65536.0;
+    mah += ma * benchLoad[x].ms / 3600000.0;
+  }
+  return mah;
+}
+
+static void benchRun(bool idleOnly) {
+  nativeI2cAttach(framI2CAddr, &framTarget);
+  nativeAnalogWaveform(ADC0, currentWave);
+  nativeAnalogSet(ADC1, 700);
+  nativeAnalogSet(ADC2, 610);                   // 13.2V pack, inside the default limits
+  nativeAnalogSet(TEMP0, 683);
+  nativeAnalogSet(TEMP1, 683);
+  nativeAnalogSet(TEMP2, 683);
+  nativeSerialQuiet(true);
+  setup();
+
+  uint8_t config2[2] = { 0x28, (uint8_t) (idleOnly ? pwrCfgIdle : 0) };
+  uint8_t clear[1]   = { 0x30 };
+  nativeMasterWrite(config2, 2);
+  nativeMasterWrite(clear, 1);
+  loop();
+
+  srand(1);
+  nativeOnAdvance(hostHook);
+  uint32_t samples = adcSampleCount();
+  uint32_t wakeups = powerWakeups();
+  uint64_t runUs   = 0;
+  for (uint8_t x = 0; x < benchSteps; x++) runUs += (uint64_t) benchLoad[x].ms * 1000;
+  benchStart = nativeMicros();
+  benchNext  = benchStart;
+  while (nativeMicros() - benchStart < runUs) loop();
+  nativeOnAdvance(nullptr);
+  result.wakeups  = powerWakeups() - wakeups;
+  uint64_t settle = benchStart + runUs + benchSettleUs;
+  benchStart = 0;
+
+  while (nativeMicros() < settle) loop();   // the last integration and writes through, same end in both runs
+  result.samples     = adcSampleCount() - samples;
+  result.coulomb     = (int32_t) readBinary(0x31, 4);
+  result.overruns    = readBinary(0x6E, 2);
+  result.dropped     = readBinary(0x6F, 2);
+  result.duty        = readBinary(pwrDutyReg, 4);
+  result.expectedMah = expectedMah();
+}
+
+// each run in its own process, the firmware keeps its state in globals
+static bool benchFork(bool idleOnly, BENCH_RESULT &out) {
+  int fds[2];
+  if (pipe(fds)) return false;
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    benchRun(idleOnly);
+    ssize_t sent = write(fds[1], &result, sizeof(result));
+    _exit(sent == (ssize_t) sizeof(result) ? 0 : 1);
+  }
+  close(fds[1]);
+  ssize_t got = read(fds[0], &out, sizeof(out));
+  close(fds[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return pid > 0 && got == (ssize_t) sizeof(out) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void printRun(const char *name, const BENCH_RESULT &r, double seconds, bool last) {
+  printf("  \"%s\": {\"samples\": %lu, \"coulomb_mah\": %ld, \"expected_mah\": %.2f, "
+         "\"snapshots\": %lu, \"snapshot_errors\": %lu, \"writes\": %lu, \"write_errors\": %lu, "
+         "\"overruns\": %lu, \"dropped\": %lu, \"wakeups_per_s\": %.1f, \"duty_mpct\": %lu}%s\n",
+         name, (unsigned long) r.samples, (long) r.coulomb, r.expectedMah,
+         (unsigned long) r.snapshots, (unsigned long) r.snapshotErrors,
+         (unsigned long) r.writes, (unsigned long) r.writeErrors,
+         (unsigned long) r.overruns, (unsigned long) r.dropped,
+         r.wakeups / seconds, (unsigned long) r.duty, last ? "," : "");
+}
+
+int main() {
+  BENCH_RESULT idle, deep;
+  if (!benchFork(true, idle) || !benchFork(false, deep)) {
+    fprintf(stderr, "run failed\n");
+    return 1;
+  }
+
+  double seconds = 0;
+  for (uint8_t x = 0; x < benchSteps; x++) seconds += benchLoad[x].ms / 1000.0;
+
+  const BENCH_RESULT *runs[] = { &idle, &deep };
+  bool ok = idle.samples == deep.samples && idle.coulomb == deep.coulomb;
+  for (const BENCH_RESULT *r : runs) {
+    double err = r->coulomb - r->expectedMah;
+    ok = ok && r->snapshotErrors == 0 && r->writeErrors == 0 && r->overruns == 0 && r->dropped == 0;
+    ok = ok && err > -1.0 && err < 1.0 && r->snapshots > 0 && r->writes > 0;
+  }
+
+  printf("{\n");
+  printRun("idle", idle, seconds, true);
+  printRun("standby", deep, seconds, true);
+  printf("  \"ok\": %s\n}\n", ok ? "true" : "false");
+  return ok ? 0 : 1;
+}
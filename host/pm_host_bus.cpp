@@ -0,0 +1,45 @@
+#include <chrono>
+#include <thread>
+#include "pm_host_bus.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#endif
+
+uint64_t HostBus::nowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void HostBus::waitUs(uint64_t us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+#ifdef __linux__
+
+HostI2cDev::HostI2cDev(const char *path) {
+  _fd = open(path, O_RDWR);
+}
+
+HostI2cDev::~HostI2cDev() {
+  if (_fd >= 0) close(_fd);
+}
+
+bool HostI2cDev::transfer(HOST_I2C_MSG *msgs, uint8_t count) {
+  if (_fd < 0 || !count || count > hostMsgMax) return false;
+  struct i2c_msg kmsgs[hostMsgMax];
+  for (uint8_t x = 0; x < count; x++) {
+    kmsgs[x].addr  = msgs[x].addr;
+    kmsgs[x].flags = (msgs[x].flags & hostMsgRead) ? I2C_M_RD : 0;
+    kmsgs[x].len   = msgs[x].len;
+    kmsgs[x].buf   = msgs[x].buf;
+  }
+  struct i2c_rdwr_ioctl_data data = { kmsgs, count };
+  return ioctl(_fd, I2C_RDWR, &data) == count;
+}
+
+#endif
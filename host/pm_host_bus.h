@@ -0,0 +1,45 @@
+#ifndef pm_host_bus_h
+#define pm_host_bus_h
+
+#include <stdint.h>
+
+// Master side transport for the host tools in this directory. A transfer is a
+// list of messages run back to back with repeated starts and one stop at the
+// end, the same model as Linux I2C_RDWR, so a command write and the read of
+// its reply cost one transaction and several of those can go out in one call.
+// The packmonitor answers reads from its register cache inside the receive
+// interrupt, the reply is ready by the time the repeated start arrives.
+
+const uint8_t hostMsgRead = 0x01;       // HOST_I2C_MSG flags, read instead of write
+const uint8_t hostMsgMax  = 42;         // messages per transfer, I2C_RDWR_IOCTL_MAX_MSGS
+
+struct HOST_I2C_MSG {
+  uint8_t  addr;                        // 7-bit
+  uint8_t  flags;
+  uint8_t  len;
+  uint8_t *buf;
+};
+
+class HostBus {
+  public:
+    virtual ~HostBus() { }
+    // run count messages as one transaction, false if any of them was not acknowledged
+    virtual bool     transfer(HOST_I2C_MSG *msgs, uint8_t count) = 0;
+    virtual uint64_t nowUs();           // timestamp for the telemetry table, CLOCK_MONOTONIC unless simulated
+    virtual void     waitUs(uint64_t us);   // idle between polling passes, simulated buses run their model instead
+};
+
+#ifdef __linux__
+// /dev/i2c-N through the i2c-dev driver
+class HostI2cDev : public HostBus {
+  public:
+    explicit HostI2cDev(const char *path);
+    ~HostI2cDev();
+    bool isOpen() const { return _fd >= 0; }
+    bool transfer(HOST_I2C_MSG *msgs, uint8_t count);
+  private:
+    int _fd;
+};
+#endif
+
+#endif
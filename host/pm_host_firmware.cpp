@@ -0,0 +1,70 @@
+#ifdef PM_NATIVE
+
+#include <math.h>
+#include "pm_host_firmware.h"
+#include "pm_native_hal.h"
+#include "pm_native_devices.h"
+#include "pm_pins.h"
+
+void setup();
+void loop();
+
+static FramMock   framMem;
+static FramTarget framTarget(framMem);
+static Nau7802Sim nauSim;
+
+// a 2A discharge with 1Hz ripple on both current paths, as in env:native
+static int currentWave(uint8_t pin, uint64_t us) {
+  return 512 - 62 + (int) (10 * sin(2 * M_PI * (double) us / 1000000.0));
+}
+
+static int32_t nauWave(uint64_t us) {
+  return -651000 + (int32_t) (3000 * sin(2 * M_PI * (double) us / 1000000.0));
+}
+
+static NauTarget nauTarget(nauSim, NAU_DRDY, nauWave);
+
+HostFirmwareBus::HostFirmwareBus() {
+  nativeI2cAttach(framI2CAddr, &framTarget);
+  nativeI2cAttach(nauI2CAddr, &nauTarget);
+  nativeAnalogWaveform(ADC0, currentWave);
+  nativeAnalogSet(ADC1, 700);
+  nativeAnalogSet(ADC2, 610);                               // 13.2V pack, inside the default limits
+  nativeAnalogSet(TEMP0, 683);
+  nativeAnalogSet(TEMP1, 640);
+  nativeAnalogSet(TEMP2, 720);
+
+  nativeSerialQuiet(true);                                  // stdout belongs to the tool
+  setup();
+}
+
+uint8_t HostFirmwareBus::address() {
+  return I2C_SLAVE_ADDR;
+}
+
+bool HostFirmwareBus::transfer(HOST_I2C_MSG *msgs, uint8_t count) {
+  transfers++;
+  for (uint8_t x = 0; x < count; x++) {
+    HOST_I2C_MSG &msg = msgs[x];
+    messages++;
+    if (msg.addr != I2C_SLAVE_ADDR) return false;           // nobody else on this bus, address NAK ends the transfer
+    if (msg.flags & hostMsgRead) {
+      uint8_t got = nativeMasterRead(msg.buf, msg.len);
+      for (uint8_t b = got; b < msg.len; b++) msg.buf[b] = 0xFF;   // slave stopped driving, the pull-ups answer
+    } else if (!nativeMasterWrite(msg.buf, msg.len)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t HostFirmwareBus::nowUs() {
+  return nativeMicros();
+}
+
+void HostFirmwareBus::waitUs(uint64_t us) {
+  uint64_t until = nativeMicros() + us;
+  while (nativeMicros() < until) loop();                    // schedIdle() moves time on every pass
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef pm_host_firmware_h
+#define pm_host_firmware_h
+
+#include <stdint.h>
+#include "pm_host_bus.h"
+
+// The packmonitor firmware itself as a bus device, for testing the host tools
+// against the real command handling instead of the HostSimPack model. Built
+// with PM_NATIVE together with src/*.cpp and the native HAL (not
+// pm_native_main.cpp), the firmware runs in process on simulated FRAM, load
+// cell and analog inputs: writes go through its receiveEvent(), reads through
+// requestEvent(), and waitUs() runs loop() for the simulated time, which is
+// where queued commands such as 0x60 execute and the register cache refreshes.
+//
+// There is one firmware image per process, so there is one pack, directly on
+// the bus at I2C_SLAVE_ADDR. Any other address NAKs.
+
+class HostFirmwareBus : public HostBus {
+  public:
+    HostFirmwareBus();                  // attaches the simulated peripherals and runs setup()
+
+    bool     transfer(HOST_I2C_MSG *msgs, uint8_t count);
+    uint64_t nowUs();                   // simulated time
+    void     waitUs(uint64_t us);       // runs loop() until us have passed
+
+    static uint8_t address();           // I2C_SLAVE_ADDR of the firmware build
+
+    uint32_t transfers = 0;
+    uint32_t messages  = 0;
+};
+
+#endif
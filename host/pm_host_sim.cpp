@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+#include "pm_host_sim.h"
+#include "pm_codec.h"
+
+static const uint8_t simMuxFirst = 0x70;
+static const uint8_t simMuxCount = 4;
+
+void HostSimPack::set(uint8_t reg, uint8_t width, int32_t value) {
+  reg &= 0x7F;
+  _value[reg] = value;
+  _width[reg] = width;
+}
+
+bool HostSimPack::receive(const uint8_t *data, uint8_t len) {
+  if (!present) return false;
+  if (!len) return true;
+  uint8_t cmd = data[0];
+  uint8_t reg = cmd & 0x7F;
+  _replyLen = 0;
+
+  if (len > 1) {                                              // command with data, nothing to read back
+    commands++;
+  } else if (cmd == snapshotRegister) {
+    frame.seq++;
+    frame.crc = crc8((const uint8_t *) &frame, sizeof(PM_SNAPSHOT) - 1);
+    memcpy(_reply, &frame, sizeof(PM_SNAPSHOT));
+    _replyLen = sizeof(PM_SNAPSHOT);
+  } else if (cmd & 0x80) {                                    // binary, little-endian plus the optional PEC
+    uint32_t value = (uint32_t) _value[reg];
+    for (uint8_t x = 0; x < _width[reg]; x++) _reply[x] = (uint8_t) (value >> (8 * x));
+    _replyLen = _width[reg];
+    if (pec && _replyLen) {
+      uint8_t header[3] = { (uint8_t) (addr << 1), cmd, (uint8_t) ((addr << 1) | 1) };
+      _reply[_replyLen] = crc8(_reply, _replyLen, crc8(header, sizeof(header)));
+      _replyLen++;
+    }
+  } else if (_width[reg]) {
+    _replyLen = snprintf((char *) _reply, sizeof(_reply), "%ld", (long) _value[reg]) + 1;
+  }
+  return true;
+}
+
+uint8_t HostSimPack::request(uint8_t *data, uint8_t len) {
+  if (!present) return 0;
+  if (!_replyLen) _replyLen = snprintf((char *) _reply, sizeof(_reply), "Slave 0x%X ready!", addr);
+  uint8_t got = (len < _replyLen) ? len : _replyLen;
+  memcpy(data, _reply, got);
+  memset(data + got, 0xFF, len - got);                        // the bus floats high once the slave stops sending
+  _replyLen = 0;
+  return len;
+}
+
+void HostSimBus::attach(HostSimPack *pack, uint8_t mux, uint8_t channel) {
+  _slots.push_back({ pack, mux, channel });
+}
+
+// the pack a master addressing addr would reach through the mux channels that are on
+HostSimPack *HostSimBus::find(uint8_t addr, bool &conflict) {
+  HostSimPack *hit = nullptr;
+  conflict = false;
+  for (const SIM_SLOT &slot : _slots) {
+    if (slot.pack->addr != addr || !slot.pack->present) continue;
+    if (slot.mux && !(_muxState[slot.mux - simMuxFirst] & (1 << slot.channel))) continue;
+    if (hit) conflict = true;
+    hit = slot.pack;
+  }
+  return hit;
+}
+
+bool HostSimBus::transfer(HOST_I2C_MSG *msgs, uint8_t count) {
+  transfers++;
+  bool     ok    = true;
+  uint64_t bits  = 2;                                         // start and stop
+  for (uint8_t x = 0; x < count && ok; x++) {
+    const HOST_I2C_MSG &msg = msgs[x];
+    messages++;
+    bits += (uint64_t) (1 + msg.len) * 9 + (x ? 1 : 0);       // address byte and data with their acks, repeated start
+    bool read = msg.flags & hostMsgRead;
+
+    if (msg.addr >= simMuxFirst && msg.addr < simMuxFirst + simMuxCount) {
+      uint8_t &state = _muxState[msg.addr - simMuxFirst];
+      if (read) {
+        memset(msg.buf, state, msg.len);
+      } else if (msg.len) {
+        state = msg.buf[msg.len - 1] & 0x0F;
+        muxWrites++;
+      }
+      continue;
+    }
+
+    bool         conflict;
+    HostSimPack *pack = find(msg.addr, conflict);
+    if (!pack || conflict) {                                  // nobody acks, or two packs talk over each other
+      ok = false;
+    } else if (read) {
+      pack->request(msg.buf, msg.len);
+    } else {
+      ok = pack->receive(msg.buf, msg.len);
+    }
+  }
+  uint64_t spent = bits * 1000000 / _hz;
+  busUs  += spent;
+  _nowUs += spent;
+  return ok;
+}
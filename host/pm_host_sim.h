@@ -0,0 +1,67 @@
+#ifndef pm_host_sim_h
+#define pm_host_sim_h
+
+#include <stdint.h>
+#include <vector>
+#include "pm_host_bus.h"
+#include "pm_snapshot.h"
+
+// In-process bus model for the host tools: PCA9545A muxes and packmonitors as
+// the host sees them, so the poller and the daemon can be exercised on any
+// machine. A simulated pack answers binary reads (command bit 7) with the
+// register width and optional PEC the firmware uses, ASCII reads with the
+// decimal text, 0x4B with a snapshot frame and anything it has no reply for
+// with the idle message. Time is the bus time at hz, plus whatever the caller
+// adds with advance(), so runs are deterministic.
+
+class HostSimPack {
+  public:
+    explicit HostSimPack(uint8_t addr) : addr(addr) { }
+
+    void    set(uint8_t reg, uint8_t width, int32_t value);   // register served by binary and ascii reads
+    bool    receive(const uint8_t *data, uint8_t len);        // master write
+    uint8_t request(uint8_t *data, uint8_t len);              // master read
+
+    uint8_t     addr;
+    bool        pec     = false;        // config1 bit 0
+    bool        present = true;         // false to have the pack NAK like a pulled connector
+    PM_SNAPSHOT frame;                  // served by 0x4B, seq and crc are stamped on every read
+    uint32_t    commands = 0;           // writes that were not reads, 0x60 and the like
+
+  private:
+    int32_t _value[0x80] = {};
+    uint8_t _width[0x80] = {};
+    uint8_t _reply[32];
+    uint8_t _replyLen = 0;
+};
+
+class HostSimBus : public HostBus {
+  public:
+    explicit HostSimBus(uint32_t hz = 100000) : _hz(hz) { }
+
+    void     attach(HostSimPack *pack, uint8_t mux = 0, uint8_t channel = 0);   // mux 0 for the main bus
+    void     advance(uint64_t us) { _nowUs += us; }
+    void     waitUs(uint64_t us) { advance(us); }
+    bool     transfer(HOST_I2C_MSG *msgs, uint8_t count);
+    uint64_t nowUs() { return _nowUs; }
+
+    uint32_t transfers  = 0;            // transactions, one start to one stop
+    uint32_t messages   = 0;
+    uint32_t muxWrites  = 0;
+    uint64_t busUs      = 0;            // time the bus was busy
+
+  private:
+    struct SIM_SLOT {
+      HostSimPack *pack;
+      uint8_t      mux;
+      uint8_t      channel;
+    };
+    HostSimPack *find(uint8_t addr, bool &conflict);
+
+    uint32_t              _hz;
+    uint64_t              _nowUs = 0;
+    std::vector<SIM_SLOT> _slots;
+    uint8_t               _muxState[4] = {};   // control registers of the muxes at 0x70 to 0x73
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <string.h>
+#include "pm_logreader.h"
+#include "pm_codec.h"
+
+static LOG_RECORD logRecord(const LOG_BLOCK_HEADER &hdr, uint32_t time) {
+  LOG_RECORD rec = {};
+  rec.block = hdr.seq;
+  rec.time  = time;
+  return rec;
+}
+
+bool logDecode(const LOG_BLOCK &block, std::vector<LOG_RECORD> &out) {
+  const LOG_BLOCK_HEADER &hdr = block.hdr;
+  if (hdr.magic != logMagic || block.crc != crc8((const uint8_t *) &block, sizeof(LOG_BLOCK) - 1)) return false;
+  if (hdr.used > logPayloadSize) return false;
+
+  std::vector<LOG_RECORD> records;
+  CODEC_STREAM            stream;
+  uint32_t                sample = 0;                         // the keyframe is sample 0
+  auto addSamples = [&](uint8_t count) {
+    while (count--) {
+      LOG_RECORD rec = logRecord(hdr, hdr.time + hdr.keyOffset + sample++ * hdr.interval);
+      rec.currentMa  = stream.last[0] * 10;
+      rec.packMv     = stream.last[1] * 10;
+      rec.tempMdeg   = stream.last[2] * 100;
+      records.push_back(rec);
+    }
+  };
+
+  if (hdr.keyValid) {
+    const int32_t key[logFields] = { hdr.current, hdr.pack, hdr.temp };
+    codecKey(stream, key, logFields);
+    addSamples(1);
+  }
+  for (uint8_t pos = 0; pos < hdr.used; ) {
+    const uint8_t *tok = &block.payload[pos];
+    if (*tok >= logTokEvent) {                                // type, uint16 offset and uint32 value, little endian
+      if (hdr.used - pos < logEventSize) return false;
+      LOG_RECORD rec = logRecord(hdr, hdr.time + (tok[1] | (uint16_t) tok[2] << 8));
+      rec.event = *tok & ~logTokEvent;
+      rec.value = (uint32_t) tok[3] | (uint32_t) tok[4] << 8 | (uint32_t) tok[5] << 16 | (uint32_t) tok[6] << 24;
+      records.push_back(rec);
+      pos += logEventSize;
+      continue;
+    }
+    uint8_t samples;
+    uint8_t read = hdr.keyValid ? codecNext(stream, tok, hdr.used - pos, samples) : 0;   // no deltas without a keyframe
+    if (!read) return false;
+    addSamples(samples);
+    pos += read;
+  }
+  out.insert(out.end(), records.begin(), records.end());
+  return true;
+}
+
+// 0x79 in binary, with the PEC when the packs append one
+bool PackLogReader::readHead(const POLL_TARGET &target, uint16_t &head) {
+  uint8_t      cmd      = logHeadReg | pollBinary;
+  uint8_t      reply[3] = {};
+  HOST_I2C_MSG msgs[2]  = { { target.addr, 0, 1, &cmd },
+                            { target.addr, hostMsgRead, (uint8_t) (_poller.pec() ? 3 : 2), reply } };
+  if (!_poller.bus().transfer(msgs, 2)) return false;
+  if (_poller.pec()) {
+    uint8_t header[3] = { (uint8_t) (target.addr << 1), cmd, (uint8_t) ((target.addr << 1) | 1) };
+    if (reply[2] != crc8(reply, 2, crc8(header, sizeof(header)))) return false;
+  }
+  head = reply[0] | (uint16_t) reply[1] << 8;
+  return true;
+}
+
+// one half block, false if the pack did not answer or never had one ready
+bool PackLogReader::readChunk(const POLL_TARGET &target, uint8_t *out) {
+  char    idle[24];
+  int     idleLen = snprintf(idle, sizeof(idle), "Slave 0x%X ready!", target.addr);
+  uint8_t cmd     = logReadReg;
+  for (uint8_t tries = 0; tries < logReadTries; tries++) {
+    HOST_I2C_MSG msgs[2] = { { target.addr, 0, 1, &cmd }, { target.addr, hostMsgRead, logChunkSize, out } };
+    if (!_poller.bus().transfer(msgs, 2)) return false;
+    if (memcmp(out, idle, idleLen)) return true;
+    _retries++;
+    _poller.bus().waitUs(logRetryUs);
+  }
+  return false;
+}
+
+int PackLogReader::drain(uint8_t idx, uint16_t seq, std::vector<LOG_RECORD> &out) {
+  const POLL_TARGET &target = _poller.pack(idx).target;
+  uint16_t           head;
+  if (!_poller.selectPack(idx) || !readHead(target, head)) return -1;
+
+  uint8_t      frame[8] = { logCursorReg };                   // the block number as text, like every other write
+  uint8_t      len      = (uint8_t) snprintf((char *) frame + 1, sizeof(frame) - 1, "%u", seq);
+  HOST_I2C_MSG cursor   = { target.addr, 0, (uint8_t) (len + 1), frame };
+  if (!_poller.bus().transfer(&cursor, 1)) return -1;
+
+  int decoded = 0;
+  for (uint16_t n = 0; n <= UINT8_MAX; n++) {                 // a ring never holds more blocks than that
+    LOG_BLOCK block;
+    uint8_t  *raw = (uint8_t *) &block;
+    if (!readChunk(target, raw) || !readChunk(target, raw + logChunkSize)) break;   // cursor ran past the open block
+    if (!logDecode(block, out)) {
+      _badBlocks++;
+      continue;
+    }
+    decoded++;
+    _newest = block.hdr.seq;
+    if ((int16_t) (block.hdr.seq - head) >= 0) break;
+  }
+  return decoded;
+}
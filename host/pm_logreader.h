@@ -0,0 +1,63 @@
+#ifndef pm_logreader_h
+#define pm_logreader_h
+
+#include <stdint.h>
+#include <vector>
+#include "pm_poller.h"
+#include "pm_logblock.h"
+
+// Reads the telemetry and event log of a pack out through the 0x77/0x78
+// cursor and decodes it with the same pm_codec.h the firmware encodes with.
+// drain() sets the cursor, then reads half blocks until the block that was
+// the newest (0x79) when it started:
+//
+//   - a half that comes back as the idle reply was not fetched by loop() yet,
+//     it is read again after logRetryUs, up to logReadTries times
+//   - the two halves of a block are joined and checked for the magic and the
+//     CRC-8, a block that fails is counted and skipped, the rest decode
+//   - samples come out scaled back to mA, mV and mdegC, events with their
+//     LOG_EVENT type and value, both stamped with the pack clock
+//
+// The newest block is the one the pack is still appending to, a later drain
+// from its sequence number serves it again with whatever was added since.
+// The pack is reached through the PackPoller table, which switches the mux
+// and knows whether the packs run with PEC.
+
+const uint8_t  logReadTries = 50;
+const uint32_t logRetryUs   = 2000;     // a loop() pass, the read that found nothing ready woke the pack
+
+struct LOG_RECORD {
+  uint16_t block;                       // sequence number of the block it came from
+  uint32_t time;                        // pack clock, s
+  uint8_t  event;                       // LOG_EVENT, 0 for a sample
+  uint32_t value;                       // event value
+  int32_t  currentMa;                   // sample fields, 10 mA resolution
+  int32_t  packMv;                      // 10 mV resolution
+  int32_t  tempMdeg;                    // hottest sensor, 0.1 degC resolution
+};
+
+// false and nothing appended for a torn, foreign or garbled block
+bool logDecode(const LOG_BLOCK &block, std::vector<LOG_RECORD> &out);
+
+class PackLogReader {
+  public:
+    explicit PackLogReader(PackPoller &poller) : _poller(poller) { }
+
+    // blocks decoded from seq (0 for the oldest held) to the newest, -1 if the pack did not answer
+    int      drain(uint8_t idx, uint16_t seq, std::vector<LOG_RECORD> &out);
+
+    uint16_t newest() const { return _newest; }         // last block decoded, where the next drain picks up
+    uint32_t badBlocks() const { return _badBlocks; }
+    uint32_t retries() const { return _retries; }
+
+  private:
+    bool     readHead(const POLL_TARGET &target, uint16_t &head);
+    bool     readChunk(const POLL_TARGET &target, uint8_t *out);
+
+    PackPoller &_poller;
+    uint16_t    _newest    = 0;
+    uint32_t    _badBlocks = 0;
+    uint32_t    _retries   = 0;
+};
+
+#endif
@@ -0,0 +1,209 @@
+#include <string.h>
+#include <algorithm>
+#include "pm_poller.h"
+#include "pm_codec.h"
+
+int PackPoller::addPack(uint8_t addr, uint8_t mux, uint8_t channel) {
+  if (_table.size() >= pollPacksMax) return -1;
+  PACK_TELEMETRY entry;
+  entry.target.addr    = addr;
+  entry.target.mux     = mux;
+  entry.target.channel = (mux == pollNoMux) ? 0 : channel;
+  _table.push_back(entry);
+  _order.push_back((uint8_t) (_table.size() - 1));
+
+  std::stable_sort(_order.begin(), _order.end(), [this](uint8_t a, uint8_t b) {
+    const POLL_TARGET &ta = _table[a].target;
+    const POLL_TARGET &tb = _table[b].target;
+    return (ta.mux != tb.mux) ? ta.mux < tb.mux : ta.channel < tb.channel;
+  });
+  _selected = false;                                          // the first pass turns every other mux off
+  return (int) _table.size() - 1;
+}
+
+bool PackPoller::addRegister(uint8_t reg, uint8_t width, bool isSigned) {
+  if (_regs.size() >= pollExtraMax || (width != 1 && width != 2 && width != 4)) return false;
+  _regs.push_back({ (uint8_t) (reg & ~pollBinary), width, isSigned });
+  return true;
+}
+
+uint8_t PackPoller::replyLen(uint8_t item) const {
+  if (!item) return sizeof(PM_SNAPSHOT);
+  return _regs[item - 1].width + (_pec ? 1 : 0);
+}
+
+// one write for the mux being left and the one being entered, nothing if the channel is already on
+bool PackPoller::select(uint8_t mux, uint8_t channel) {
+  if (_selected && mux == _curMux && channel == _curChannel) return true;
+
+  uint8_t      off = 0;
+  uint8_t      on  = (uint8_t) (1 << channel);
+  HOST_I2C_MSG msgs[pollMuxCount + 1];
+  uint8_t      count = 0;
+  for (uint8_t other = pollMuxFirst; other < pollMuxFirst + pollMuxCount; other++) {
+    if (other == mux) continue;
+    bool known = std::any_of(_table.begin(), _table.end(), [other](const PACK_TELEMETRY &e) { return e.target.mux == other; });
+    if (known && (!_selected || other == _curMux)) msgs[count++] = { other, 0, 1, &off };   // overlapping addresses must not answer
+  }
+  if (mux != pollNoMux) msgs[count++] = { mux, 0, 1, &on };
+
+  _muxSwitches++;
+  _transfers++;
+  _selected = count ? _bus.transfer(msgs, count) : true;
+  _curMux     = mux;
+  _curChannel = channel;
+  return _selected;
+}
+
+bool PackPoller::selectPack(uint8_t idx) {
+  const POLL_TARGET &t = _table[idx].target;
+  return select(t.mux, t.channel);
+}
+
+// snapshot and extra registers of count packs in one transfer, -1 if the transfer failed
+int PackPoller::readPacks(const uint8_t *idx, uint8_t count) {
+  const uint8_t items = 1 + _regs.size();
+  uint8_t       cmds[hostMsgMax / 2];
+  uint8_t       replies[hostMsgMax / 2][sizeof(PM_SNAPSHOT)];
+  HOST_I2C_MSG  msgs[hostMsgMax];
+  uint8_t       n = 0;
+
+  for (uint8_t p = 0; p < count; p++) {
+    uint8_t addr = _table[idx[p]].target.addr;
+    for (uint8_t item = 0; item < items; item++) {
+      uint8_t slot = n / 2;
+      cmds[slot] = item ? (_regs[item - 1].reg | pollBinary) : snapshotRegister;
+      msgs[n++]  = { addr, 0, 1, &cmds[slot] };
+      msgs[n++]  = { addr, hostMsgRead, replyLen(item), replies[slot] };
+    }
+  }
+  _transfers++;
+  if (!_bus.transfer(msgs, n)) return -1;
+
+  uint64_t stamp = _bus.nowUs();
+  int      good  = 0;
+  for (uint8_t p = 0; p < count; p++) {
+    PACK_TELEMETRY &entry = _table[idx[p]];
+    const uint8_t  *frame = replies[p * items];
+    bool ok = frame[0] == snapshotVersion && frame[sizeof(PM_SNAPSHOT) - 1] == crc8(frame, sizeof(PM_SNAPSHOT) - 1);
+    if (ok) {
+      memcpy(&entry.snapshot, frame, sizeof(PM_SNAPSHOT));
+      entry.valid   = true;
+      entry.stampUs = stamp;
+    }
+
+    for (uint8_t item = 1; item < items; item++) {
+      const POLL_REGISTER &reg   = _regs[item - 1];
+      const uint8_t       *reply = replies[p * items + item];
+      if (_pec) {                                             // addr+W, command, addr+R, then the data
+        uint8_t header[3] = { (uint8_t) (entry.target.addr << 1), cmds[p * items + item], (uint8_t) ((entry.target.addr << 1) | 1) };
+        if (reply[reg.width] != crc8(reply, reg.width, crc8(header, sizeof(header)))) {
+          ok = false;
+          continue;
+        }
+      }
+      uint32_t value = 0;
+      for (uint8_t x = reg.width; x--; ) value = (value << 8) | reply[x];
+      if (reg.isSigned && reg.width < 4 && (value & (1UL << (8 * reg.width - 1)))) value |= ~0UL << (8 * reg.width);
+      entry.extra[item - 1]        = (int32_t) value;
+      entry.extraStampUs[item - 1] = stamp;
+    }
+
+    if (ok) {
+      good++;
+    } else {
+      entry.errors++;
+    }
+  }
+  return good;
+}
+
+uint8_t PackPoller::refresh() {
+  const size_t total = _order.size();
+  if (!total) return 0;
+
+  // start on the channel the last pass ended on, saves a switch per pass
+  size_t start = 0;
+  for (size_t k = 0; _selected && k < total; k++) {
+    const POLL_TARGET &t = _table[_order[k]].target;
+    if (t.mux == _curMux && t.channel == _curChannel) {
+      start = k;
+      break;
+    }
+  }
+
+  const uint8_t perTransfer = hostMsgMax / (2 * (1 + _regs.size()));
+  uint8_t       good        = 0;
+  size_t        k           = 0;
+  while (k < total) {
+    uint8_t group[pollPacksMax];
+    uint8_t count = 0;
+    const POLL_TARGET &first = _table[_order[(start + k) % total]].target;
+    while (k < total) {
+      const POLL_TARGET &t = _table[_order[(start + k) % total]].target;
+      if (t.mux != first.mux || t.channel != first.channel) break;
+      group[count++] = _order[(start + k) % total];
+      k++;
+    }
+
+    if (!select(first.mux, first.channel)) {
+      for (uint8_t p = 0; p < count; p++) _table[group[p]].errors++;
+      continue;
+    }
+    for (uint8_t p = 0; p < count; p += perTransfer) {
+      uint8_t chunk = std::min<uint8_t>(perTransfer, count - p);
+      int     read  = readPacks(&group[p], chunk);
+      if (read >= 0) {
+        good += read;
+        continue;
+      }
+      for (uint8_t q = 0; q < chunk; q++) {                   // find the pack that did not answer
+        read = readPacks(&group[p + q], 1);
+        if (read < 0) {
+          _table[group[p + q]].errors++;
+        } else {
+          good += read;
+        }
+      }
+    }
+  }
+  return good;
+}
+
+// a register write with its char string data, 0x60 with the time for example, batched per mux channel like refresh()
+uint8_t PackPoller::command(uint8_t reg, const char *text) {
+  uint8_t frame[32];
+  uint8_t len = (uint8_t) std::min<size_t>(strlen(text), sizeof(frame) - 1);
+  frame[0] = reg;
+  memcpy(frame + 1, text, len);
+
+  uint8_t acked = 0;
+  size_t  k     = 0;
+  while (k < _order.size()) {
+    const POLL_TARGET &first = _table[_order[k]].target;
+    HOST_I2C_MSG       msgs[hostMsgMax];
+    uint8_t            group[hostMsgMax];
+    uint8_t            count = 0;
+    while (k < _order.size() && count < hostMsgMax) {
+      const POLL_TARGET &t = _table[_order[k]].target;
+      if (t.mux != first.mux || t.channel != first.channel) break;
+      group[count]  = _order[k++];
+      msgs[count++] = { t.addr, 0, (uint8_t) (len + 1), frame };
+    }
+    if (!select(first.mux, first.channel)) continue;
+    _transfers++;
+    if (_bus.transfer(msgs, count)) {
+      acked += count;
+      continue;
+    }
+    for (uint8_t p = 0; p < count; p++) {                     // one at a time to get past the pack that did not ack
+      _transfers++;
+      if (_bus.transfer(&msgs[p], 1)) {
+        acked++;
+      } else {
+        _table[group[p]].errors++;
+      }
+    }
+  }
+  return acked;
+}
@@ -0,0 +1,90 @@
+#ifndef pm_poller_h
+#define pm_poller_h
+
+#include <stdint.h>
+#include <vector>
+#include "pm_host_bus.h"
+#include "pm_snapshot.h"
+
+// Multi-pack poller for a host with many packmonitors, directly on the bus or
+// behind PCA9545A muxes. refresh() makes one pass over the rack:
+//
+//   - packs are grouped by mux channel and each channel is switched to once,
+//     a pass starts on the channel the previous one ended on
+//   - every pack on the channel is read with one snapshot (0x4B) plus the
+//     extra registers in binary, and all of those command/reply pairs go out
+//     as one batched transfer instead of a transaction per value
+//   - a transfer that fails is retried pack by pack, so one missing pack only
+//     costs its own entry
+//
+// The results land in a table of PACK_TELEMETRY, each entry stamped with the
+// host time it was read. Frames with a bad CRC, replies with a bad PEC or
+// packs that did not answer keep their last good values and count an error.
+// The transport is a HostBus, HostI2cDev for real hardware or HostSimBus from
+// pm_host_sim.h for the in-process model.
+
+const uint8_t pollExtraMax  = 8;        // extra registers per pack
+const uint8_t pollNoMux     = 0;        // pack is directly on the host bus
+const uint8_t pollMuxFirst  = 0x70;     // PCA9545A with A1..A0 strapped, 0x70 to 0x73
+const uint8_t pollMuxCount  = 4;
+const uint8_t pollPacksMax  = 255;
+const uint8_t pollBinary    = 0x80;     // command bit 7, binary reply
+
+struct POLL_TARGET {
+  uint8_t addr;                         // packmonitor slave address
+  uint8_t mux;                          // mux address, pollNoMux if none
+  uint8_t channel;                      // 0 to 3 on the mux
+};
+
+struct POLL_REGISTER {
+  uint8_t reg;                          // plain register number, the poller sets bit 7
+  uint8_t width;                        // bytes, 1, 2 or 4
+  bool    isSigned;
+};
+
+struct PACK_TELEMETRY {
+  POLL_TARGET target;
+  bool        valid        = false;     // snapshot holds a good frame
+  PM_SNAPSHOT snapshot;
+  uint64_t    stampUs      = 0;         // host time the snapshot was read
+  int32_t     extra[pollExtraMax] = {}; // addRegister() order
+  uint64_t    extraStampUs[pollExtraMax] = {};
+  uint32_t    errors       = 0;         // no answer, bad CRC or bad PEC
+};
+
+class PackPoller {
+  public:
+    explicit PackPoller(HostBus &bus) : _bus(bus) { }
+
+    int      addPack(uint8_t addr, uint8_t mux = pollNoMux, uint8_t channel = 0);   // table index, -1 when full
+    bool     addRegister(uint8_t reg, uint8_t width, bool isSigned);                // false when full
+    void     setPec(bool enable) { _pec = enable; }                                 // packs run with config1 bit 0 set
+    uint8_t  refresh();                                                             // one pass, packs read OK
+    uint8_t  command(uint8_t reg, const char *text);                                // write to every pack, packs that acked
+    bool     selectPack(uint8_t idx);                                               // switch the mux to a pack, for reads outside refresh()
+
+    uint8_t               packCount() const { return (uint8_t) _table.size(); }
+    const PACK_TELEMETRY &pack(uint8_t idx) const { return _table[idx]; }
+    uint32_t              muxSwitches() const { return _muxSwitches; }
+    uint32_t              transfers() const { return _transfers; }
+    bool                  pec() const { return _pec; }
+    HostBus              &bus() const { return _bus; }
+
+  private:
+    bool    select(uint8_t mux, uint8_t channel);
+    int     readPacks(const uint8_t *idx, uint8_t count);
+    uint8_t replyLen(uint8_t item) const;
+
+    HostBus                    &_bus;
+    std::vector<PACK_TELEMETRY> _table;
+    std::vector<uint8_t>        _order;       // table indices sorted by mux and channel
+    std::vector<POLL_REGISTER>  _regs;
+    bool                        _pec         = false;
+    uint8_t                     _curMux      = pollNoMux;
+    uint8_t                     _curChannel  = 0;
+    bool                        _selected    = false;   // _curMux/_curChannel reflect the hardware
+    uint32_t                    _muxSwitches = 0;
+    uint32_t                    _transfers   = 0;
+};
+
+#endif
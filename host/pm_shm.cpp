@@ -0,0 +1,55 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pm_shm.h"
+
+SHM_SEGMENT *shmCreate(const char *name) {
+  int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return nullptr;
+  if (ftruncate(fd, sizeof(SHM_SEGMENT)) < 0) {
+    close(fd);
+    return nullptr;
+  }
+  void *map = mmap(nullptr, sizeof(SHM_SEGMENT), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return nullptr;
+
+  SHM_SEGMENT *seg = (SHM_SEGMENT *) map;
+  seg->magic = 0;                                             // readers reject the segment while it is set up
+  std::atomic_thread_fence(std::memory_order_release);
+  memset((void *) seg, 0, sizeof(SHM_SEGMENT));
+  seg->version   = shmVersion;
+  seg->daemonPid = getpid();
+  std::atomic_thread_fence(std::memory_order_release);
+  seg->magic     = shmMagic;
+  return seg;
+}
+
+SHM_SEGMENT *shmOpen(const char *name) {
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(SHM_SEGMENT)) {
+    close(fd);
+    return nullptr;
+  }
+  void *map = mmap(nullptr, sizeof(SHM_SEGMENT), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return nullptr;
+
+  SHM_SEGMENT *seg = (SHM_SEGMENT *) map;
+  if (seg->magic != shmMagic || seg->version != shmVersion) {
+    munmap(map, sizeof(SHM_SEGMENT));
+    return nullptr;
+  }
+  return seg;
+}
+
+void shmClose(SHM_SEGMENT *seg) {
+  if (seg) munmap((void *) seg, sizeof(SHM_SEGMENT));
+}
+
+void shmRemove(const char *name) {
+  shm_unlink(name);
+}
@@ -0,0 +1,88 @@
+#ifndef pm_shm_h
+#define pm_shm_h
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "pm_poller.h"
+
+// Shared-memory telemetry segment published by the pmd daemon. The daemon is
+// the only writer, any number of local processes map the segment read-only
+// and read pack state without a syscall or a lock. Every pack sits in its own
+// slot behind a seqlock: the writer makes the sequence odd, copies the frame
+// and makes it even again, a reader copies the frame between two loads of the
+// sequence and retries if it changed or was odd. A reader can never block the
+// daemon, the daemon can only make a reader retry.
+//
+//   SHM_SEGMENT *seg = shmOpen("/pm_telemetry");   // once, shm_open + mmap
+//   SHM_PACK pack;
+//   if (shmRead(seg, 0, pack)) ...                 // no syscalls from here on
+//
+// stampUs is CLOCK_MONOTONIC in microseconds, clock_gettime() runs in the vDSO
+// so a reader can age a frame without entering the kernel either.
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "the seqlock needs a lock-free 32-bit atomic across processes");
+
+const uint32_t shmMagic     = 0x484D5350;   // "PSMH" little-endian, checked by shmOpen()
+const uint16_t shmVersion   = 1;            // bump when SHM_PACK or SHM_SEGMENT change
+const uint8_t  shmPacksMax  = 64;
+const uint16_t shmRetries   = 1000;         // a reader gives up after this many torn copies
+const char     shmDefault[] = "/pm_telemetry";
+
+struct SHM_PACK {
+  uint8_t     addr;
+  uint8_t     mux;                          // pollNoMux if none
+  uint8_t     channel;
+  uint8_t     valid;                        // 1 once snapshot holds a good frame
+  uint32_t    errors;                       // failed reads since the daemon started
+  uint64_t    stampUs;                      // when the snapshot was read
+  PM_SNAPSHOT snapshot;
+  int32_t     extra[pollExtraMax];          // registers listed in SHM_SEGMENT::extraReg
+};
+
+struct SHM_SLOT {
+  std::atomic<uint32_t> seq;                // odd while the daemon writes the slot
+  SHM_PACK              pack;
+};
+
+struct SHM_SEGMENT {
+  uint32_t              magic;
+  uint16_t              version;
+  uint8_t               packs;              // slots in use
+  uint8_t               extras;             // registers in extra[]
+  uint8_t               extraReg[pollExtraMax];
+  uint32_t              daemonPid;
+  std::atomic<uint32_t> passes;             // complete polling passes, a reader can wait for the next one
+  SHM_SLOT              slot[shmPacksMax];
+};
+
+// writer side, only the daemon calls this
+inline void shmWrite(SHM_SEGMENT *seg, uint8_t idx, const SHM_PACK &pack) {
+  SHM_SLOT &slot = seg->slot[idx];
+  uint32_t  seq  = slot.seq.load(std::memory_order_relaxed);
+  slot.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);      // odd sequence is visible before any of the new bytes
+  memcpy(&slot.pack, &pack, sizeof(SHM_PACK));
+  slot.seq.store(seq + 2, std::memory_order_release);
+}
+
+// reader side, false if the slot does not exist or stayed busy for shmRetries copies
+inline bool shmRead(const SHM_SEGMENT *seg, uint8_t idx, SHM_PACK &out) {
+  if (idx >= seg->packs) return false;
+  const SHM_SLOT &slot = seg->slot[idx];
+  for (uint16_t tries = 0; tries < shmRetries; tries++) {
+    uint32_t before = slot.seq.load(std::memory_order_acquire);
+    if (before & 1) continue;
+    memcpy(&out, (const void *) &slot.pack, sizeof(SHM_PACK));
+    std::atomic_thread_fence(std::memory_order_acquire);    // the copy completes before the second load
+    if (slot.seq.load(std::memory_order_relaxed) == before) return true;
+  }
+  return false;
+}
+
+SHM_SEGMENT *shmCreate(const char *name);   // daemon: create or reset the segment, nullptr on failure
+SHM_SEGMENT *shmOpen(const char *name);     // reader: map read-only, nullptr if missing or another version
+void         shmClose(SHM_SEGMENT *seg);
+void         shmRemove(const char *name);
+
+#endif
@@ -0,0 +1,316 @@
+// pmd, the packmonitor host daemon. Owns the I2C bus, polls every pack with the
+// batched reads of PackPoller and publishes the latest frame of each pack into
+// the shared-memory segment described in pm_shm.h, so local consumers read
+// pack state without a syscall and without parsing the ASCII registers of
+// registers.md themselves. Sets the pack clocks (0x60) at start and hourly.
+//
+//   g++ -O2 -Isrc -Ihost host/pmd.cpp host/pm_*.cpp src/pm_codec.cpp -o pmd
+//   ./pmd -b /dev/i2c-1 37 39@70:0 39@70:1       # packs as addr[@mux:channel], hex
+//   ./pmd --sim -c 10 37 39@70:2                 # simulated packs, see pm_host_sim.h
+//   ./pmd --read                                 # dump the segment as JSON
+//   ./pmd -b /dev/i2c-1 -c 1 --log 0 37          # then the log from the oldest block, see pm_logreader.h
+//
+// With --log the passes are followed by a readout of every pack's telemetry
+// log, from the given block number or 0 for the oldest, printed as JSON.
+//
+// Without -i a pass runs as often as the busiest pack makes a new snapshot,
+// which the packs report in 0x20 and lower while they are at rest.
+//
+// Against the firmware itself, its receiveEvent() and requestEvent() serving
+// the reads and loop() running between passes (see pm_host_firmware.h):
+//
+//   g++ -O2 -DPM_NATIVE -DI2C_SLAVE_ADDR=0x37 -Isrc/native -Isrc -Ihost
+//       host/pmd.cpp host/pm_*.cpp src/*.cpp src/native/pm_native_hal.cpp -o pmd_fw -lm
+//   ./pmd_fw --firmware -i 1000 -c 30
+//   ./pmd_fw --firmware -i 1000 -c 600 --log 0  # the log after ten minutes, a sample per 120s
+
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <memory>
+#include <vector>
+#include "pm_poller.h"
+#include "pm_logreader.h"
+#include "pm_shm.h"
+#include "pm_host_sim.h"
+#ifdef PM_NATIVE
+#include "pm_host_firmware.h"
+#endif
+
+static const uint32_t      pmdIntervalMs = 1000;            // until the packs report their snapshot interval
+static const uint32_t      pmdMinMs      = 20;
+static const uint32_t      pmdClockSecs  = 3600;            // 0x60 again after this long
+static const uint8_t       pmdRateExtra  = 3;               // index of 0x20 in pmdExtra
+static const POLL_REGISTER pmdExtra[]    = { { 0x7B, 4, false }, { 0x7C, 4, false }, { 0x7D, 2, false },   // SOC, remaining, time to empty
+                                             { 0x20, 2, false } };                                         // snapshot interval
+
+static volatile sig_atomic_t pmdStop = 0;
+
+static void onSignal(int) {
+  pmdStop = 1;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: pmd (-b /dev/i2c-N | --sim"
+#ifdef PM_NATIVE
+          " | --firmware"
+#endif
+          ") [-n name] [-i ms] [-c passes] [--pec] [--log seq] addr[@mux:ch] ...\n"
+          "       pmd --read [-n name]\n");
+}
+
+// "39" or "39@70:2", hex like the register map
+static bool parseTarget(const char *arg, POLL_TARGET &t) {
+  unsigned addr, mux = pollNoMux, channel = 0;
+  int      used = 0, more = 0;
+  if (sscanf(arg, "%x%n", &addr, &used) != 1) return false;
+  if (arg[used] == '@') {
+    if (sscanf(arg + used, "@%x:%u%n", &mux, &channel, &more) != 2) return false;
+    used += more;
+  }
+  if (arg[used] || addr < 0x08 || addr > 0x77) return false;
+  if (mux != pollNoMux && (mux < pollMuxFirst || mux >= pollMuxFirst + pollMuxCount || channel > 3)) return false;
+  t = { (uint8_t) addr, (uint8_t) mux, (uint8_t) channel };
+  return true;
+}
+
+static uint64_t monotonicUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int readSegment(const char *name) {
+  SHM_SEGMENT *seg = shmOpen(name);
+  if (!seg) {
+    fprintf(stderr, "pmd: no segment %s\n", name);
+    return 1;
+  }
+  uint64_t now = monotonicUs();
+  printf("{\"daemon_pid\": %u, \"passes\": %u, \"packs\": [\n", seg->daemonPid, seg->passes.load(std::memory_order_acquire));
+  for (uint8_t x = 0; x < seg->packs; x++) {
+    SHM_PACK pack;
+    if (!shmRead(seg, x, pack)) {
+      printf("  {\"slot\": %u, \"busy\": true}%s\n", x, x + 1 < seg->packs ? "," : "");
+      continue;
+    }
+    const PM_SNAPSHOT &s = pack.snapshot;
+    printf("  {\"addr\": \"0x%02X\", \"mux\": \"0x%02X\", \"channel\": %u, \"valid\": %s, \"errors\": %u, \"age_ms\": %lld, "
+           "\"seq\": %u, \"timestamp\": %u, \"current_ma\": %d, \"pack_mv\": %u, \"bus_mv\": %u, "
+           "\"t_cdeg\": [%d, %d, %d], \"coulomb\": %d, \"status\": [%u, %u], \"extra\": {",
+           pack.addr, pack.mux, pack.channel, pack.valid ? "true" : "false", pack.errors,
+           pack.valid ? (long long) (now - pack.stampUs) / 1000 : -1LL,
+           s.seq, s.timestamp, s.current, s.packVoltage, s.busVoltage, s.t0, s.t1, s.t2, s.coulomb, s.status0, s.status1);
+    for (uint8_t e = 0; e < seg->extras; e++) {
+      printf("\"0x%02X\": %d%s", seg->extraReg[e], pack.extra[e], e + 1 < seg->extras ? ", " : "");
+    }
+    printf("}}%s\n", x + 1 < seg->packs ? "," : "");
+  }
+  printf("]}\n");
+  shmClose(seg);
+  return 0;
+}
+
+// stamps go out in CLOCK_MONOTONIC whatever clock the bus keeps, simulated buses included
+static void publish(SHM_SEGMENT *seg, const PackPoller &poller, HostBus &bus) {
+  uint64_t busNow = bus.nowUs();
+  uint64_t now    = monotonicUs();
+  for (uint8_t x = 0; x < poller.packCount(); x++) {
+    const PACK_TELEMETRY &entry = poller.pack(x);
+    SHM_PACK              pack;
+    pack.addr     = entry.target.addr;
+    pack.mux      = entry.target.mux;
+    pack.channel  = entry.target.channel;
+    pack.valid    = entry.valid;
+    pack.errors   = entry.errors;
+    pack.stampUs  = entry.valid ? now - (busNow - entry.stampUs) : 0;
+    pack.snapshot = entry.snapshot;
+    memcpy(pack.extra, entry.extra, sizeof(pack.extra));
+    shmWrite(seg, x, pack);
+  }
+  seg->passes.fetch_add(1, std::memory_order_release);
+}
+
+// poll as often as the busiest pack makes new snapshots, nothing is gained by polling faster
+static uint32_t cadenceMs(const PackPoller &poller) {
+  uint32_t ms = 0;
+  for (uint8_t x = 0; x < poller.packCount(); x++) {
+    const PACK_TELEMETRY &entry = poller.pack(x);
+    uint32_t              pack  = (uint32_t) entry.extra[pmdRateExtra];
+    if (entry.extraStampUs[pmdRateExtra] && pack && (!ms || pack < ms)) ms = pack;
+  }
+  if (!ms) return pmdIntervalMs;
+  return ms < pmdMinMs ? pmdMinMs : ms;
+}
+
+// wall time to the millisecond, the packs measure their oscillator drift between these
+static void setClocks(PackPoller &poller) {
+  struct timespec ts;
+  char            text[24];
+  clock_gettime(CLOCK_REALTIME, &ts);
+  snprintf(text, sizeof(text), "%lu.%03lu", (unsigned long) ts.tv_sec, (unsigned long) (ts.tv_nsec / 1000000));
+  uint8_t acked = poller.command(0x60, text);
+  if (acked < poller.packCount()) fprintf(stderr, "pmd: clock set on %u of %u packs\n", acked, poller.packCount());
+}
+
+// every pack's log from block seq as JSON, one record per sample or event
+static void dumpLogs(PackPoller &poller, uint16_t seq) {
+  PackLogReader reader(poller);
+  printf("{\"packs\": [\n");
+  for (uint8_t x = 0; x < poller.packCount(); x++) {
+    const POLL_TARGET      &t = poller.pack(x).target;
+    std::vector<LOG_RECORD> records;
+    uint32_t                bad    = reader.badBlocks();
+    int                     blocks = reader.drain(x, seq, records);
+    printf("  {\"addr\": \"0x%02X\", \"mux\": \"0x%02X\", \"channel\": %u, \"blocks\": %d, \"bad_blocks\": %u, \"newest\": %u, \"records\": [",
+           t.addr, t.mux, t.channel, blocks, reader.badBlocks() - bad, blocks > 0 ? reader.newest() : 0);
+    for (size_t r = 0; r < records.size(); r++) {
+      const LOG_RECORD &rec = records[r];
+      printf("%s\n    {\"block\": %u, \"time\": %u, ", r ? "," : "", rec.block, rec.time);
+      if (rec.event) {
+        printf("\"event\": %u, \"value\": %u}", rec.event, rec.value);
+      } else {
+        printf("\"current_ma\": %d, \"pack_mv\": %d, \"temp_mdeg\": %d}", rec.currentMa, rec.packMv, rec.tempMdeg);
+      }
+    }
+    printf("%s]}%s\n", records.empty() ? "" : "\n  ", x + 1 < poller.packCount() ? "," : "");
+  }
+  printf("]}\n");
+}
+
+int main(int argc, char **argv) {
+  enum { optSim = 1, optFirmware, optPec, optRead, optLog };
+  static const struct option longOpts[] = {
+    { "bus",      required_argument, nullptr, 'b' },
+    { "name",     required_argument, nullptr, 'n' },
+    { "interval", required_argument, nullptr, 'i' },
+    { "count",    required_argument, nullptr, 'c' },
+    { "sim",      no_argument,       nullptr, optSim },
+    { "firmware", no_argument,       nullptr, optFirmware },
+    { "pec",      no_argument,       nullptr, optPec },
+    { "read",     no_argument,       nullptr, optRead },
+    { "log",      required_argument, nullptr, optLog },
+    { nullptr,    0,                 nullptr, 0 },
+  };
+
+  const char *device     = nullptr;
+  const char *name       = shmDefault;
+  uint32_t    intervalMs = 0;               // 0 follows the packs, see cadenceMs()
+  uint32_t    passes     = 0;               // 0 runs until a signal
+  bool        sim = false, firmware = false, pec = false, read = false, logDump = false;
+  uint16_t    logSeq     = 0;               // --log, 0 for the oldest block held
+  int         opt;
+  while ((opt = getopt_long(argc, argv, "b:n:i:c:", longOpts, nullptr)) != -1) {
+    switch (opt) {
+      case 'b':         device = optarg; break;
+      case 'n':         name = optarg; break;
+      case 'i':         intervalMs = strtoul(optarg, nullptr, 10); break;
+      case 'c':         passes = strtoul(optarg, nullptr, 10); break;
+      case optSim:      sim = true; break;
+      case optFirmware: firmware = true; break;
+      case optPec:      pec = true; break;
+      case optRead:     read = true; break;
+      case optLog:      logDump = true; logSeq = strtoul(optarg, nullptr, 10); break;
+      default:          usage(); return 2;
+    }
+  }
+  if (read) return readSegment(name);
+
+  std::vector<POLL_TARGET> targets;
+  for (int a = optind; a < argc; a++) {
+    POLL_TARGET t;
+    if (!parseTarget(argv[a], t)) {
+      fprintf(stderr, "pmd: bad pack %s\n", argv[a]);
+      return 2;
+    }
+    targets.push_back(t);
+  }
+
+  std::unique_ptr<HostBus>                  bus;
+  std::vector<std::unique_ptr<HostSimPack>> simPacks;
+  if (sim) {
+    if (targets.empty()) targets.push_back({ 0x37, pollNoMux, 0 });
+    HostSimBus *simBus = new HostSimBus();
+    for (const POLL_TARGET &t : targets) {
+      HostSimPack *pack = new HostSimPack(t.addr);
+      int32_t      n    = (int32_t) simPacks.size();
+      pack->pec               = pec;
+      pack->frame.current     = -2000 - 100 * n;
+      pack->frame.packVoltage = 13200 + n;
+      pack->frame.busVoltage  = 13100 + n;
+      pack->frame.t0          = 2500;
+      pack->set(0x7B, 4, 75000 - 1000 * n);
+      pack->set(0x7C, 4, 75000 - 1000 * n);
+      pack->set(0x7D, 2, 2250 - 30 * n);
+      pack->set(0x20, 2, 500);
+      simBus->attach(pack, t.mux, t.channel);
+      simPacks.emplace_back(pack);
+    }
+    bus.reset(simBus);
+#ifdef PM_NATIVE
+  } else if (firmware) {
+    if (targets.empty()) targets.push_back({ HostFirmwareBus::address(), pollNoMux, 0 });
+    bus.reset(new HostFirmwareBus());
+#else
+  } else if (firmware) {
+    fprintf(stderr, "pmd: --firmware needs a PM_NATIVE build with the firmware sources\n");
+    return 2;
+#endif
+  } else if (device) {
+#ifdef __linux__
+    HostI2cDev *dev = new HostI2cDev(device);
+    bus.reset(dev);
+    if (!dev->isOpen()) {
+      fprintf(stderr, "pmd: %s: %s\n", device, strerror(errno));
+      return 1;
+    }
+#endif
+  }
+  if (!bus || targets.empty() || targets.size() > shmPacksMax) {
+    usage();
+    return 2;
+  }
+
+  PackPoller poller(*bus);
+  poller.setPec(pec);
+  for (const POLL_TARGET &t : targets) poller.addPack(t.addr, t.mux, t.channel);
+  for (const POLL_REGISTER &reg : pmdExtra) poller.addRegister(reg.reg, reg.width, reg.isSigned);
+
+  SHM_SEGMENT *seg = shmCreate(name);
+  if (!seg) {
+    fprintf(stderr, "pmd: cannot create %s: %s\n", name, strerror(errno));
+    return 1;
+  }
+  seg->extras = sizeof(pmdExtra) / sizeof(pmdExtra[0]);
+  for (uint8_t e = 0; e < seg->extras; e++) seg->extraReg[e] = pmdExtra[e].reg;
+  seg->packs = poller.packCount();
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  uint64_t clockAt = bus->nowUs();
+  setClocks(poller);
+  bus->waitUs((intervalMs ? intervalMs : pmdIntervalMs) * 1000ULL);   // let the packs run the command before the first read
+  for (uint32_t pass = 0; !pmdStop && (!passes || pass < passes); pass++) {
+    uint64_t start = bus->nowUs();
+    if (start - clockAt >= pmdClockSecs * 1000000ULL) {
+      setClocks(poller);
+      clockAt = start;
+    }
+    poller.refresh();
+    publish(seg, poller, *bus);
+
+    uint64_t spent  = bus->nowUs() - start;
+    uint64_t period = (intervalMs ? intervalMs : cadenceMs(poller)) * 1000ULL;
+    if (spent < period) bus->waitUs(period - spent);
+  }
+  if (logDump) dumpLogs(poller, logSeq);
+
+  shmClose(seg);
+  return 0;
+}
@@ -2,23 +2,34 @@
 #include <Wire.h>
 #include <packmonlib.h>
 #include <time.h>
-#include <TimeLib.h>
 #include "pm_pins.h"
 #include "pm_struct.h"
+#include "pm_adc.h"
+#include "pm_registers.h"
+#include "pm_snapshot.h"
+#include "pm_buffers.h"
+#include "pm_fram.h"
+#include "pm_journal.h"
+#include "pm_coulomb.h"
+#include "pm_calib.h"
+#include "pm_nau7802.h"
+#include "pm_bench.h"
+#include "pm_profile.h"
+#include "pm_sched.h"
+#include "pm_protect.h"
+#include "pm_stats.h"
+#include "pm_therm.h"
+#include "pm_log.h"
+#include "pm_soc.h"
+#include "pm_rate.h"
+#include "pm_power.h"
+#include "pm_clock.h"
 
-volatile bool unknownCmd       = false;                  // flag indicating unknown command received
-volatile bool txtmsgWaiting    = false;                  // flag indicating message from master is waiting
 volatile bool reqEvnt          = false;                  // flag set when the requestEvent ISR fires
 volatile bool recvEvnt         = false;                  // flag set when the receiveEvent ISR fires
 volatile bool mastersetTime    = false;                  // flag that is set when master has sent time
-volatile bool txdataReady      = false;                  // flag that is set when data is ready to send to master
-volatile bool purgeTXBuffer    = true;                   // tell loop() to clear the TX buffer
-volatile bool purgeRXBuffer    = true;                   // tell loop() to clear the RX buffer
-volatile char txtMessage[50];                            // alternate buffer for message from master
 
-volatile uint8_t messageLen    = 0;                      // message from master length
-volatile time_t lasttimeSync   = 0;                      // when's the last time master sent us time?
-volatile time_t firsttimeSync  = 0;                      // record the timestamp after boot
+volatile ADC_DATA adcDataBuffer[adcBufferSize];          // converted adc readings, see pm_struct.h
 
 #ifdef MEGACOREX
 #pragma message "Compiled using MegaCoreX!"
@@ -43,6 +54,9 @@ volatile time_t firsttimeSync  = 0;                      // record the timestamp
 #elif MCU_AVR128DA32
 #pragma message "Compiling for AVR128DA32"
 #define SERIALBAUD 921600
+#elif PM_NATIVE
+#pragma message "Compiling for native, see src/native"
+#define SERIALBAUD 115200
 #else
 #define SERIALBAUD 115200
 #pragma message "Compiling for Unknown MCU"
@@ -51,591 +65,532 @@ volatile time_t firsttimeSync  = 0;                      // record the timestamp
 PackMonLib toolbox();
 
 char buff[200];
+char    idleReply[20];                                   // sent when the master reads without a pending reply
+uint8_t idleReplyLen = 0;
 
-// function to eventually save data to on board FRAM
-void writeFRAMuint(uint8_t myAddr, uint32_t myData) { 
+FramI2C framDevice(Wire);                                // FM24C64B, see setup() for the bus wiring
+NauI2C  nauDevice(Wire);                                 // NAU7802, shares the master bus with the FRAM
 
+// save data to on board FRAM, lands in the RAM copy until the next framFlush()
+void writeFRAMuint(uint8_t myAddr, uint32_t myData) { 
+  framWrite32(myAddr, myData);
 }
 
 void writeFRAMint(uint8_t myAddr, int32_t myData) { 
-
+  framWrite32(myAddr, (uint32_t) myData);
 }
 
 // function to read byte from FRAM
 uint8_t readFRAMbyte(uint8_t myAddr) { 
-
+  return (uint8_t) framRead32(myAddr);
 }
 
 // function to read uint from FRAM
 uint32_t readFRAMuint(uint8_t myAddr) { 
-  uint32_t framData = 0;
-  if (myAddr==0x39) { // pack voltage
-    framData = adcDataBuffer[2].adcRaw;
-  } else if (myAddr==0x3E) { // bus voltage
-    framData = adcDataBuffer[1].adcRaw;
-  } else if (myAddr==0x33) { // active current
-    framData = adcDataBuffer[0].adcRaw;
-  }
-  return framData;
+  return framRead32(myAddr);
 }
 
-// function to read uint from FRAM (eventually)
-float readFRAMfloat(uint8_t myAddr) { 
-  float framData = 0.0;
+// live readings in milli-units, these never hit the FRAM
+int32_t readLiveMilli(uint8_t myAddr) { 
+  int32_t liveData = 0;
   if (myAddr==0x39) { // pack voltage
-    framData = adcDataBuffer[2].Volts;
+    liveData = adcDataBuffer[2].milli;
   } else if (myAddr==0x3E) { // bus voltage
-    framData = adcDataBuffer[1].Volts;
+    liveData = adcDataBuffer[1].milli;
   } else if (myAddr==0x33) { // active current
-    framData = adcDataBuffer[0].Amps;
+    liveData = adcDataBuffer[0].milli;
+  } else if (myAddr==0x4C) { // precision current
+    liveData = adcDataBuffer[3].milli;
+  } else if (myAddr==0x41) { // T0
+    liveData = adcDataBuffer[4].milli;
+  } else if (myAddr==0x44) { // T1
+    liveData = adcDataBuffer[5].milli;
+  } else if (myAddr==0x4E) { // T2
+    liveData = adcDataBuffer[6].milli;
   }
-  return framData;
+  return liveData;
 }
 
 
 // function to read ulong from FRAM
 uint32_t readFRAMulong(uint8_t myAddr) { 
-
+  return framRead32(myAddr);
 }
 
 // function to read int from FRAM
-int16_t readFRAMint(uint8_t myAddr) { 
-
+int32_t readFRAMint(uint8_t myAddr) { 
+  return (int32_t) framRead32(myAddr);
 }
 
-long readADC(uint8_t adcPin, uint8_t noSamples) {
-  uint32_t adcResult = 0;
-  int      sample    = 0;
-  uint8_t  adcX      = 0;
-// #ifdef MCU_NANOEVERY
-//   analogReference(INTERNAL4V3);  // enable interal 4.3v reference on the Every
-// #endif
-
-  for (int x=0; x < noSamples; x++) {
-    sample = analogRead(adcPin);                    // sample adc pin
-    adcResult = adcResult + sample;                 // add sample for averaging
-    delayMicroseconds(250);
-  }
-  
-  adcResult = adcResult / noSamples;
-  
-  return (long) adcResult;
+// factory defaults from registers.md, loaded when the FRAM header is blank or from an older layout
+void loadFRAMDefaults() {
+  writeFRAMuint(0x21, 10000);               // high current limit, 10a
+  writeFRAMuint(0x22, 45000);               // high temp limit, 45c
+  writeFRAMint(0x23, 0);                    // low temp limit, 0c
+  writeFRAMuint(0x24, 14800);               // high voltage limit
+  writeFRAMuint(0x25, 10800);               // low voltage limit
+  writeFRAMuint(0x29, 0x69);                // config0: over-current, over-temp, under-voltage, status leds
 }
 
-void clearTXBuffer() {
-  uint16_t myPtr = 0;
-  while (myPtr < txBufferSize) {
-    txData.cmdData[myPtr] = '\0';
-    myPtr++;
+// register getters for the response cache, each returns the value in milli-units
+static int32_t regFramByte(uint8_t reg)  { return readFRAMbyte(reg); }
+static int32_t regFramUint(uint8_t reg)  { return readFRAMuint(reg); }
+static int32_t regFramInt(uint8_t reg)   { return readFRAMint(reg); }
+static int32_t regFramUlong(uint8_t reg) { return readFRAMulong(reg); }
+static int32_t regLiveMilli(uint8_t reg) { return readLiveMilli(reg); }
+static int32_t regClock(uint8_t reg)     { return clockRead(reg); }
+static int32_t regProfile(uint8_t reg)   { return profileRead(reg); }
+static int32_t regStats(uint8_t reg)     { return statsRead(reg); }
+static int32_t regLog(uint8_t reg)       { return logRead(reg); }
+static int32_t regSoc(uint8_t reg)       { return socRead(reg); }
+static int32_t regRate(uint8_t reg)      { return rateRead(reg); }
+static int32_t regPower(uint8_t reg)     { return powerRead(reg); }
+static int32_t regSchedMiss(uint8_t reg);
+
+// dense dispatch table, one entry per register from regFirst to regLast
+// registers without an ascii format are commands, queued for executeCommand()
+constexpr REG_ENTRY regTable[regCount] PROGMEM = {
+  { 0x1D, REG_U16,  ASC_INT,   regClock     },  // current timestamp, ms part, read with 0x62
+  { 0x1E, REG_I32,  ASC_LONG,  regClock     },  // clock drift correction, ppb
+  { 0x1F, REG_U32,  ASC_LONG,  regPower     },  // awake duty cycle, milli-percent out of standby
+  { 0x20, REG_U16,  ASC_INT,   regRate      },  // snapshot interval, ms
+  { 0x21, REG_U16,  ASC_NONE,  regFramUint  },  // high current limit, mA
+  { 0x22, REG_U16,  ASC_NONE,  regFramUint  },  // high temp limit, mdegC
+  { 0x23, REG_I16,  ASC_NONE,  regFramInt   },  // low temp limit, mdegC
+  { 0x24, REG_U16,  ASC_NONE,  regFramUint  },  // high voltage limit, mV
+  { 0x25, REG_U16,  ASC_NONE,  regFramUint  },  // low voltage limit, mV
+  { 0x26, REG_NONE, ASC_NONE,  nullptr      },  // set config0
+  { 0x27, REG_NONE, ASC_NONE,  nullptr      },  // set config1
+  { 0x28, REG_NONE, ASC_NONE,  nullptr      },  // set config2
+  { 0x29, REG_U8,   ASC_BYTE,  regFramByte  },  // config0
+  { 0x2A, REG_U8,   ASC_BYTE,  regFramByte  },  // config1
+  { 0x2B, REG_U8,   ASC_BYTE,  regFramByte  },  // config2
+  { 0x2C, REG_U8,   ASC_BYTE,  regFramByte  },  // status0
+  { 0x2D, REG_U8,   ASC_BYTE,  regFramByte  },  // status1
+  { 0x2E, REG_NONE, ASC_NONE,  nullptr      },  // diagnostic LED4 off
+  { 0x2F, REG_NONE, ASC_NONE,  nullptr      },  // diagnostic LED4 on
+  { 0x30, REG_NONE, ASC_NONE,  nullptr      },  // clear coulomb counter
+  { 0x31, REG_I32,  ASC_LONG,  regFramInt   },  // coulomb counter
+  { 0x32, REG_NONE, ASC_NONE,  nullptr      },  // clear total amps counters
+  { 0x33, REG_I32,  ASC_FLOAT, regLiveMilli },  // load current, mA
+  { 0x34, REG_U32,  ASC_LONG,  regFramUlong },  // total amps in
+  { 0x35, REG_U32,  ASC_LONG,  regFramUlong },  // total amps out
+  { 0x36, REG_U32,  ASC_LONG,  regFramUlong },  // lifetime amps in
+  { 0x37, REG_U32,  ASC_LONG,  regFramUlong },  // lifetime amps out
+  { 0x38, REG_NONE, ASC_NONE,  nullptr      },  // clear voltage memory
+  { 0x39, REG_U16,  ASC_FLOAT, regLiveMilli },  // pack voltage, mV
+  { 0x3A, REG_U16,  ASC_INT,   regFramUlong },  // lowest voltage, mV
+  { 0x3B, REG_U32,  ASC_LONG,  regFramUlong },  // lowest voltage timestamp
+  { 0x3C, REG_U16,  ASC_INT,   regFramUlong },  // highest voltage, mV
+  { 0x3D, REG_U32,  ASC_LONG,  regFramUlong },  // highest voltage timestamp
+  { 0x3E, REG_U16,  ASC_FLOAT, regLiveMilli },  // bus voltage, mV
+  { 0x3F, REG_NONE, ASC_NONE,  nullptr      },  // diag message from master
+  { 0x40, REG_NONE, ASC_NONE,  nullptr      },  // clear temperature memories
+  { 0x41, REG_I32,  ASC_INT,   regLiveMilli },  // T0, mdegC
+  { 0x42, REG_I32,  ASC_INT,   regFramInt   },  // T0 lowest
+  { 0x43, REG_I32,  ASC_INT,   regFramInt   },  // T0 highest
+  { 0x44, REG_I32,  ASC_INT,   regLiveMilli },  // T1, mdegC
+  { 0x45, REG_I32,  ASC_INT,   regFramInt   },  // T1 lowest
+  { 0x46, REG_I32,  ASC_INT,   regFramInt   },  // T1 highest
+  { 0x47, REG_U32,  ASC_LONG,  regFramUlong },  // T0 lowest timestamp
+  { 0x48, REG_U32,  ASC_LONG,  regFramUlong },  // T1 lowest timestamp
+  { 0x49, REG_U32,  ASC_LONG,  regFramUlong },  // T0 highest timestamp
+  { 0x4A, REG_U32,  ASC_LONG,  regFramUlong },  // T1 highest timestamp
+  { 0x4B, REG_NONE, ASC_NONE,  nullptr      },  // telemetry snapshot, always binary
+  { 0x4C, REG_I32,  ASC_FLOAT, regLiveMilli },  // precision current, mA
+  { 0x4D, REG_U8,   ASC_NONE,  regFramByte  },  // set precision adc config
+  { 0x4E, REG_I32,  ASC_INT,   regLiveMilli },  // T2, mdegC
+  { 0x4F, REG_I32,  ASC_INT,   regFramInt   },  // T2 lowest
+  { 0x50, REG_NONE, ASC_NONE,  nullptr      },  // clear disconnect history
+  { 0x51, REG_U16,  ASC_INT,   regFramUint  },  // over-current disconnects
+  { 0x52, REG_U16,  ASC_INT,   regFramUint  },  // under-voltage disconnects
+  { 0x53, REG_U16,  ASC_INT,   regFramUint  },  // over-voltage disconnects
+  { 0x54, REG_U16,  ASC_INT,   regFramUint  },  // under-temp disconnects
+  { 0x55, REG_U16,  ASC_INT,   regFramUint  },  // over-temp disconnects
+  { 0x56, REG_U32,  ASC_LONG,  regFramUlong },  // last disconnect timestamp
+  { 0x57, REG_U8,   ASC_BYTE,  regFramByte  },  // last disconnect reason
+  { 0x58, REG_U16,  ASC_NONE,  regFramUlong },  // set current zero offset, lsb
+  { 0x59, REG_U32,  ASC_NONE,  regFramUlong },  // set current gain, Q16 mA per lsb
+  { 0x5A, REG_U32,  ASC_NONE,  regFramUlong },  // set bus voltage gain, Q16 mV per lsb
+  { 0x5B, REG_U32,  ASC_NONE,  regFramUlong },  // set pack voltage gain, Q16 mV per lsb
+  { 0x5C, REG_U8,   ASC_NONE,  regStats     },  // set statistics channel
+  { 0x5D, REG_I32,  ASC_LONG,  regStats     },  // statistics mean
+  { 0x5E, REG_U32,  ASC_LONG,  regStats     },  // statistics standard deviation
+  { 0x5F, REG_I32,  ASC_INT,   regFramInt   },  // T2 highest
+  { 0x60, REG_NONE, ASC_NONE,  nullptr      },  // set time
+  { 0x61, REG_U32,  ASC_LONG,  regClock     },  // first-init timestamp
+  { 0x62, REG_U32,  ASC_LONG,  regClock     },  // current timestamp
+  { 0x63, REG_U32,  ASC_LONG,  regClock     },  // time since last sync
+  { 0x64, REG_U32,  ASC_LONG,  regClock     },  // uptime
+  { 0x65, REG_U32,  ASC_LONG,  regProfile   },  // receiveEvent max, ns
+  { 0x66, REG_U32,  ASC_LONG,  regProfile   },  // receiveEvent average, ns
+  { 0x67, REG_U32,  ASC_LONG,  regProfile   },  // requestEvent max, ns
+  { 0x68, REG_U32,  ASC_LONG,  regProfile   },  // requestEvent average, ns
+  { 0x69, REG_U32,  ASC_LONG,  regProfile   },  // adc isr max, ns
+  { 0x6A, REG_U32,  ASC_LONG,  regProfile   },  // adc isr average, ns
+  { 0x6B, REG_U32,  ASC_LONG,  regProfile   },  // longest loop() period, us
+  { 0x6C, REG_U16,  ASC_INT,   regProfile   },  // adc conversions per second
+  { 0x6D, REG_U16,  ASC_INT,   regProfile   },  // unknown commands
+  { 0x6E, REG_U16,  ASC_INT,   regProfile   },  // rx queue overruns
+  { 0x6F, REG_U16,  ASC_INT,   regProfile   },  // dropped requests
+  { 0x70, REG_NONE, ASC_NONE,  nullptr      },  // clear profiling counters
+  { 0x71, REG_U16,  ASC_INT,   regSchedMiss },  // acquisition task deadline misses
+  { 0x72, REG_U16,  ASC_INT,   regSchedMiss },  // integration task deadline misses
+  { 0x73, REG_U16,  ASC_INT,   regSchedMiss },  // fram flush task deadline misses
+  { 0x74, REG_U16,  ASC_INT,   regSchedMiss },  // status led task deadline misses
+  { 0x75, REG_U16,  ASC_INT,   regSchedMiss },  // heartbeat task deadline misses
+  { 0x76, REG_U16,  ASC_INT,   regSchedMiss },  // protection task deadline misses
+  { 0x77, REG_U16,  ASC_NONE,  regLog       },  // set log cursor
+  { 0x78, REG_NONE, ASC_NONE,  nullptr      },  // log readout, always binary
+  { 0x79, REG_U16,  ASC_INT,   regLog       },  // newest log block
+  { 0x7A, REG_U16,  ASC_NONE,  regLog       },  // set log interval, s
+  { 0x7B, REG_U32,  ASC_LONG,  regSoc       },  // state of charge, milli-percent
+  { 0x7C, REG_U32,  ASC_LONG,  regSoc       },  // remaining charge, mAh
+  { 0x7D, REG_U16,  ASC_INT,   regSoc       },  // time to empty, minutes
+  { 0x7E, REG_U32,  ASC_NONE,  regSoc       },  // set design capacity, mAh
+  { 0x7F, REG_U32,  ASC_LONG,  regSoc       },  // state of health, milli-percent
+};
+static_assert(regTableOrdered(regTable, regCount), "regTable must list every register from regFirst to regLast in order");
+static_assert(regAsciiCount(regTable, regCount, ASC_FLOAT) <= regFloatSlots, "raise regFloatSlots");
+
+// averaged readings to milli-units for every channel
+void convertFrame() {
+  for (uint8_t ch = 0; ch < adcFastChannels; ch++) {
+    uint16_t rawAdc = adcAverage(ch);
+    adcDataBuffer[ch].adcRaw = rawAdc;
+    adcDataBuffer[ch].milli  = calToMilli(ch, rawAdc);    // integer multiply-shift, see pm_calib.h
+  }
+  for (uint8_t t = 0; t < thermSensors; t++) {            // after the precision current in adcDataBuffer
+    uint16_t rawAdc = adcAverage(adcThermFirst + t);
+    adcDataBuffer[4 + t].adcRaw = rawAdc;
+    adcDataBuffer[4 + t].milli  = thermToMilli(rawAdc);   // table lookup, see pm_therm.h
   }
-  purgeTXBuffer = false;
 }
 
-void clearRXBuffer() {
-  uint16_t myPtr = 0;
-  rxData.cmdAddr = 0;
-  while (myPtr < rxBufferSize) {
-    rxData.cmdData[myPtr] = '\0';
-    myPtr++;
-  }
-  purgeTXBuffer = false;
+// gather the live values into one frame for the snapshot register
+void captureSnapshot() {
+  PM_SNAPSHOT frame;
+  frame.timestamp   = clockNow();
+  frame.current     = regLiveMilli(0x33);
+  frame.packVoltage = regLiveMilli(0x39);
+  frame.busVoltage  = regLiveMilli(0x3E);
+  frame.t0          = regLiveMilli(0x41) / 10;
+  frame.t1          = regLiveMilli(0x44) / 10;
+  frame.t2          = regLiveMilli(0x4E) / 10;
+  frame.coulomb     = readFRAMint(0x31);
+  frame.status0     = readFRAMbyte(0x2C);
+  frame.status1     = readFRAMbyte(0x2D);
+  snapshotPublish(frame);
 }
 
 // function that executes whenever data is requested by master
 // this function is registered as an event, see setup()
 void requestEvent() {   
-  char reqBuff[80];                          // master has requested data
-  if (txdataReady) {
-    Wire.write((char *) txData.cmdData, txData.dataLen);          // dump entire tx buffer to the bus, master will read as many bytes as it wants
-    txdataReady = false;                          // clear tx flag
-    // sprintf(reqBuff, "Request even triggered. Sent: %s", txData.cmdData);
-    // Serial.println(reqBuff);
+  uint16_t start = profileTicks();
+  const I2C_TX_DATA *reply = txTake();                            // front buffer, swapped in by the producer
+  if (reply) {
+    Wire.write(reply->cmdData, reply->dataLen);                   // master will read as many bytes as it wants
   } else {
-    sprintf((char) txData.cmdData,"Slave 0x%X ready!", I2C_SLAVE_ADDR);
-    Wire.write((char) txData.cmdData);                         // didn't have anything to send? respond with message of 6 bytes
-    // Serial.println((char) txData.cmdData);
+    Wire.write((uint8_t *) idleReply, idleReplyLen);              // didn't have anything to send? respond with ready message
+    profileDropped();
   }
   reqEvnt = true;                                 // set flag that we had this interaction
-  purgeTXBuffer=true;                                // purge TX buffer
+  profileEnd(PROF_REQUEST, start);
+}
+
+// answer or queue the command in the reserved rx slot, the body of receiveEvent() after the bytes are in
+// reads are answered from the response cache, everything else is queued for executeCommand()
+void receiveDispatch(I2C_RX_DATA &rxData) {
+  I2C_TX_DATA &txData = txBack();                                  // reply buffer requestEvent() is not sending from
+  uint8_t _isr_cmdAddr = rxData.cmdAddr;
+
+  if (_isr_cmdAddr == snapshotRegister) {                          // telemetry snapshot, already packed by loop()
+    txData.dataLen = snapshotCopy(txData.cmdData);
+  } else if (_isr_cmdAddr == logReadReg) {                         // next half block of the log, fetched by loop()
+    txData.dataLen = logCopyChunk(txData.cmdData);
+  } else if (_isr_cmdAddr & regBinaryFlag) {                       // binary reply, config1 bit 0 appends the SMBus PEC
+    txData.dataLen = regEncodeBinary(regTable, _isr_cmdAddr, I2C_SLAVE_ADDR, txData.cmdData);
+  } else {
+    txData.dataLen = regEncodeAscii(regTable, _isr_cmdAddr, txData.cmdData);
+  }
+
+  if (txData.dataLen) {
+    txPublish();                                                   // swap the reply in for requestEvent()
+  } else {
+    rxCommit();                                                    // not a read, loop() executes it
+  }
 }
 
 // function that executes whenever data is received from master
 // this function is registered as an event, see setup()
 void receiveEvent(size_t howMany) {
-  uint8_t   _isr_masterByte  = 0;
-  uint16_t  _isr_masterUint  = 0;
-  int16_t   _isr_masterInt   = 0;
-  uint32_t  _isr_masterUlong = 0;
-  int32_t   _isr_masterLong  = 0;
-  uint32_t  _isr_timeStamp   = 0;
+  if (!howMany) return;                                            // nothing to read, not even a command byte
+  uint16_t start = profileTicks();
 
+  I2C_RX_DATA &rxData = rxReserve();                               // free slot at the tail of the command queue
 
+  if (howMany > rxBufferSize) howMany = rxBufferSize;              // leave room for the terminating null
   Wire.readBytes( (uint8_t *) &rxData,  howMany);                  // transfer everything from buffer into memory
   rxData.dataLen = howMany - 1;                                    // save the data length for future use
-  // sprintf(buff, "RX cmd 0x%X plus %u data bytes\n", rxData.cmdAddr, rxData.dataLen);
-  // Serial.print(buff);
-  
-  rxData.cmdData[howMany] = '\0'; // set the Nth byte as a null
-  // for (int xx = 0; xx<howMany; xx++) {
-  //   Serial.print(rxData.cmdData[xx]);
-  // }
-  // Serial.println(" ");
+  rxData.cmdData[rxData.dataLen] = '\0';                           // terminate the string after the last data byte
 
   recvEvnt = true;                                                 // set event flag
-  uint8_t _isr_cmdAddr = rxData.cmdAddr;
-  
-  switch  (_isr_cmdAddr) {
+  receiveDispatch(rxData);
+  profileEnd(PROF_RECEIVE, start);
+}
+
+// record a settings change in the log, register and the low 24 bits of the new value
+static void logSetting(uint8_t reg) {
+  logEvent(LOG_EV_SETTING, ((uint32_t) reg << 24) | (framRead32(reg) & 0xFFFFFF));
+}
+
+// decimal limit for 0x21 to 0x25, false without digits or outside the range registers.md gives
+static bool parseLimit(const I2C_RX_DATA &cmd, long &value) {
+  if (!cmd.dataLen) return false;
+  char *end;
+  value = strtol(cmd.cmdData, &end, 10);
+  if (end == cmd.cmdData) return false;
+  switch (cmd.cmdAddr) {
+    case 0x23: return value >= -32768 && value <= 32767;         // low-temp, mdegC
+    case 0x24: return value >= 9600 && value <= 26000;           // high-voltage, mV
+    case 0x25: return value >= 600 && value <= 26000;            // low-voltage, mV
+  }
+  return value >= 0 && value <= 65535;
+}
+
+// execute a command queued by receiveEvent(), runs from loop() with interrupts enabled
+void executeCommand(const I2C_RX_DATA &cmd) {
+  long limit;
+  switch (cmd.cmdAddr) {
     case 0x00: // no command received
-      Serial.println("Address probe detected.");    
-    case 0x21: // high current limit, unsigned int
-      {
-        _isr_masterUint = atol(rxData.cmdData);
-        writeFRAMuint(rxData.cmdAddr, _isr_masterUint);
-      }
+      Serial.println("Address probe detected.");
       break;
+    case 0x21: // high current limit, unsigned int
     case 0x22: // high-temp limit, unsigned int
-      {
-        _isr_masterUint = atol(rxData.cmdData);
-         writeFRAMuint(rxData.cmdAddr, _isr_masterUint);
-      }
-      break;
-    case 0x23: // low-temp limit, signed int
-      {
-        _isr_masterInt = atoi(rxData.cmdData);
-        writeFRAMint(rxData.cmdAddr, _isr_masterInt);
-      }
-      break;
     case 0x24: // high-voltage limit, unsigned int
-      {
-        _isr_masterUint = atol(rxData.cmdData);
-        writeFRAMuint(rxData.cmdAddr, _isr_masterUint);
-      }
-      break;
     case 0x25: // low-voltage limit, unsigned int
-      {
-        _isr_masterUint = atol(rxData.cmdData);
-        writeFRAMuint(rxData.cmdAddr, _isr_masterUint);
+      if (parseLimit(cmd, limit)) {                               // a bare command byte or out of range keeps the limit
+        writeFRAMuint(cmd.cmdAddr, limit);
+        protectArm();                                             // new over-current threshold
+        logSetting(cmd.cmdAddr);
       }
       break;
-    case 0x26: // set config0, byte
-      {
-        _isr_masterByte = rxData.cmdData[0];
-        writeFRAMuint(rxData.cmdAddr, _isr_masterByte);
+    case 0x23: // low-temp limit, signed int
+      if (parseLimit(cmd, limit)) {
+        writeFRAMint(cmd.cmdAddr, limit);
+        logSetting(cmd.cmdAddr);
       }
       break;
+    case 0x26: // set config0, byte
     case 0x27: // set config1, byte
-      {
-        _isr_masterByte = rxData.cmdData[0];
-        writeFRAMuint(rxData.cmdAddr, _isr_masterByte);
-      }
-      break;
     case 0x28: // set config2, byte
-      {
-        _isr_masterByte = rxData.cmdData[0];
-        writeFRAMuint(rxData.cmdAddr, _isr_masterByte);
+      if (cmd.dataLen) {                                          // a bare command byte would clear every bit
+        writeFRAMuint(cmd.cmdAddr + 3, (uint8_t) cmd.cmdData[0]);  // stored under the matching read register
+        protectArm();
+        logSetting(cmd.cmdAddr + 3);
       }
       break;
-    case 0x29: // read config0, byte
-      {
-        _isr_masterByte = readFRAMbyte(rxData.cmdAddr);
-        txData.cmdData[0] = _isr_masterByte;                // store byte in outgoing buffer
-        txData.dataLen = 1;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
+    case 0x58: // current zero offset, unsigned int, 0 restores the build default
+    case 0x59: // current gain, Q16 unsigned long, 0 restores the build default
+    case 0x5A: // bus voltage gain, Q16 unsigned long
+    case 0x5B: // pack voltage gain, Q16 unsigned long
+      if (cmd.dataLen) {                                          // an ascii read arrives without data, not a reset
+        writeFRAMuint(cmd.cmdAddr, strtoul(cmd.cmdData, nullptr, 10));
+        calBegin();                                               // apply immediately
+        protectArm();
+        logSetting(cmd.cmdAddr);
       }
       break;
-    case 0x2A: // read config1, byte
-      {
-        _isr_masterByte = readFRAMbyte(rxData.cmdAddr);
-        txData.cmdData[0] = _isr_masterByte;                // store byte in outgoing buffer
-        txData.dataLen = 1;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
+    case 0x4D: // precision adc rate and gain, byte, 0 restores the build default
+      if (cmd.dataLen) {                                          // an ascii read arrives without data, not a reset
+        writeFRAMuint(cmd.cmdAddr, (uint8_t) cmd.cmdData[0]);
+        if (nauPresent()) nauConfigure(cmd.cmdData[0] ? cmd.cmdData[0] : nauConfigDefault);
+        logSetting(cmd.cmdAddr);
       }
       break;
-    case 0x2B: // read config2, byte
-      {
-        _isr_masterByte = readFRAMbyte(rxData.cmdAddr);
-        txData.cmdData[0] = _isr_masterByte;                // store byte in outgoing buffer
-        txData.dataLen = 1;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
+    case 0x5C: // statistics channel, byte
+      statsSelect((uint8_t) cmd.cmdData[0]);
       break;
-    case 0x2C: // read status1, byte
-      {
-        _isr_masterByte = readFRAMbyte(rxData.cmdAddr);
-        txData.cmdData[0] = _isr_masterByte;                // store byte in outgoing buffer
-        txData.dataLen = 1;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
+    case 0x77: // log cursor, unsigned int block number, 0 for the oldest
+      if (cmd.dataLen) logSeek(strtoul(cmd.cmdData, nullptr, 10));   // an ascii read arrives without data, not a rewind
       break;
-    case 0x2D: // read status2, byte
-      {
-        _isr_masterByte = readFRAMbyte(rxData.cmdAddr);
-        txData.cmdData[0] = _isr_masterByte;                // store byte in outgoing buffer
-        txData.dataLen = 1;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
+    case 0x78: // log read before loop() had the next block ready, the master got the idle reply
+      break;
+    case 0x7A: // log interval, unsigned int seconds, 0 restores the default
+      if (cmd.dataLen) logSetInterval(strtoul(cmd.cmdData, nullptr, 10));   // likewise, not a reset to the default
+      break;
+    case 0x7E: // design capacity, unsigned long mAh, 0 restores the build default
+      if (cmd.dataLen) {                                      // an ascii read arrives without data, not a reset
+        uint32_t mah = strtoul(cmd.cmdData, nullptr, 10);
+        socSetDesign(mah);                                    // learned capacity starts over from it
+        logEvent(LOG_EV_SETTING, ((uint32_t) cmd.cmdAddr << 24) | (mah & 0xFFFFFF));
       }
       break;
     case 0x2E: // diagnostic turn off LED4
-      {
-        digitalWrite(LED4, LOW);                            // turn off LED4
-      }
+      digitalWrite(LED4, LOW);
       break;
     case 0x2F: // diagnostic turn on LED4
-      {
-        digitalWrite(LED4, HIGH);                           // turn on LED4
-      }
+      digitalWrite(LED4, HIGH);
       break;
     case 0x30: // clear coul-counter, no data
-      { 
-        writeFRAMint(0x31, 0);
-      }
-      break;
-    case 0x31: // read coulomb counter, signed int
-      {
-        _isr_masterInt = readFRAMint(rxData.cmdAddr);
-        ltoa(_isr_masterInt, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
+      logEvent(LOG_EV_CLEAR, cmd.cmdAddr);
+      writeFRAMint(0x31, 0);
       break;
     case 0x32: // clear total amps counter, no data
-      { 
-        writeFRAMint(0x34, 0);
-        writeFRAMint(0x35, 0);
-      }
-      break;
-    case 0x33: // read instant amps, signed int
-      {
-        //_isr_masterInt = readFRAMint(rxData.cmdAddr);
-        //ltoa(_isr_masterInt, txData.cmdData, 10);           // store data as char string in tx buffer
-        float framData = readFRAMfloat(rxData.cmdAddr);
-        dtostrf(framData, 3, 2, txData.cmdData);
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x34: // read total amps in counter, unsigned long
-      {
-        _isr_masterUlong = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUlong, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
+      logEvent(LOG_EV_CLEAR, cmd.cmdAddr);
+      writeFRAMint(0x34, 0);
+      writeFRAMint(0x35, 0);
       break;
-    case 0x35: // read total amps out counter, unsigned long
-      {
-        _isr_masterUlong = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUlong, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
+    case 0x38: // clear voltage memory, no data
+      logEvent(LOG_EV_CLEAR, cmd.cmdAddr);
+      statsClear(STAT_PACK);
       break;
-    case 0x36: // read lifetime amps in, unsigned long
-      {
-        _isr_masterUlong = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUlong, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x37: // read lifetime amps out, ubsigned long 
-      {
-        _isr_masterUlong = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUlong, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x38: // clear voltage memory, no data returned
-      { 
-        writeFRAMint(0x3A, 0);
-        writeFRAMint(0x3B, 0);
-        writeFRAMint(0x3C, 0);
-        writeFRAMint(0x3D, 0);
-      }
-      break;
-    case 0x39: // read pack voltage, char* array
-      {
-        // _isr_masterUint = readFRAMuint(rxData.cmdAddr);
-        // ltoa(_isr_masterUint, txData.cmdData, 10);           // store data as char string in tx buffer
-        float framData = readFRAMfloat(rxData.cmdAddr);
-        dtostrf(framData, 3, 2, txData.cmdData);
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x3A: // read lowest voltage memory, unsigned int
-      {
-        _isr_masterUint = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUint, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x3B: // read lowest voltage timestamp, unsigned long
-      {
-        _isr_masterUlong = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUlong, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x3C: // read highest voltage memory, unsigned int
-      {
-        _isr_masterUint = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUint, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x3D: // read highest voltage timestamp, unsigned long
-      {
-        _isr_masterUlong = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUlong, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x3E: // read bus voltage, char* array
-      {
-        // _isr_masterUint = readFRAMuint(rxData.cmdAddr);
-        // ltoa(_isr_masterUint, txData.cmdData, 10);           // store data as char string in tx buffer
-        float framData = readFRAMfloat(rxData.cmdAddr);
-        dtostrf(framData, 3, 2, txData.cmdData);
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-
     case 0x3F: // print diag message from master
-      { 
-        strncpy(txtMessage, rxData.cmdData, rxData.dataLen); // copy message into another buffer
-        // messageLen = rxData.dataLen; // copy message length too
-        txtmsgWaiting = true; // set flag to print the message in loop()
-      }
+      sprintf(buff, "Message from master: %s", cmd.cmdData);
+      Serial.println(buff);
       break;
-
     case 0x40: // clear temperature memories, no data
-      { 
-        writeFRAMint(0x42, 0);
-        writeFRAMint(0x43, 0);
-        writeFRAMint(0x45, 0);
-        writeFRAMint(0x46, 0);
-        writeFRAMint(0x47, 0);
-        writeFRAMint(0x48, 0);
-        writeFRAMint(0x49, 0);
-        writeFRAMint(0x4A, 0);
-      }
+      logEvent(LOG_EV_CLEAR, cmd.cmdAddr);
+      statsClear(STAT_T0);
+      statsClear(STAT_T1);
+      statsClear(STAT_T2);
       break;
-    case 0x41: // read t0 instant, signed int
-      {
-        _isr_masterInt = readFRAMint(rxData.cmdAddr);
-        ltoa(_isr_masterInt, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x42: // read t0 lowest, signed int
-      {
-        _isr_masterInt = readFRAMint(rxData.cmdAddr);
-        ltoa(_isr_masterInt, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x43: // read t0 highest, signed int
-      {
-        _isr_masterInt = readFRAMint(rxData.cmdAddr);
-        ltoa(_isr_masterInt, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x44: // read t1 instant, signed int
-      {
-        _isr_masterInt = readFRAMint(rxData.cmdAddr);
-        ltoa(_isr_masterInt, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x45: // read t1 lowest, signed int
-      {
-        _isr_masterInt = readFRAMint(rxData.cmdAddr);
-        ltoa(_isr_masterInt, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x46: // read t1 highest, signed int
-      {
-        _isr_masterInt = readFRAMint(rxData.cmdAddr);
-        ltoa(_isr_masterInt, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x47: // read t0 lowest timestamp, unsigned long
-      {
-        _isr_masterUlong = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUlong, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x48: // read t0 highest timestamp, unsigned long
-      {
-        _isr_masterUlong = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUlong, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x49: // read t1 lowest timestamp, unsigned long
-      {
-        _isr_masterUlong = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUlong, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x4A: // read t1 highest timestamp, unsigned long
-      {
-        _isr_masterUlong = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUlong, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    
     case 0x50: // clear disconnect history, no data
-      { 
-        writeFRAMint(0x51, 0);
-        writeFRAMint(0x52, 0);
-        writeFRAMint(0x53, 0);
-        writeFRAMint(0x54, 0);
-        writeFRAMint(0x55, 0);
-        writeFRAMint(0x56, 0);
-        writeFRAMint(0x57, 0);
-      }
+      logEvent(LOG_EV_CLEAR, cmd.cmdAddr);
+      for (uint8_t reg = 0x51; reg <= 0x57; reg++) writeFRAMint(reg, 0);
       break;
-    
-    case 0x51: // read total over-current disconnects, unsigned int
+    case 0x60: // set time from master, char string, seconds with an optional fraction
       {
-        _isr_masterUint = readFRAMuint(rxData.cmdAddr);
-        ltoa(_isr_masterUint, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x52: // read total under-voltage discon, unsigned int
-      {
-        _isr_masterUint = readFRAMuint(rxData.cmdAddr);
-        ltoa(_isr_masterUint, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x53: // read total over-volt discon, uint
-      {
-        _isr_masterUint = readFRAMuint(rxData.cmdAddr);
-        ltoa(_isr_masterUint, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x54: // read total under-temp discon, uint
-      {
-        _isr_masterUint = readFRAMuint(rxData.cmdAddr);
-        ltoa(_isr_masterUint, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 6;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x55: // read total over-temp discon, uint
-      {
-        _isr_masterUint = readFRAMuint(rxData.cmdAddr);
-        ltoa(_isr_masterUint, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x56: // read last discon timestamp, ulong
-      {
-        _isr_masterUlong = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUlong, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x57: // read last discon reason code, byte
-      {
-        _isr_masterByte = readFRAMbyte(rxData.cmdAddr);
-        txData.cmdData[0] = _isr_masterByte;                // store byte in outgoing buffer
-        txData.dataLen = 1;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x60: // set time from master, char string
-      {
-        // Serial.println((char) rxData.cmdData);
-        _isr_timeStamp = strtoul(rxData.cmdData, nullptr, 10);
-        if (_isr_timeStamp>1000000000) {
-          setTime(_isr_timeStamp);                            // fingers crossed
+        uint32_t timeStamp;
+        uint16_t timeMs;
+        if (clockParse(cmd.cmdData, timeStamp, timeMs)) {
+          logEvent(LOG_EV_TIME, timeStamp);                   // on the old clock, closes the block below
+          clockSync(timeStamp, timeMs);                       // steps the clock, estimates the drift since the last sync
+          logRestart();                                       // later log times count from the new clock
           mastersetTime = true;                               // set flag
-          lasttimeSync = _isr_timeStamp;                      // record timestamp of sync
-          if (!firsttimeSync) firsttimeSync = _isr_timeStamp; // if it's our first sync, record in separate variable
-          // sprintf(buff, "Timestamp %lu", _isr_timeStamp);
-          // Serial.println(buff);
         } 
         // else Serial.println("Error receiving timestamp!");
       }
       break;
-    case 0x61: // read first-init timestamp, ulong
-      {
-        _isr_masterUlong = readFRAMulong(rxData.cmdAddr);
-        ltoa(_isr_masterUlong, txData.cmdData, 10);         // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x62: // read current timestamp, ulong
-      {
-        _isr_masterUlong = now();
-        ltoa(_isr_masterUlong, txData.cmdData, 10);         // store data as char string in tx buffer
-        txData.dataLen = 11;                                 // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-      break;
-    case 0x63: // read time since last sync
-      {
-        _isr_masterUlong = now();                           // read current time from time libvrary
-        _isr_timeStamp = _isr_masterUlong - lasttimeSync;   // subtract last sync timestamp from current timestamp
-        ltoa(_isr_timeStamp, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
-    case 0x64: // read time since last sync
-      {
-        _isr_masterUlong = now();                           // read current time from time libvrary
-        _isr_timeStamp = _isr_masterUlong - firsttimeSync;  // subtract last sync timestamp from current timestamp
-        ltoa(_isr_timeStamp, txData.cmdData, 10);           // store data as char string in tx buffer
-        txData.dataLen = 11;                                // number of bytes to transmit
-        txdataReady = true;                                 // set flag we are ready to send data
-      }
+    case 0x70: // clear profiling counters, no data
+      profileClear();
       break;
-
     default:// unknown command
-      {
-        unknownCmd = true;
-      }
+      profileUnknown();
+      sprintf(buff, "Command 0x%X: Not recognized\n", cmd.cmdAddr);
+      Serial.println(buff);
       break;
-  } // end switch
-  // sprintf(buff, "Receive event triggered. Command 0x%X", rxData.cmdAddr);
-  // Serial.println(buff);
-  purgeRXBuffer = true; // ask main loop() to purge buffer
+  }
+}
+
+uint8_t       ledX=0;
+bool          refreshCache = false;          // new readings since the last regCacheRefresh()
+
+static void rateSchedule();
+
+// conversions in, the precision adc and every finished frame
+void taskAcquire() {
+  if (rateWake()) rateSchedule();            // the adc isr saw a load come on and went back to the full rate
+  adcPoll();                                 // only does work on targets without a hardware trigger
+
+  int32_t precise;
+  if (nauPoll(precise)) {                    // DRDY fired, one burst read into the precision ring
+    uint8_t gainCode = nauConfigGain(nauConfig());
+    coulombSamplePrecise(calPrecisionUa(precise, gainCode), nauRateHz(nauConfigRate(nauConfig())));
+    int32_t rawAvg = adcPrecisionAverage();
+    adcDataBuffer[3].adcRaw = rawAvg;
+    adcDataBuffer[3].milli  = calPrecisionUa(rawAvg, gainCode) / 1000;
+  }
+
+  if (adcFrameReady()) {                     // every channel ring has been refilled by the ISR
+    convertFrame();
+    statsSample(STAT_PACK, adcDataBuffer[2].milli);
+    statsSample(STAT_T0, adcDataBuffer[4].milli);
+    statsSample(STAT_T1, adcDataBuffer[5].milli);
+    statsSample(STAT_T2, adcDataBuffer[6].milli);
+    captureSnapshot();                       // publish a fresh frame for register 0x4B
+    refreshCache = true;
+  }
+}
+
+// fold the integrated charge into the counter registers, the state of charge follows them
+// the acquisition rate follows the load and the sleep depth follows config2
+void taskIntegrate() {
+  coulombUpdate();
+  int32_t currentMa = coulombCurrentUa() / 1000;
+  socUpdate(currentMa, adcDataBuffer[2].milli);
+  uint8_t config2   = readFRAMbyte(0x2B);
+  if (rateUpdate(currentMa, readFRAMbyte(0x2C), config2)) rateSchedule();
+  powerConfigure(config2);
 }
 
+// write back whatever changed, counters go through the A/B journal, then the telemetry log
+void taskPersist() {
+  if (framDirty()) framFlush();
+  journalCommit(framDevice);
+  socPersist();
+  clockPersist();
+
+  if (logSampleDue()) {
+    int32_t hottest = adcDataBuffer[4].milli;
+    for (uint8_t t = 1; t < thermSensors; t++) {
+      if (adcDataBuffer[4 + t].milli > hottest) hottest = adcDataBuffer[4 + t].milli;
+    }
+    logSample(nauPresent() ? adcDataBuffer[3].milli : adcDataBuffer[0].milli, adcDataBuffer[2].milli, hottest);
+  }
+}
+
+// state of charge or bus activity leds, config0 bit 0 picks
+void taskStatus() {
+  if (readFRAMbyte(0x29) & socCfgLeds) {
+    socShowLeds(millis() & 0x200);           // about 1 Hz flash for a low pack
+  } else {
+    digitalWrite(LED2, reqEvnt);
+    digitalWrite(LED3, recvEvnt);
+  }
+  digitalWrite(LED4, mastersetTime);
+}
+
+// heartbeat once time is set, the activity flags cover the last second
+void taskHeartbeat() {
+  clockService();
+  if (clockValid() && !(readFRAMbyte(0x29) & socCfgLeds)) {
+    ledX = ledX ^ 1;                         // xor previous state
+    digitalWrite(LED1, ledX);
+  }
+  recvEvnt = false;
+  reqEvnt  = false;
+}
+
+// pack disconnects, the over-current fast path runs in the adc ISR
+void taskProtect() {
+  protectCheck();
+}
+
+// fixed-period tasks, registers 0x71 onwards count their deadline misses in this order
+SCHED_TASK schedTasks[] = {
+  { taskAcquire,     2,    0, 0 },           // periods of these two follow the rate level, see pm_rate.h
+  { taskIntegrate,   20,   0, 0 },
+  { taskPersist,     1000, 0, 0 },
+  { taskStatus,      50,   0, 0 },
+  { taskHeartbeat,   1000, 0, 0 },
+  { taskProtect,     5,    0, 0 },
+};
+const uint8_t schedTaskCount = sizeof(schedTasks) / sizeof(schedTasks[0]);
+
+// task periods for the rate level in effect
+static void rateSchedule() {
+  const RATE_PROFILE &profile = rateProfile();
+  schedSetPeriod(schedTasks, schedTaskCount, 0, nauPresent() ? rateNauAcquireMs : profile.acquireMs);
+  schedSetPeriod(schedTasks, schedTaskCount, 1, profile.integrateMs);
+}
+
+static const uint8_t socLedPins[socLeds] = { LED1, LED2, LED3 };
+static_assert(PACK_DISC != LED1 && PACK_DISC != LED2 && PACK_DISC != LED3 && PACK_DISC != LED4,
+              "an LED on the PACK_DISC pin would open and close the pack with the state of charge");
+
+static int32_t regSchedMiss(uint8_t reg) { return schedMisses(schedTasks, schedTaskCount, reg - 0x71); }
+
 void setup() {
   // initialize I2C pins
   pinMode(SCL, INPUT);
@@ -651,11 +606,43 @@ void setup() {
   pinMode(ADC0, INPUT);
   pinMode(ADC1, INPUT);
   pinMode(ADC2, INPUT);
+  pinMode(TEMP0, INPUT);
+  pinMode(TEMP1, INPUT);
+  pinMode(TEMP2, INPUT);
+
+#ifdef PM_BENCH
+  Serial.begin(SERIALBAUD);
+  benchRun(regTable);                        // times the hot paths and halts, see pm_bench.h
+#endif
+
+  profileBegin();                            // hardware timestamps for the handler counters
 
+  const uint8_t adcPins[adcChannelCount] = { ADC0, ADC1, ADC2, TEMP0, TEMP1, TEMP2 };
+  adcBegin(adcPins);                         // start the free-running acquisition engine
+
+#ifdef MEGACOREX
+  Wire.enableDualMode(false);                // FRAM on the master pins, host on the slave pins
+#endif
   Wire.begin(I2C_SLAVE_ADDR);                // join i2c bus 
 #ifdef MCU_NANOEVERY
   TWI0_SCTRLA |= (1<<TWI_DIEN_bp);           // manually enable data interrupt on the Every
 #endif
+
+  if (!framBegin(framDevice)) {              // blank part or older memory map
+    loadFRAMDefaults();
+    framFlush();                             // writes the header last, the flush task retries a failure
+  }
+  journalRestore(framDevice);                // counters come from the newest intact journal record
+  clockBegin(framDevice);                    // time carries on from its FRAM record, ahead of the log and the memories
+  statsBegin();                              // voltage and temperature memories survive a reset
+  logBegin(framDevice);                      // finds the newest log block, opens a new one with a boot event
+  socBegin(framDevice, socLedPins);          // state of charge carries on from its FRAM record
+  calBegin();                                // adc calibration, build defaults unless overridden in FRAM
+  protectBegin(PACK_DISC);                   // thresholds come from the limits and the calibration
+  rateBegin();                               // full rate until the integration task has seen the load
+  if (nauBegin(nauDevice, NAU_DRDY, readFRAMbyte(0x4D))) {
+    coulombUsePrecision(true);               // 24-bit shunt readings replace the 10-bit sensor in the integrator
+  }
   delay(2000);
 
 // #ifdef MCU_NANOEVERY
@@ -666,101 +653,38 @@ void setup() {
 
   Serial.begin(SERIALBAUD);
 
+  idleReplyLen = sprintf(idleReply, "Slave 0x%X ready!", I2C_SLAVE_ADDR);
+
   sprintf(buff, "\n\nHello, world!\nSlave address: 0x%X\n", I2C_SLAVE_ADDR);
   Serial.print(buff);
 
+  regCacheRefresh(regTable);    // first replies are ready before the master can ask
+
   Wire.onRequest(requestEvent); // register requestEvent interrupt handler
   Wire.onReceive(receiveEvent); // register receiveEvent interrupt handler
-}
 
-uint16_t      i=0;
-uint16_t      x=0;
-uint8_t       ledX=0;
-uint8_t       adcUpdateCnt      = 0;
-const uint8_t adcUpdateInterval = 20;
+  powerBegin();                 // after the last Serial.begin(), standby waits for its output
+  schedBegin(schedTasks, schedTaskCount);
+}
 
 // the loop function runs over and over again forever
 void loop() {
-  i++;
-  adcUpdateCnt++;
-
-  digitalWrite(LED2, reqEvnt);
-  digitalWrite(LED3, recvEvnt);
-  digitalWrite(LED4, mastersetTime);
-
-  if (purgeTXBuffer) clearTXBuffer(); 
-  if (purgeRXBuffer) clearRXBuffer();
-
-  if (adcUpdateCnt > adcUpdateInterval) {
-    long rawAdc    = 0;
-    //int acsOffset  = 514;
-    float acsmvA  = 0.136;  // 0.136v or 136mV per amp
-    float Amps    = 0.0;
-    float Volts   = 0.0;
-    float sysVcc  = 4.43;
-    float vDiv2   = 1.0;
-    float vDiv3   = 1.0;
-  
-// #ifdef MCU_NANOEVERY
-//     sysVcc        = 4.300;
-// #endif
- 
-    rawAdc = readADC(ADC0, 20);
-    rawAdc = rawAdc;
-    //rawAdc = analogRead(ADC0);
-    //rawAdc = rawAdc; // subtrack offset
-    adcDataBuffer[0].adcRaw = rawAdc;
-    Volts = (float)(rawAdc * (sysVcc / 1024.0)) - (sysVcc / 2);
-    Amps =  (float)Volts / acsmvA;
-    adcDataBuffer[0].Amps  = Amps;
-    adcDataBuffer[0].Volts = Volts;
-    // Serial.print("0: ");
-    // Serial.print(Amps);
-    // Serial.print(" 1: ");
-    // Serial.print(Volts, 3);
-    // Serial.print("v Raw ");
-    // Serial.print(rawAdc);
-    // Serial.println(" ");
-
-    rawAdc = readADC(ADC1, 20);
-    // Serial.print(rawAdc);
-    // Serial.print(" <-ADC1 ADC2-> ");
-    adcDataBuffer[1].adcRaw   = rawAdc;
-    Volts = (float)(rawAdc * (sysVcc / 1024.0)) / vDiv2;
-    adcDataBuffer[1].Volts = Volts;
-
-    rawAdc = readADC(ADC2, 20);
-    // Serial.println(rawAdc);
-    adcDataBuffer[2].adcRaw   = rawAdc;
-    Volts = (float)(rawAdc * (sysVcc / 1024.0)) / vDiv3;
-    adcDataBuffer[1].Volts = Volts;
-    adcUpdateCnt = 0;
-  }
-  
-  if (unknownCmd) {
-    unknownCmd = false;
-
-    sprintf(buff, "Command 0x%X: Not recognized\n", rxData.cmdAddr);
-    Serial.println(buff);
+  profileLoop();
+  schedRun(schedTasks, schedTaskCount);
+
+  I2C_RX_DATA *pendingCmd;
+  bool cmdExecuted = false;
+  while ((pendingCmd = rxPeek())) {          // drain the commands the receive ISR queued for us
+    executeCommand(*pendingCmd);
+    rxRelease();
+    cmdExecuted = true;
   }
+  logService();                              // next log block ready for the master's 0x78 reads
 
-  if (txtmsgWaiting) {            // print message sent by master
-    txtmsgWaiting = false;        // clear flag
-    sprintf(buff, "Message from master: %s", txtMessage);
-    Serial.println(buff);
+  if (cmdExecuted || refreshCache) {         // prepare replies ahead of the next read
+    regCacheRefresh(regTable);
+    refreshCache = false;
   }
 
-  if (i>1000){
-    i=0;
-    if (timeStatus()==timeSet) {             // print timestamps once time is set
-      ledX = ledX ^ 1;              // xor previous state
-      digitalWrite(LED1, ledX);     // turn the LED on (HIGH is the voltage level)
-      // Serial.printf("Timestamp: %lu\n", now());
-    } 
-    
-    recvEvnt = false; // reset flag
-    reqEvnt  = false; // reset flag
-  }
-
-  delay(1);
-}
\ No newline at end of file
+  schedIdle(schedTasks, schedTaskCount);     // sleep until the next interrupt or release
+}
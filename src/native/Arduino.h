@@ -0,0 +1,99 @@
+#ifndef pm_native_arduino_h
+#define pm_native_arduino_h
+
+// Arduino core shim for env:native, only what the firmware uses. Pin, clock
+// and analog behaviour is backed by the simulation in pm_native_hal.cpp.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "pm_native_hal.h"
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define HIGH    1
+#define LOW     0
+#define INPUT   0
+#define OUTPUT  1
+#define INPUT_PULLUP 2
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+#define PROGMEM
+#define F(str)                 (str)
+#define memcpy_P               memcpy
+#define pgm_read_byte(addr)    (*(const uint8_t *) (addr))
+#define pgm_read_word(addr)    (*(const uint16_t *) (addr))
+#define pgm_read_dword(addr)   (*(const uint32_t *) (addr))
+
+#define digitalPinToInterrupt(pin) (pin)
+
+void     pinMode(uint8_t pin, uint8_t mode);
+void     digitalWrite(uint8_t pin, uint8_t level);
+int      digitalRead(uint8_t pin);
+int      analogRead(uint8_t pin);
+void     attachInterrupt(uint8_t irq, void (*isr)(), int mode);
+void     detachInterrupt(uint8_t irq);
+
+unsigned long millis();
+unsigned long micros();
+void     delay(unsigned long ms);
+void     delayMicroseconds(unsigned int us);
+
+// single threaded, the simulated interrupts only run between firmware calls
+inline void noInterrupts() { }
+inline void interrupts()   { }
+
+char    *ltoa(long value, char *out, int radix);
+char    *ultoa(unsigned long value, char *out, int radix);
+char    *dtostrf(double value, signed char width, unsigned char prec, char *out);
+
+class Stream {
+  public:
+    virtual int    available() = 0;
+    virtual int    read() = 0;
+    virtual size_t write(uint8_t value) = 0;
+    size_t write(const uint8_t *data, size_t len) {
+      size_t sent = 0;
+      while (len--) sent += write(*data++);
+      return sent;
+    }
+    size_t readBytes(uint8_t *data, size_t len) {
+      size_t got = 0;
+      while (got < len && available()) data[got++] = (uint8_t) read();
+      return got;
+    }
+    size_t readBytes(char *data, size_t len) { return readBytes((uint8_t *) data, len); }
+};
+
+// Serial goes to stderr so a harness can keep stdout for its own results
+class NativeSerial : public Stream {
+  public:
+    void   begin(unsigned long baud) { }
+    int    available() { return 0; }
+    int    read() { return -1; }
+    size_t write(uint8_t value);
+    size_t print(const char *text);
+    size_t print(long value);
+    size_t println(const char *text = "");
+    size_t println(long value);
+};
+
+extern NativeSerial Serial;
+
+#endif
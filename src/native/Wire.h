@@ -0,0 +1,48 @@
+#ifndef pm_native_wire_h
+#define pm_native_wire_h
+
+// Wire shim for env:native. The slave side hands bytes from
+// nativeMasterWrite() to the onReceive handler and collects the onRequest
+// reply for nativeMasterRead(). The master side routes transactions to the
+// device models registered with nativeI2cAttach().
+
+#include "Arduino.h"
+
+const uint8_t nativeWireBuffer = 32;     // same as the AVR cores
+
+class TwoWire : public Stream {
+  public:
+    void    begin() { }
+    void    begin(uint8_t addr) { }
+    void    setClock(uint32_t hz) { }
+    void    enableDualMode(bool fmp) { }
+    void    onReceive(void (*handler)(size_t)) { receiveHandler = handler; }
+    void    onRequest(void (*handler)()) { requestHandler = handler; }
+
+    void    beginTransmission(uint8_t addr);
+    uint8_t endTransmission(bool stop = true);
+    uint8_t requestFrom(int addr, int len);
+
+    int     available() { return rxLen - rxPos; }
+    int     read() { return rxPos < rxLen ? rxBuf[rxPos++] : -1; }
+    size_t  write(uint8_t value);
+    using Stream::write;
+
+    // used by nativeMasterWrite() and nativeMasterRead()
+    void    (*receiveHandler)(size_t) = nullptr;
+    void    (*requestHandler)()       = nullptr;
+    void    slaveReceive(const uint8_t *data, uint8_t len);
+    uint8_t slaveRequest(uint8_t *data, uint8_t len);
+
+  private:
+    uint8_t rxBuf[nativeWireBuffer];
+    uint8_t rxLen = 0;
+    uint8_t rxPos = 0;
+    uint8_t txBuf[nativeWireBuffer];
+    uint8_t txLen = 0;
+    uint8_t txAddr = 0;                  // master transaction target, txBuf also collects the slave reply
+};
+
+extern TwoWire Wire;
+
+#endif
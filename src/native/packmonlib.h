@@ -0,0 +1,8 @@
+#ifndef pm_native_packmonlib_h
+#define pm_native_packmonlib_h
+
+// packmonlib is only declared by the firmware, an empty class is enough for env:native
+
+class PackMonLib { };
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef pm_native_devices_h
+#define pm_native_devices_h
+
+#include "pm_native_hal.h"
+#include "pm_fram_mock.h"
+#include "pm_nau7802_sim.h"
+
+// Wire-level front ends for the register models, so the real FramI2C and
+// NauI2C drivers run unchanged against them on the native master bus.
+
+// FM24C64B: two address bytes set the pointer, the rest of a write is data,
+// reads continue from the pointer
+class FramTarget : public NativeI2cTarget {
+  public:
+    FramTarget(FramMock &mem) : _mem(mem) {}
+
+    bool receive(const uint8_t *data, uint8_t len) {
+      if (len < 2) return len == 0;                          // bare address probe
+      _ptr = ((data[0] << 8) | data[1]) % framSize;
+      if (len > 2 && !_mem.write(_ptr, data + 2, len - 2)) return false;
+      _ptr = (_ptr + len - 2) % framSize;
+      return true;
+    }
+
+    uint8_t request(uint8_t *data, uint8_t len) {
+      _mem.read(_ptr, data, len);
+      _ptr = (_ptr + len) % framSize;
+      return len;
+    }
+
+  private:
+    FramMock &_mem;
+    uint16_t  _ptr = 0;
+};
+
+// NAU7802: first byte is the register pointer, converts at the configured
+// rate while CS is set and mirrors CR onto the DRDY pin
+class NauTarget : public NativeI2cTarget {
+  public:
+    typedef int32_t (*Waveform)(uint64_t us);               // signed 24-bit counts at a point in time
+
+    NauTarget(Nau7802Sim &sim, int8_t drdyPin, Waveform wave) : _sim(sim), _drdyPin(drdyPin), _wave(wave) {}
+
+    bool receive(const uint8_t *data, uint8_t len) {
+      if (!_sim.present) return false;
+      if (len) _ptr = data[0];
+      for (uint8_t x = 1; x < len; x++) {
+        if (!_sim.writeReg((_ptr + x - 1) % nauRegCount, data[x])) return false;
+      }
+      syncDrdy();
+      return true;
+    }
+
+    uint8_t request(uint8_t *data, uint8_t len) {
+      if (!_sim.readRegs(_ptr, data, len)) return 0;
+      syncDrdy();
+      return len;
+    }
+
+    void tick(uint64_t us) {
+      if (!_sim.running()) {
+        _next = 0;
+        return;
+      }
+      uint16_t rate = nauRateHz(_sim.rateCode());
+      if (!rate) return;
+      uint64_t period = 1000000ULL / rate;
+      if (!_next) _next = us + period;                       // first result one period after CS
+      while (us >= _next) {
+        _sim.convert(_wave ? _wave(_next) : 0);
+        _next += period;
+      }
+      syncDrdy();
+    }
+
+  private:
+    void syncDrdy() {
+      if (_drdyPin >= 0) nativePinDrive(_drdyPin, _sim.drdy);
+    }
+
+    Nau7802Sim &_sim;
+    int8_t      _drdyPin;
+    Waveform    _wave;
+    uint8_t     _ptr  = 0;
+    uint64_t    _next = 0;
+};
+
+#endif
@@ -0,0 +1,241 @@
+#ifdef PM_NATIVE
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "pm_native_hal.h"
+
+NativeSerial Serial;
+TwoWire      Wire;
+
+static uint64_t          simMicros = 0;
+static uint8_t           pinLevel[nativePinCount];
+static uint8_t           pinModes[nativePinCount];       // INPUT until pinMode()
+static void            (*pinIsr[nativePinCount])();
+static int               pinIsrMode[nativePinCount];
+static int               analogLevel[nativePinCount];
+static NativeWaveform    analogWave[nativePinCount];
+static NativeI2cTarget  *i2cTarget[128];
+static bool              serialQuiet = false;
+static NativeAdvanceHook advanceHook = nullptr;
+static bool              advancing   = false;    // the hook may call back into the firmware
+static bool              wakePending = false;    // an interrupt that would end a sleep
+
+
+uint64_t nativeMicros() {
+  return simMicros;
+}
+
+void nativeAdvance(uint64_t us) {
+  simMicros += us;
+  for (uint8_t addr = 0; addr < 128; addr++) {
+    if (i2cTarget[addr]) i2cTarget[addr]->tick(simMicros);
+  }
+  if (advanceHook && !advancing) {
+    advancing = true;
+    advanceHook(simMicros);
+    advancing = false;
+  }
+}
+
+// a sleeping part sees time pass in interrupt-sized steps, whatever comes in during one ends it
+uint64_t nativeSleep(uint64_t us) {
+  const uint64_t step  = 100;
+  uint64_t       slept = 0;
+  wakePending = false;
+  while (slept < us && !wakePending) {
+    uint64_t left = us - slept;
+    nativeAdvance(left < step ? left : step);
+    slept += left < step ? left : step;
+  }
+  return slept;
+}
+
+void nativeOnAdvance(NativeAdvanceHook hook) {
+  advanceHook = hook;
+}
+
+void nativePinDrive(uint8_t pin, uint8_t level) {
+  if (pin >= nativePinCount) return;
+  uint8_t old = pinLevel[pin];
+  pinLevel[pin] = level ? HIGH : LOW;
+  if (!pinIsr[pin] || old == pinLevel[pin]) return;
+  int mode = pinIsrMode[pin];
+  if (mode == CHANGE || (mode == RISING && pinLevel[pin]) || (mode == FALLING && !pinLevel[pin])) {
+    wakePending = true;
+    pinIsr[pin]();
+  }
+}
+
+uint8_t nativePinLevel(uint8_t pin) {
+  return pin < nativePinCount ? pinLevel[pin] : LOW;
+}
+
+uint8_t nativePinMode(uint8_t pin) {
+  return pin < nativePinCount ? pinModes[pin] : INPUT;
+}
+
+void nativeAnalogSet(uint8_t pin, int value) {
+  if (pin >= nativePinCount) return;
+  analogLevel[pin] = value;
+  analogWave[pin]  = nullptr;
+}
+
+void nativeAnalogWaveform(uint8_t pin, NativeWaveform fn) {
+  if (pin < nativePinCount) analogWave[pin] = fn;
+}
+
+void nativeI2cAttach(uint8_t addr, NativeI2cTarget *target) {
+  i2cTarget[addr & 0x7F] = target;
+}
+
+bool nativeMasterWrite(const uint8_t *data, uint8_t len) {
+  if (!Wire.receiveHandler) return false;                  // no slave address yet, NAK
+  wakePending = true;                                      // address match
+  Wire.slaveReceive(data, len);
+  return true;
+}
+
+uint8_t nativeMasterRead(uint8_t *data, uint8_t len) {
+  if (!Wire.requestHandler) return 0;
+  wakePending = true;
+  return Wire.slaveRequest(data, len);
+}
+
+void nativeSerialQuiet(bool quiet) {
+  serialQuiet = quiet;
+}
+
+// Arduino core
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= nativePinCount) return;
+  pinModes[pin] = mode;
+  if (mode == INPUT_PULLUP) pinLevel[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (pin < nativePinCount) pinLevel[pin] = level ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+  return nativePinLevel(pin);
+}
+
+int analogRead(uint8_t pin) {
+  if (pin >= nativePinCount) return 0;
+  int value = analogWave[pin] ? analogWave[pin](pin, simMicros) : analogLevel[pin];
+  return value < 0 ? 0 : value > 1023 ? 1023 : value;    // 10-bit like the parts
+}
+
+void attachInterrupt(uint8_t irq, void (*isr)(), int mode) {
+  if (irq >= nativePinCount) return;
+  pinIsr[irq]     = isr;
+  pinIsrMode[irq] = mode;
+}
+
+void detachInterrupt(uint8_t irq) {
+  if (irq < nativePinCount) pinIsr[irq] = nullptr;
+}
+
+unsigned long millis() {
+  return (unsigned long) (simMicros / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long) simMicros;
+}
+
+void delay(unsigned long ms) {
+  nativeAdvance((uint64_t) ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  nativeAdvance(us);
+}
+
+char *ltoa(long value, char *out, int radix) {
+  if (radix == 16) sprintf(out, "%lx", value);
+  else             sprintf(out, "%ld", value);
+  return out;
+}
+
+char *ultoa(unsigned long value, char *out, int radix) {
+  if (radix == 16) sprintf(out, "%lx", value);
+  else             sprintf(out, "%lu", value);
+  return out;
+}
+
+char *dtostrf(double value, signed char width, unsigned char prec, char *out) {
+  sprintf(out, "%*.*f", width, prec, value);
+  return out;
+}
+
+size_t NativeSerial::write(uint8_t value) {
+  if (!serialQuiet) fputc(value, stderr);
+  return 1;
+}
+
+size_t NativeSerial::print(const char *text) {
+  if (!serialQuiet) fputs(text, stderr);
+  return strlen(text);
+}
+
+size_t NativeSerial::print(long value) {
+  char text[12];
+  return print(ltoa(value, text, 10));
+}
+
+size_t NativeSerial::println(const char *text) {
+  size_t len = print(text);
+  return len + print("\n");
+}
+
+size_t NativeSerial::println(long value) {
+  size_t len = print(value);
+  return len + print("\n");
+}
+
+// Wire
+
+void TwoWire::beginTransmission(uint8_t addr) {
+  txAddr = addr & 0x7F;
+  txLen  = 0;
+}
+
+size_t TwoWire::write(uint8_t value) {
+  if (txLen >= nativeWireBuffer) return 0;
+  txBuf[txLen++] = value;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+  NativeI2cTarget *target = i2cTarget[txAddr];
+  if (!target) return 2;                                   // address NAK
+  return target->receive(txBuf, txLen) ? 0 : 3;           // data NAK
+}
+
+uint8_t TwoWire::requestFrom(int addr, int len) {
+  NativeI2cTarget *target = i2cTarget[addr & 0x7F];
+  if (len > nativeWireBuffer) len = nativeWireBuffer;
+  rxPos = 0;
+  rxLen = target ? target->request(rxBuf, (uint8_t) len) : 0;
+  return rxLen;
+}
+
+void TwoWire::slaveReceive(const uint8_t *data, uint8_t len) {
+  if (len > nativeWireBuffer) len = nativeWireBuffer;
+  memcpy(rxBuf, data, len);
+  rxLen = len;
+  rxPos = 0;
+  receiveHandler(len);
+}
+
+uint8_t TwoWire::slaveRequest(uint8_t *data, uint8_t len) {
+  txLen = 0;
+  requestHandler();                                        // fills txBuf through write()
+  if (len > txLen) len = txLen;
+  memcpy(data, txBuf, len);
+  return len;
+}
+
+#endif
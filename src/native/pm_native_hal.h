@@ -0,0 +1,50 @@
+#ifndef pm_native_hal_h
+#define pm_native_hal_h
+
+#include <stdint.h>
+
+// Control side of the native HAL. The Arduino.h and Wire.h shims in this
+// directory stand in for the cores when env:native builds the firmware on
+// Linux, these calls let a harness drive what the hardware would: simulated
+// time, pin levels, analog waveforms, the I2C master talking to us and the
+// devices hanging off our own master bus.
+//
+// Time only moves when the firmware calls delay() or sleeps through
+// nativeSleep(), or the harness calls nativeAdvance(), so a run is
+// deterministic and as fast as the host allows. A harness that has to act
+// while the firmware sleeps does so from a nativeOnAdvance() hook.
+
+const uint8_t nativePinCount = 64;
+
+typedef int (*NativeWaveform)(uint8_t pin, uint64_t us);  // analog level 0..1023 at a point in simulated time
+
+// a device on the firmware's master bus, the models in pm_native_devices.h
+class NativeI2cTarget {
+  public:
+    virtual bool    receive(const uint8_t *data, uint8_t len) = 0;   // master write, false to NAK
+    virtual uint8_t request(uint8_t *data, uint8_t len) = 0;         // master read, returns bytes supplied
+    virtual void    tick(uint64_t us) { }                            // simulated time moved on
+};
+
+typedef void (*NativeAdvanceHook)(uint64_t us);              // simulated time moved on, may act as the host
+
+uint64_t nativeMicros();
+void     nativeAdvance(uint64_t us);                         // move simulated time, ticks every attached target
+uint64_t nativeSleep(uint64_t us);                           // advance until a host transaction or pin interrupt, returns us slept
+void     nativeOnAdvance(NativeAdvanceHook hook);            // called after every advance, nullptr to remove
+
+void     nativePinDrive(uint8_t pin, uint8_t level);         // external level on a pin, fires attached interrupts
+uint8_t  nativePinLevel(uint8_t pin);                        // last level written by the firmware or driven
+uint8_t  nativePinMode(uint8_t pin);                         // last pinMode(), INPUT until set
+void     nativeAnalogSet(uint8_t pin, int value);            // constant analog level
+void     nativeAnalogWaveform(uint8_t pin, NativeWaveform fn);
+
+void     nativeI2cAttach(uint8_t addr, NativeI2cTarget *target);
+
+// the upstream host: a write transaction runs the onReceive handler, a read runs onRequest
+bool     nativeMasterWrite(const uint8_t *data, uint8_t len);
+uint8_t  nativeMasterRead(uint8_t *data, uint8_t len);
+
+void     nativeSerialQuiet(bool quiet);                      // drop Serial output, for benchmarks
+
+#endif
@@ -0,0 +1,148 @@
+#if defined(PM_NATIVE) && !defined(PIO_UNIT_TESTING)
+
+// env:native entry point. Wires the simulated peripherals up, runs the
+// firmware's setup() and loop() against a scripted host that polls registers
+// the way the pack controller does, and prints host-side latency and
+// throughput of the receive/request handlers and loop() as JSON on stdout.
+//
+//   pio run -e native && .pio/build/native/program [simulated seconds]
+//
+// Left out of `pio test -e native`, the suites in test/ bring their own main().
+
+#include <chrono>
+#include <math.h>
+#include "Arduino.h"
+#include "Wire.h"
+#include "pm_pins.h"
+#include "pm_native_hal.h"
+#include "pm_native_devices.h"
+#include "pm_adc.h"
+#include "pm_nau7802.h"
+
+void setup();
+void loop();
+
+static FramMock   framMem;
+static FramTarget framTarget(framMem);
+static Nau7802Sim nauSim;
+
+// 1Hz ripple on a 2A discharge, both current paths see the same load
+static int currentWave(uint8_t pin, uint64_t us) {
+  return 512 - 62 + (int) (10 * sin(2 * M_PI * (double) us / 1000000.0));
+}
+
+static int32_t nauWave(uint64_t us) {
+  return -651000 + (int32_t) (3000 * sin(2 * M_PI * (double) us / 1000000.0));
+}
+
+static NauTarget nauTarget(nauSim, NAU_DRDY, nauWave);
+
+struct NativeTiming {
+  uint64_t count = 0;
+  uint64_t total = 0;                   // ns
+  uint64_t worst = 0;
+
+  void add(uint64_t ns) {
+    count++;
+    total += ns;
+    if (ns > worst) worst = ns;
+  }
+
+  void print(const char *name, bool last = false) const {
+    printf("  \"%s\": {\"count\": %llu, \"avg_ns\": %llu, \"max_ns\": %llu}%s\n", name,
+           (unsigned long long) count, (unsigned long long) (count ? total / count : 0),
+           (unsigned long long) worst, last ? "" : ",");
+  }
+};
+
+static uint64_t hostNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static NativeTiming loopTime, receiveTime, requestTime;
+
+// one host transaction: command write, then a read of the reply
+static uint8_t hostRead(uint8_t reg, uint8_t *reply, uint8_t len) {
+  uint64_t start = hostNs();
+  nativeMasterWrite(&reg, 1);
+  receiveTime.add(hostNs() - start);
+
+  start = hostNs();
+  uint8_t got = nativeMasterRead(reply, len);
+  requestTime.add(hostNs() - start);
+  return got;
+}
+
+static void hostCommand(uint8_t reg, const char *data) {
+  uint8_t frame[32];
+  uint8_t len = strlen(data);
+  frame[0] = reg;
+  memcpy(frame + 1, data, len);
+  uint64_t start = hostNs();
+  nativeMasterWrite(frame, len + 1);
+  receiveTime.add(hostNs() - start);
+}
+
+int main(int argc, char **argv) {
+  uint32_t simSeconds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 60;
+
+  nativeI2cAttach(framI2CAddr, &framTarget);
+  nativeI2cAttach(nauI2CAddr, &nauTarget);
+  nativeAnalogWaveform(ADC0, currentWave);
+  nativeAnalogSet(ADC1, 700);
+  nativeAnalogSet(ADC2, 610);                               // 13.2V pack with the default divider, inside the limits
+  nativeAnalogSet(TEMP0, 683);                              // 25 degC with the default divider
+  nativeAnalogSet(TEMP1, 640);
+  nativeAnalogSet(TEMP2, 720);
+
+  setup();
+  nativeSerialQuiet(true);
+  hostCommand(0x60, "1700000000");
+
+  // the controller round-robins these, ascii, binary and the snapshot
+  const uint8_t polled[] = { 0x33, 0x39, 0x3E, 0x4C, 0x31, 0x62, 0xB3, 0xCC, 0x4B };
+  uint8_t  reply[32];
+  uint8_t  next     = 0;
+  uint64_t nextPoll = nativeMicros();
+  uint64_t endAt    = nativeMicros() + (uint64_t) simSeconds * 1000000;
+
+  uint64_t runStart = hostNs();
+  while (nativeMicros() < endAt) {
+    uint64_t start = hostNs();
+    loop();
+    loopTime.add(hostNs() - start);
+
+    if (nativeMicros() >= nextPoll) {                      // 100 transactions per simulated second
+      hostRead(polled[next], reply, sizeof(reply));
+      next = (next + 1) % sizeof(polled);
+      nextPoll += 10000;
+    }
+  }
+  uint64_t runNs = hostNs() - runStart;
+
+  uint8_t text[32] = {};
+  uint8_t net[32]  = {};
+  uint8_t rate[32] = {};
+  hostRead(0x4C, text, sizeof(text) - 1);
+  hostRead(0x31, net, sizeof(net) - 1);
+  hostRead(0x6C, rate, sizeof(rate) - 1);
+
+  printf("{\n");
+  printf("  \"sim_seconds\": %lu,\n", (unsigned long) simSeconds);
+  printf("  \"host_ms\": %.1f,\n", runNs / 1e6);
+  printf("  \"speedup\": %.1f,\n", simSeconds * 1e9 / (double) (runNs ? runNs : 1));
+  printf("  \"adc_samples\": %lu,\n", (unsigned long) adcSampleCount());
+  printf("  \"nau_samples\": %lu,\n", (unsigned long) nauSampleCount());
+  printf("  \"fram_writes\": %lu,\n", (unsigned long) framMem.writeCalls);
+  printf("  \"precision_current\": \"%s\",\n", (const char *) text);
+  printf("  \"coulomb_mah\": \"%s\",\n", (const char *) net);
+  printf("  \"adc_rate_hz\": \"%s\",\n", (const char *) rate);
+  loopTime.print("loop");
+  receiveTime.print("receiveEvent");
+  requestTime.print("requestEvent", true);
+  printf("}\n");
+  return 0;
+}
+
+#endif
@@ -0,0 +1,218 @@
+#include <Arduino.h>
+#include "pm_adc.h"
+#include "pm_coulomb.h"
+#include "pm_profile.h"
+#include "pm_protect.h"
+
+// pm_pins.h is deliberately not included here, on the megaAVR parts its ADC0
+// pin macro would shadow the ADC0 peripheral used below
+
+static volatile ADC_RING adcRing[adcChannelCount];
+static uint8_t           adcMux[adcChannelCount];         // hardware mux value per channel
+static volatile uint8_t  adcChannel      = 0;             // channel of the conversion in progress
+static volatile uint8_t  adcThermNext    = adcThermFirst; // thermistor that gets the slow slot of the next round
+static volatile uint8_t  adcFrameSamples = 0;             // conversions since the last complete frame
+static volatile bool     adcFrameFlag    = false;         // set by the ISR when every fast ring has been refilled
+static volatile uint32_t adcConversions  = 0;             // total conversions since boot
+static ADC_RING24        adcPrecision;                    // NAU7802 channel, only touched from loop()
+static volatile uint8_t  adcShift        = 0;             // conversion rate is adcSampleRateHz >> adcShift
+static volatile uint16_t adcWakeLo       = 0;             // current conversions outside this window restore the full rate
+static volatile uint16_t adcWakeHi       = 0xFFFF;
+
+static void adcApplyRate(uint8_t shift);                  // point the trigger at the rate, per target below
+
+// store one conversion result and advance to the next channel, called from the ISR
+static inline uint8_t adcStore(uint16_t sample) {
+  uint8_t ch = adcChannel;
+  volatile ADC_RING &ring = adcRing[ch];
+  uint8_t head = ring.head;
+
+  ring.sum = ring.sum - ring.samples[head] + sample;      // running sum, no re-summing the whole ring
+  ring.samples[head] = sample;
+  ring.head = (head + 1) & (adcRingSize - 1);
+  if (ch == 0) {
+    coulombSample(sample, adcShift);                      // current channel feeds the integrator at the sample rate
+    protectCurrentSample(sample);                         // and the over-current trip
+    if (sample < adcWakeLo || sample > adcWakeHi) {       // load came on while divided down
+      adcWakeLo = 0;
+      adcWakeHi = 0xFFFF;
+      adcShift  = 0;
+      adcApplyRate(0);
+    }
+  }
+
+  adcConversions++;
+  if (++adcFrameSamples >= (uint8_t) (adcRingSize * adcRoundSlots)) {
+    adcFrameSamples = 0;
+    adcFrameFlag = true;
+  }
+
+  if (ch == adcFastChannels - 1) {                        // end of the fast channels, one thermistor next
+    ch = adcThermNext;
+    adcThermNext = (ch + 1 < adcChannelCount) ? ch + 1 : adcThermFirst;
+  } else if (ch >= adcFastChannels) {
+    ch = 0;
+  } else {
+    ch++;
+  }
+  adcChannel = ch;
+  return adcMux[ch];                                      // caller loads this into the mux for the next trigger
+}
+
+#if defined(__AVR_ATmega4808__) || defined(__AVR_ATmega4809__)
+
+static uint8_t adcPinToMux(uint8_t pin) {
+  return digitalPinToAnalogInput(pin);
+}
+
+static void adcStartHardware() {
+  RTC.CLKSEL = RTC_CLKSEL_INT32K_gc;                      // 32.768kHz internal ulp oscillator
+  while (RTC.PITSTATUS > 0) {}                            // wait for pit registers to sync
+  RTC.PITCTRLA = RTC_PITEN_bm;                            // pit only feeds the event system, interrupt stays off
+
+  adcApplyRate(adcShift);                                 // odd channel pit3 tap is CLK_RTC / 64 = 512Hz
+  EVSYS.USERADC0 = EVSYS_CHANNEL_CHANNEL1_gc;             // route channel 1 to the adc start input
+
+  ADC0.MUXPOS  = adcMux[0];
+  ADC0.EVCTRL  = ADC_STARTEI_bm;                          // one conversion per event
+  ADC0.INTCTRL = ADC_RESRDY_bm;                           // result ready interrupt
+  ADC0.CTRLA   = ADC_ENABLE_bm;                           // 10-bit, reference and prescaler left as the core set them
+}
+
+// the odd channel pit taps are CLK_RTC / 64 to / 512 from pit3 down to pit0, one generator per halving
+static void adcApplyRate(uint8_t shift) {
+  EVSYS.CHANNEL1 = EVSYS_GENERATOR_RTC_PIT3_gc - shift;
+}
+
+ISR(ADC0_RESRDY_vect) {
+  uint16_t start  = profileTicks();
+  uint16_t sample = ADC0.RES;                             // reading RES clears the RESRDY flag
+  ADC0.MUXPOS = adcStore(sample);
+  profileEnd(PROF_ADC, start);
+}
+
+void adcPoll() { }
+
+#elif defined(__AVR_ATmega328P__)
+
+static uint8_t adcPinToMux(uint8_t pin) {
+  return (pin >= A0) ? pin - A0 : pin;
+}
+
+static void adcStartHardware() {
+  ADMUX  = (1<<REFS0) | adcMux[0];                        // avcc reference, same as analogRead() DEFAULT
+  ADCSRB = (1<<ADTS2);                                    // auto trigger on Timer0 overflow, shared with millis()
+  ADCSRA = (1<<ADEN) | (1<<ADATE) | (1<<ADIE)             // enable, auto trigger, result interrupt
+         | (1<<ADPS2) | (1<<ADPS1) | (1<<ADPS0);          // 16MHz / 128 adc clock
+}
+
+static volatile uint8_t adcSkip = 0;                      // Timer0 overflows since the last stored conversion
+
+static void adcApplyRate(uint8_t shift) {
+  adcSkip = 0;                                            // Timer0 also drives millis(), so divide by dropping results
+}
+
+ISR(ADC_vect) {
+  if (++adcSkip < (1 << adcShift)) return;                // converted anyway, the trigger cannot be divided
+  adcSkip = 0;
+  uint16_t start  = profileTicks();
+  uint16_t sample = ADC;
+  ADMUX = (ADMUX & 0xF0) | adcStore(sample);              // next trigger samples the next channel
+  profileEnd(PROF_ADC, start);
+}
+
+void adcPoll() { }
+
+#else
+
+static uint8_t adcPinToMux(uint8_t pin) {
+  return pin;                                             // analogRead() takes the pin directly
+}
+
+static uint32_t adcLastSample = 0;                        // micros() of the last paced conversion
+
+static void adcStartHardware() {
+  adcLastSample = micros();
+}
+
+static void adcApplyRate(uint8_t shift) { }               // adcPoll() reads adcShift on every pass
+
+// no trigger source on this target, pace the scan from loop() at adcSampleRateHz >> adcShift
+void adcPoll() {
+  uint32_t nowMicros = micros();
+
+  while ((uint32_t) (nowMicros - adcLastSample) >= (1000000UL / adcSampleRateHz) << adcShift) {
+    adcLastSample += (1000000UL / adcSampleRateHz) << adcShift;
+    uint16_t start = profileTicks();
+    adcStore(analogRead(adcMux[adcChannel]));
+    profileEnd(PROF_ADC, start);
+  }
+}
+
+#endif
+
+void adcBegin(const uint8_t *adcPins) {
+  for (uint8_t ch = 0; ch < adcChannelCount; ch++) {
+    adcMux[ch] = adcPinToMux(adcPins[ch]);
+  }
+  adcChannel   = 0;
+  adcThermNext = adcThermFirst;
+  adcStartHardware();
+}
+
+#ifdef PM_BENCH
+void adcBenchStore(uint16_t sample) {
+  adcStore(sample);
+}
+#endif
+
+bool adcFrameReady() {
+  if (!adcFrameFlag) return false;
+  adcFrameFlag = false;
+  return true;
+}
+
+uint16_t adcAverage(uint8_t channel) {
+  uint16_t sum;
+  noInterrupts();                                         // 16-bit read must not tear against the ISR
+  sum = adcRing[channel].sum;
+  interrupts();
+  return sum >> adcRingShift;
+}
+
+void adcSetRate(uint8_t shift, uint16_t wakeLo, uint16_t wakeHi) {
+  if (shift > adcShiftMax) shift = adcShiftMax;
+  noInterrupts();                                         // window and shift change together against the ISR
+  adcShift  = shift;
+  adcWakeLo = shift ? wakeLo : 0;
+  adcWakeHi = shift ? wakeHi : 0xFFFF;
+  adcApplyRate(shift);
+  interrupts();
+}
+
+uint8_t adcRateShift() {
+  return adcShift;
+}
+
+uint32_t adcSampleCount() {
+  uint32_t count;
+  noInterrupts();
+  count = adcConversions;
+  interrupts();
+  return count;
+}
+
+void adcPushPrecision(int32_t sample) {
+  uint8_t head = adcPrecision.head;
+  adcPrecision.sum = adcPrecision.sum - adcPrecision.samples[head] + sample;
+  adcPrecision.samples[head] = sample;
+  adcPrecision.head = (head + 1) & (adcRingSize - 1);
+  if (adcPrecision.count < adcRingSize) adcPrecision.count++;
+}
+
+int32_t adcPrecisionAverage() {
+  if (adcPrecision.count < adcRingSize) {               // still filling, low rates take a while
+    return adcPrecision.count ? adcPrecision.sum / adcPrecision.count : 0;
+  }
+  return adcPrecision.sum >> adcRingShift;              // arithmetic shift, sum is signed
+}
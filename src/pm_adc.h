@@ -0,0 +1,64 @@
+#ifndef pm_adc_h
+#define pm_adc_h
+
+#include <Arduino.h>
+
+// Free-running acquisition engine. Conversions are started by a hardware
+// trigger (Timer0 overflow on the 328P, RTC PIT through the event system on
+// the 4808/4809) and the result-ready interrupt scans the channels round robin
+// into a per-channel ring buffer. loop() only ever consumes finished averages.
+// The NAU7802 precision channel is fetched from loop() and pushed into a
+// ring of its own, see pm_nau7802.h.
+//
+// The thermistors change slowly, so a scan round is the fast channels plus
+// one thermistor in turn. That keeps the current channel at a quarter of the
+// conversion rate instead of a sixth.
+//
+// The conversion rate can be divided down by a power of two at run time, see
+// pm_rate.h. A divided rate arms a wake window around the current channel's
+// rest reading, the first current conversion outside it puts the ISR back on
+// the full rate without waiting for loop().
+
+const uint8_t adcFastChannels = 3;      // adc0 current, adc1 bus voltage, adc2 pack voltage
+const uint8_t adcThermFirst   = adcFastChannels;   // T0, T1, T2 follow the fast channels
+const uint8_t adcChannelCount = adcFastChannels + 3;
+const uint8_t adcRoundSlots   = adcFastChannels + 1;   // conversions per scan round, the current channel's share
+const uint8_t adcRingSize     = 16;     // samples averaged per channel, power of two so the average is a shift
+const uint8_t adcRingShift    = 4;      // log2(adcRingSize)
+const uint8_t adcShiftMax     = 3;      // slowest rate is adcSampleRateHz / 8
+
+#if defined(__AVR_ATmega4808__) || defined(__AVR_ATmega4809__)
+const uint16_t adcSampleRateHz = 512;   // RTC PIT event, CLK_RTC / 64
+#elif defined(__AVR_ATmega328P__)
+const uint16_t adcSampleRateHz = 976;   // Timer0 overflow, 16MHz / 64 / 256
+#else
+const uint16_t adcSampleRateHz = 1000;  // software paced by adcPoll()
+#endif
+
+struct ADC_RING {
+  uint16_t samples[adcRingSize] = {};   // last N raw conversions
+  uint16_t sum                  = 0;    // running sum of samples[], 16 x 1023 fits in 16 bits
+  uint8_t  head                 = 0;    // next slot to overwrite
+};
+
+struct ADC_RING24 {
+  int32_t  samples[adcRingSize] = {};   // last N signed 24-bit conversions
+  int32_t  sum                  = 0;    // 16 x 2^23 fits in 28 bits
+  uint8_t  head                 = 0;
+  uint8_t  count                = 0;    // valid samples, the average is only taken over these until the ring fills
+};
+
+void     adcBegin(const uint8_t *adcPins);   // start scanning adcChannelCount pins, fast channels first
+void     adcPoll();                          // software pacing on targets without a trigger source, no-op otherwise
+bool     adcFrameReady();                    // true once every fast ring has been refilled since the last call
+uint16_t adcAverage(uint8_t channel);        // averaged raw reading for a channel
+uint32_t adcSampleCount();                   // total conversions since boot
+void     adcSetRate(uint8_t shift, uint16_t wakeLo, uint16_t wakeHi);   // adcSampleRateHz >> shift, full rate again once a current conversion leaves wakeLo..wakeHi
+uint8_t  adcRateShift();                     // shift in effect, 0 after the ISR woke up
+void     adcPushPrecision(int32_t sample);   // loop: store one precision channel conversion
+int32_t  adcPrecisionAverage();              // loop: averaged precision reading, signed 24-bit counts
+#ifdef PM_BENCH
+void     adcBenchStore(uint16_t sample);     // run the ISR body once, for pm_bench
+#endif
+
+#endif
@@ -0,0 +1,210 @@
+#ifdef PM_BENCH
+
+#include <Arduino.h>
+#include "pm_bench.h"
+#include "pm_struct.h"
+#include "pm_buffers.h"
+#include "pm_adc.h"
+#include "pm_snapshot.h"
+
+// hot paths that live in main.cpp
+void receiveDispatch(I2C_RX_DATA &rxData);
+void requestEvent();
+void convertFrame();
+void captureSnapshot();
+
+static char benchLine[96];
+
+#if defined(__AVR_ATmega4808__) || defined(__AVR_ATmega4809__)
+
+static const char benchTarget[] = "atmega4809";
+static const char benchUnit[]   = "cycles";
+
+static void benchTimerBegin() {
+  TCB1.CCMP  = 0xFFFF;                                    // periodic mode wrapping at 16 bits
+  TCB1.CTRLB = TCB_CNTMODE_INT_gc;
+  TCB1.CTRLA = TCB_CLKSEL_CLKDIV1_gc | TCB_ENABLE_bm;     // one count per CPU cycle
+}
+
+static inline void benchTimerReset() {
+  TCB1.CNT      = 0;
+  TCB1.INTFLAGS = TCB_CAPT_bm;                            // wrap flag
+}
+
+static inline uint32_t benchTimerRead() {
+  uint16_t count = TCB1.CNT;
+  bool wrapped = TCB1.INTFLAGS & TCB_CAPT_bm;
+  return (wrapped && count < 0x8000) ? 0x10000UL + count : count;   // one wrap, paths up to 128k cycles
+}
+
+static void benchHalt() {
+  Serial.flush();
+  cli();
+  SLPCTRL.CTRLA = SLPCTRL_SMODE_PDOWN_gc | SLPCTRL_SEN_bm;
+  __asm__ __volatile__ ("sleep");                         // simavr exits on sleep with interrupts off
+}
+
+#elif defined(__AVR_ATmega328P__)
+
+static const char benchTarget[] = "atmega328p";
+static const char benchUnit[]   = "cycles";
+
+static void benchTimerBegin() {
+  TIMSK0 &= ~(1<<TOIE0);                                  // no millis() tick inside the measurements
+  TCCR1A = 0;
+  TCCR1B = (1<<CS10);                                     // normal mode, CLK / 1
+}
+
+static inline void benchTimerReset() {
+  TCNT1 = 0;
+  TIFR1 = (1<<TOV1);
+}
+
+static inline uint32_t benchTimerRead() {
+  uint16_t count = TCNT1;
+  bool wrapped = TIFR1 & (1<<TOV1);
+  return (wrapped && count < 0x8000) ? 0x10000UL + count : count;
+}
+
+static void benchHalt() {
+  Serial.flush();
+  cli();
+  SMCR = (1<<SM1) | (1<<SE);                              // power down
+  __asm__ __volatile__ ("sleep");
+}
+
+#else
+
+#include <chrono>
+
+static const char benchTarget[] = "native";
+static const char benchUnit[]   = "ns";
+static std::chrono::steady_clock::time_point benchStart;
+
+static void benchTimerBegin() { }
+
+static inline void benchTimerReset() {
+  benchStart = std::chrono::steady_clock::now();
+}
+
+static inline uint32_t benchTimerRead() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - benchStart).count();
+}
+
+static void benchHalt() {
+  fflush(stdout);
+  exit(0);
+}
+
+#endif
+
+static uint32_t benchOverhead = 0;      // cost of an empty measurement
+static bool     benchFirst    = true;   // no comma before the first result
+
+static void benchOut(const char *text) {
+#ifdef PM_NATIVE
+  fputs(text, stdout);                  // Serial is stderr on native
+#else
+  Serial.print(text);
+#endif
+}
+
+template <typename F>
+static void benchTime(BENCH_STAT &stat, F fn) {
+  noInterrupts();
+  benchTimerReset();
+  fn();
+  uint32_t ticks = benchTimerRead();
+  interrupts();
+  ticks = (ticks > benchOverhead) ? ticks - benchOverhead : 0;
+  if (ticks < stat.min) stat.min = ticks;
+  if (ticks > stat.max) stat.max = ticks;
+  stat.total += ticks;
+  stat.count++;
+}
+
+template <typename F>
+static void benchPath(const char *path, int16_t reg, F fn) {
+  BENCH_STAT stat;
+  for (uint8_t round = 0; round < benchRounds; round++) benchTime(stat, fn);
+
+  char regText[8] = "null";
+  if (reg >= 0) sprintf(regText, "\"0x%02X\"", reg);
+  sprintf(benchLine, "%s\n    {\"path\": \"%s\", \"reg\": %s, \"min\": %lu, \"avg\": %lu, \"max\": %lu}",
+          benchFirst ? "" : ",", path, regText, (unsigned long) stat.min,
+          (unsigned long) (stat.total / stat.count), (unsigned long) stat.max);
+  benchOut(benchLine);
+  benchFirst = false;
+}
+
+// drop whatever a dispatch left behind so every round starts from the same state
+static void benchDrain() {
+  while (rxPeek()) rxRelease();
+  txTake();
+}
+
+// one register through the receive ISR body, the command byte is already in the slot
+static void benchDispatch(uint8_t cmd, const char *path) {
+  benchPath(path, cmd, [cmd]() {
+    I2C_RX_DATA &rxData = rxReserve();
+    rxData.cmdAddr    = cmd;
+    rxData.dataLen    = 0;
+    rxData.cmdData[0] = '\0';
+    receiveDispatch(rxData);
+  });
+  benchDrain();
+}
+
+void benchRun(const REG_ENTRY *table) {
+  benchTimerBegin();
+
+  BENCH_STAT empty;
+  for (uint8_t round = 0; round < benchRounds; round++) benchTime(empty, []() { });
+  benchOverhead = empty.min;
+
+  regCacheRefresh(table);                                 // replies render from a warm cache
+  captureSnapshot();
+
+  sprintf(benchLine, "\nBENCH-BEGIN\n{\"target\": \"%s\", \"unit\": \"%s\", \"rounds\": %u, \"overhead\": %lu, \"results\": [",
+          benchTarget, benchUnit, benchRounds, (unsigned long) benchOverhead);
+  benchOut(benchLine);
+
+  // receiveEvent() after the bytes are read, every register in ascii and binary
+  for (uint8_t reg = regFirst; reg <= regLast; reg++) {
+    REG_ENTRY entry;
+    memcpy_P(&entry, &table[reg - regFirst], sizeof(entry));
+    benchDispatch(reg, "receiveDispatch");
+    if (regWidth(entry.type)) benchDispatch(reg | regBinaryFlag, "receiveDispatch");
+  }
+
+  // requestEvent() with a reply waiting, publishing is part of each round
+  benchPath("requestEvent", -1, []() {
+    txBack().dataLen = 6;
+    txPublish();
+    requestEvent();
+  });
+  benchPath("requestEvent.idle", -1, []() { requestEvent(); });
+
+  // the buffers that replaced clearTXBuffer()/clearRXBuffer()
+  benchPath("txPublish+txTake", -1, []() {
+    txPublish();
+    txTake();
+  });
+  benchPath("rxCommit+rxRelease", -1, []() {
+    rxCommit();
+    rxPeek();
+    rxRelease();
+  });
+
+  // acquisition: the ISR body, and loop()'s conversion block that replaced readADC() and the float math
+  uint16_t sample = 0;
+  benchPath("adcStore", -1, [&sample]() { adcBenchStore(sample++ & 0x3FF); });
+  benchPath("convertFrame", -1, []() { convertFrame(); });
+  benchPath("captureSnapshot", -1, []() { captureSnapshot(); });
+  benchPath("regCacheRefresh", -1, [table]() { regCacheRefresh(table); });
+
+  benchOut("\n]}\nBENCH-END\n");
+  benchHalt();
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef pm_bench_h
+#define pm_bench_h
+
+#include <Arduino.h>
+#include "pm_registers.h"
+
+// Hot path benchmark, only built with -D PM_BENCH (env:bench_328p,
+// env:bench_4809, env:bench_native). setup() hands over to benchRun() before
+// the acquisition engine and the Wire handlers start, every path is timed with
+// interrupts off and the results go out as one JSON document, then the part
+// halts. On AVR the unit is CPU cycles from a free-running 16-bit timer at
+// CLK_PER / 1, so simavr and a real board give the same numbers; the native
+// build reports host nanoseconds.
+
+const uint8_t benchRounds = 32;         // calls per path, min/avg/max over these
+
+struct BENCH_STAT {
+  uint32_t min   = UINT32_MAX;
+  uint32_t max   = 0;
+  uint32_t total = 0;
+  uint8_t  count = 0;
+};
+
+void benchRun(const REG_ENTRY *table);  // never returns on AVR
+
+#endif
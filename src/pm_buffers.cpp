@@ -0,0 +1,57 @@
+#include <Arduino.h>
+#include "pm_buffers.h"
+
+static I2C_TX_DATA      txBuffer[2];
+static volatile uint8_t txFront     = 0;        // index of the buffer requestEvent() sends
+static volatile bool    txPending   = false;    // front buffer holds a reply not yet sent
+
+static I2C_RX_DATA      rxQueue[rxQueueSize];
+static volatile uint8_t rxHead      = 0;        // next slot loop() consumes
+static volatile uint8_t rxTail      = 0;        // slot the ISR receives into
+static volatile uint16_t rxDropped  = 0;
+
+I2C_TX_DATA &txBack() {
+  return txBuffer[txFront ^ 1];
+}
+
+void txPublish() {
+  txFront ^= 1;                                 // single byte store, never torn
+  txPending = true;
+}
+
+const I2C_TX_DATA *txTake() {
+  if (!txPending) return nullptr;
+  txPending = false;
+  return &txBuffer[txFront];
+}
+
+I2C_RX_DATA &rxReserve() {
+  return rxQueue[rxTail];
+}
+
+bool rxCommit() {
+  uint8_t next = (rxTail + 1) & (rxQueueSize - 1);
+  if (next == rxHead) {                         // full, the reserved slot gets reused by the next write
+    rxDropped++;
+    return false;
+  }
+  rxTail = next;
+  return true;
+}
+
+I2C_RX_DATA *rxPeek() {
+  if (rxHead == rxTail) return nullptr;
+  return &rxQueue[rxHead];
+}
+
+void rxRelease() {
+  rxHead = (rxHead + 1) & (rxQueueSize - 1);
+}
+
+uint16_t rxOverruns() {
+  uint16_t dropped;
+  noInterrupts();
+  dropped = rxDropped;
+  interrupts();
+  return dropped;
+}
@@ -0,0 +1,26 @@
+#ifndef pm_buffers_h
+#define pm_buffers_h
+
+#include <Arduino.h>
+#include "pm_struct.h"
+
+// Buffers shared between the Wire ISRs and loop(). Replies are double
+// buffered: the producer fills the back buffer and publishes it with an index
+// swap, requestEvent() only ever sends the front one. Received commands go
+// into a single-producer/single-consumer ring, the tail slot is always free so
+// the receive ISR can read into it before deciding whether to commit it.
+// Nothing is cleared byte by byte, dataLen says how much of a buffer is valid.
+
+const uint8_t rxQueueSize = 8;          // power of two, holds rxQueueSize - 1 pending commands
+
+I2C_TX_DATA       &txBack();            // reply buffer the producer may write
+void               txPublish();         // swap the back buffer in as the next reply
+const I2C_TX_DATA *txTake();            // next reply for requestEvent(), nullptr if none is pending
+
+I2C_RX_DATA       &rxReserve();         // ISR: slot to receive the next command into
+bool               rxCommit();          // ISR: queue the reserved slot, false (and counted) if the queue is full
+I2C_RX_DATA       *rxPeek();            // loop: oldest pending command, nullptr if empty
+void               rxRelease();         // loop: done with the command returned by rxPeek()
+uint16_t           rxOverruns();        // commands dropped because the queue was full
+
+#endif
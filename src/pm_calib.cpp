@@ -0,0 +1,31 @@
+#include <Arduino.h>
+#include "pm_calib.h"
+#include "pm_coulomb.h"
+#include "pm_fram.h"
+
+static CAL_CHANNEL calActive[calChannels] = { calDefaults[0], calDefaults[1], calDefaults[2] };
+
+void calBegin() {
+  for (uint8_t ch = 0; ch < calChannels; ch++) {
+    int32_t gain = (int32_t) framRead32(calRegGain + ch);
+    calActive[ch].gainQ16 = (gain > 0 && gain < INT32_MAX / 1024) ? gain : calDefaults[ch].gainQ16;
+    calActive[ch].offset  = calDefaults[ch].offset;
+  }
+  uint16_t zero = (uint16_t) framRead32(calRegZero);
+  if (zero > 0 && zero < 1024) calActive[0].offset = zero;
+
+  // the integrator works in uA per lsb
+  coulombCalibrate(calActive[0].offset, (int32_t) (((int64_t) calActive[0].gainQ16 * 1000 + 0x8000) >> 16));
+}
+
+int32_t calToMilli(uint8_t channel, uint16_t raw) {
+  return calApply(calActive[channel], raw);
+}
+
+const CAL_CHANNEL &calChannel(uint8_t channel) {
+  return calActive[channel];
+}
+
+int32_t calPrecisionUa(int32_t counts, uint8_t gainCode) {
+  return calPrecisionApply(calPrecisionDefault, gainCode, counts);
+}
@@ -0,0 +1,88 @@
+#ifndef pm_calib_h
+#define pm_calib_h
+
+#include <stdint.h>
+
+// ADC calibration. Each channel converts a raw reading to milli-units with one
+// integer multiply and shift: milli = ((raw - offset) * gainQ16 + 0x8000) >> 16.
+// The defaults are computed at compile time from the build flags below, a
+// non-zero value in the matching FRAM register overrides them at runtime.
+// This header only needs <stdint.h> so the kernels can be benchmarked on a host.
+
+#ifndef CAL_VCC_MV
+#define CAL_VCC_MV 4430                 // adc reference, mV
+#endif
+#ifndef CAL_SENSE_UV_PER_A
+#define CAL_SENSE_UV_PER_A 136000       // current sensor sensitivity, uV per amp
+#endif
+#ifndef CAL_ZERO_LSB
+#define CAL_ZERO_LSB 512                // raw reading at zero current, sensor output is vcc / 2
+#endif
+#ifndef CAL_VDIV_BUS_PPM
+#define CAL_VDIV_BUS_PPM 500000         // bus voltage divider ratio, parts per million, RBUS1/RBUS2 50K/50K
+#endif
+#ifndef CAL_VDIV_PACK_PPM
+#define CAL_VDIV_PACK_PPM 200000        // pack voltage divider ratio, parts per million, RPACK1/RPACK2 120K/30K
+#endif
+#ifndef CAL_NAU_VREF_MV
+#define CAL_NAU_VREF_MV 3300             // NAU7802 reference, the internal ldo
+#endif
+#ifndef CAL_NAU_SHUNT_UOHM
+#define CAL_NAU_SHUNT_UOHM 500          // shunt across the NAU7802 inputs, micro-ohm
+#endif
+
+const uint8_t calChannels   = 3;        // same order as the adc channels: current, bus, pack
+const uint8_t calRegZero    = 0x58;     // current zero offset override, lsb
+const uint8_t calRegGain    = 0x59;     // first of three Q16 gain overrides, current, bus, pack
+
+struct CAL_CHANNEL {
+  int32_t  gainQ16;                     // milli-units per lsb, Q16
+  uint16_t offset;                      // raw reading that maps to zero
+};
+
+// mA per lsb in Q16: vcc / 1024 mV per lsb, divided by the sensor mV per amp, times 1000
+constexpr int32_t calCurrentGainQ16(int64_t vccMv, int64_t senseUvPerA) {
+  return (int32_t) ((vccMv * 1000000LL * 64 + senseUvPerA / 2) / senseUvPerA);
+}
+
+// mV per lsb in Q16: vcc / 1024 mV per lsb, divided by the divider ratio
+constexpr int32_t calVoltageGainQ16(int64_t vccMv, int64_t dividerPpm) {
+  return (int32_t) ((vccMv * 1000000LL * 64 + dividerPpm / 2) / dividerPpm);
+}
+
+constexpr CAL_CHANNEL calDefaults[calChannels] = {
+  { calCurrentGainQ16(CAL_VCC_MV, CAL_SENSE_UV_PER_A), CAL_ZERO_LSB },
+  { calVoltageGainQ16(CAL_VCC_MV, CAL_VDIV_BUS_PPM),   0 },
+  { calVoltageGainQ16(CAL_VCC_MV, CAL_VDIV_PACK_PPM),  0 },
+};
+
+// a full scale 10-bit reading must not overflow the int32 product
+static_assert(calDefaults[0].gainQ16 < INT32_MAX / 1024, "current gain too large for a 32-bit multiply");
+static_assert(calDefaults[1].gainQ16 < INT32_MAX / 1024, "bus voltage gain too large for a 32-bit multiply");
+static_assert(calDefaults[2].gainQ16 < INT32_MAX / 1024, "pack voltage gain too large for a 32-bit multiply");
+
+// uA per NAU7802 count in Q16 at PGA gain 1: vref / 2^24 V per count, divided by the shunt
+constexpr int32_t calPrecisionGainQ16(int64_t vrefMv, int64_t shuntUohm) {
+  return (int32_t) ((vrefMv * 1000000000LL + shuntUohm * 128) / (shuntUohm * 256));
+}
+
+const int32_t calPrecisionDefault = calPrecisionGainQ16(CAL_NAU_VREF_MV, CAL_NAU_SHUNT_UOHM);
+static_assert(calPrecisionDefault > 0, "NAU7802 shunt too large for Q16 uA per count");
+
+// signed 24-bit counts at PGA gain 2^gainCode to uA, 64-bit because the counts alone take 24 bits,
+// saturates when a low gain puts full scale beyond the int32 range
+inline int32_t calPrecisionApply(int32_t gainQ16, uint8_t gainCode, int32_t counts) {
+  int64_t ua = (((int64_t) counts * gainQ16) >> gainCode) / 65536;
+  return ua > INT32_MAX ? INT32_MAX : ua < -INT32_MAX ? -INT32_MAX : (int32_t) ua;
+}
+
+inline int32_t calApply(const CAL_CHANNEL &cal, uint16_t raw) {
+  return (((int32_t) raw - (int32_t) cal.offset) * cal.gainQ16 + 0x8000) >> 16;
+}
+
+void    calBegin();                     // load the FRAM overrides, call after framBegin()
+int32_t calToMilli(uint8_t channel, uint16_t raw);
+const CAL_CHANNEL &calChannel(uint8_t channel);
+int32_t calPrecisionUa(int32_t counts, uint8_t gainCode);   // NAU7802 counts to uA
+
+#endif
@@ -0,0 +1,219 @@
+#include <Arduino.h>
+#include "pm_clock.h"
+#include "pm_codec.h"
+
+static FramBus     *clkBus      = nullptr;
+static CLOCK_RECORD clkState;                   // time is filled in by clockPersist()
+static CLOCK_RECORD clkSaved;                   // record as last written to FRAM
+static bool         clkValid    = false;
+
+// wall clock at the last fold: whole seconds and ticks into the next one
+static uint64_t     clkRaw      = 0;
+static uint32_t     clkSeconds  = 0;
+static uint16_t     clkTicks    = 0;
+static int32_t      clkCarry    = 0;            // correction below one tick, 2^-24 ticks
+static int32_t      clkRateQ24  = 0;            // correction per tick, 2^-24
+
+// reference for the next drift estimate, host time in ticks at a sync this boot
+static bool         clkRefSet   = false;
+static uint64_t     clkRefRaw   = 0;
+static uint64_t     clkRefHost  = 0;
+
+static uint32_t     clkLatchSeconds = 0;        // 0x62 and 0x1D from the same reading
+static uint16_t     clkLatchMs      = 0;
+
+#if defined(__AVR_ATmega4808__) || defined(__AVR_ATmega4809__)
+
+static volatile uint32_t clkOverflows = 0;      // upper bits of the RTC count
+
+ISR(RTC_CNT_vect) {
+  uint8_t flags = RTC.INTFLAGS;
+  if (flags & RTC_OVF_bm) clkOverflows++;
+  if (flags & RTC_CMP_bm) RTC.INTCTRL = RTC_OVF_bm;   // timed wake, one shot
+  RTC.INTFLAGS = flags;
+}
+
+static void clockStartHardware() {
+  while (RTC.STATUS > 0) {}                     // clock source was selected by adcStartHardware()
+  RTC.PER     = 0xFFFF;                         // free-running, 2s around
+  while (RTC.STATUS > 0) {}
+  RTC.INTCTRL = RTC_OVF_bm;
+  RTC.CTRLA   = RTC_PRESCALER_DIV1_gc | RTC_RUNSTDBY_bm | RTC_RTCEN_bm;
+}
+
+static void clockFoldHardware() { }
+
+uint64_t clockTicks() {
+  uint8_t sreg = SREG;                          // also called from powerSleep() with interrupts off
+  noInterrupts();
+  uint16_t cnt = RTC.CNT;
+  uint32_t ovf = clkOverflows;
+  if ((RTC.INTFLAGS & RTC_OVF_bm) && cnt < 0x8000) ovf++;   // wrapped, the isr has not run yet
+  SREG = sreg;
+  return ((uint64_t) ovf << 16) | cnt;
+}
+
+void clockWakeIn(uint16_t ticks) {
+  while (RTC.STATUS & RTC_CMPBUSY_bm) {}
+  RTC.CMP      = RTC.CNT + ticks;
+  RTC.INTFLAGS = RTC_CMP_bm;
+  RTC.INTCTRL  = RTC_OVF_bm | RTC_CMP_bm;
+}
+
+void clockWakeCancel() {
+  RTC.INTCTRL = RTC_OVF_bm;
+}
+
+#else
+
+// micros() scaled to 32.768kHz ticks, 4096 / 125000 is 32768 / 1000000
+static uint32_t clkMicros   = 0;                // micros() at the last fold
+static uint64_t clkBaseTick = 0;                // ticks at clkMicros
+static uint32_t clkBaseRem  = 0;                // us * 4096 short of the next tick
+
+static void clockStartHardware() {
+  clkMicros = micros();
+}
+
+// micros() wraps after 71 minutes, clockService() folds it in well before
+static void clockFoldHardware() {
+  uint32_t nowUs  = micros();
+  uint64_t scaled = (uint64_t) (uint32_t) (nowUs - clkMicros) * 4096 + clkBaseRem;
+  clkBaseTick += scaled / 125000;
+  clkBaseRem   = scaled % 125000;
+  clkMicros    = nowUs;
+}
+
+uint64_t clockTicks() {
+  uint32_t us = (uint32_t) micros() - clkMicros;
+  return clkBaseTick + ((uint64_t) us * 4096 + clkBaseRem) / 125000;
+}
+
+#endif
+
+// wall clock at a raw count, carry is the correction remainder left over
+static void clockAt(uint64_t raw, uint32_t &seconds, uint16_t &ticks, int32_t &carry) {
+  int64_t delta  = (int64_t) (raw - clkRaw);
+  int64_t scaled = delta * clkRateQ24 + clkCarry;
+  int64_t adjust = scaled >> 24;                // arithmetic shift, rounds towards minus infinity
+  int64_t total  = (int64_t) clkTicks + delta + adjust;
+  carry   = (int32_t) (scaled - (adjust << 24));
+  seconds = clkSeconds + (uint32_t) (total >> clockHzShift);
+  ticks   = (uint16_t) (total & (clockHz - 1));
+}
+
+static void clockSetRate(int32_t ppb) {
+  clkState.driftPpb = ppb;
+  clkRateQ24        = (int32_t) (((int64_t) ppb << 24) / 1000000000LL);
+}
+
+void clockBegin(FramBus &bus) {
+  clkBus = &bus;
+  clockStartHardware();
+
+  bool valid = bus.read(clockBase, (uint8_t *) &clkState, sizeof(clkState)) && clkState.magic == clockMagic
+               && clkState.crc == crc8((const uint8_t *) &clkState, sizeof(clkState) - 1);
+  if (!valid) {
+    memset(&clkState, 0, sizeof(clkState));
+    clkState.magic = clockMagic;
+  }
+  clkSaved       = clkState;
+  clkSaved.magic = valid ? clockMagic : 0;      // a fresh record is written on the first persist
+
+  clkRaw     = clockTicks();
+  clkSeconds = clkState.time;                   // carries on where the last boot left off
+  clkTicks   = 0;
+  clkCarry   = 0;
+  clkValid   = clkState.time != 0;
+  clkRefSet  = false;                           // the timebase restarted, a new reference is needed
+  clockSetRate(clkState.driftPpb);
+}
+
+void clockService() {
+  clockFoldHardware();
+  uint64_t raw = clockTicks();
+  clockAt(raw, clkSeconds, clkTicks, clkCarry);
+  clkRaw = raw;
+}
+
+void clockPersist() {
+  if (!clkBus) return;
+  clkState.time = clkValid ? clockNow() : 0;
+  if (!memcmp(&clkState, &clkSaved, sizeof(CLOCK_RECORD) - 1)) return;
+  clkState.crc = crc8((const uint8_t *) &clkState, sizeof(CLOCK_RECORD) - 1);
+  if (clkBus->write(clockBase, (const uint8_t *) &clkState, sizeof(CLOCK_RECORD))) clkSaved = clkState;
+}
+
+bool clockParse(const char *text, uint32_t &seconds, uint16_t &ms) {
+  char *end;
+  seconds = strtoul(text, &end, 10);
+  ms      = 0;
+  if (*end == '.') {                            // up to three fraction digits count, the rest is ignored
+    uint16_t scale = 100;
+    for (const char *c = end + 1; *c >= '0' && *c <= '9' && scale; c++, scale /= 10) ms += (*c - '0') * scale;
+  }
+  return seconds > 1000000000UL;
+}
+
+void clockSync(uint32_t seconds, uint16_t ms) {
+  clockService();
+  uint64_t raw  = clockTicks();
+  uint64_t host = ((uint64_t) seconds << clockHzShift) + (uint32_t) ms * clockHz / 1000;
+
+  if (clkRefSet && raw - clkRefRaw >= (uint64_t) clockDriftMinS * clockHz) {
+    int64_t elapsed  = (int64_t) (raw - clkRefRaw);
+    int64_t error    = (int64_t) (host - clkRefHost) - elapsed;    // ticks the raw count fell behind
+    int64_t measured = error * 1000000000LL / elapsed;
+    if (measured >= -clockDriftMaxPpb && measured <= clockDriftMaxPpb) {
+      int32_t ppb = clkState.driftPpb;
+      if (clkState.flags & clockFlagDrift) ppb += ((int32_t) measured - ppb) / (1 << clockDriftShift);
+      else                                 ppb  = (int32_t) measured;
+      clockSetRate(ppb);
+      clkState.flags |= clockFlagDrift;
+    }
+    clkRefSet = false;                          // measured against, the sync below is the next reference
+  }
+  if (!clkRefSet) {                             // short intervals keep the older, longer reference
+    clkRefRaw  = raw;
+    clkRefHost = host;
+    clkRefSet  = true;
+  }
+
+  clkRaw     = raw;                             // step to the host time
+  clkSeconds = seconds;
+  clkTicks   = (uint16_t) ((uint32_t) ms * clockHz / 1000);
+  clkCarry   = 0;
+  clkValid   = true;
+  clkState.lastSync = seconds;
+  if (!clkState.firstSync) clkState.firstSync = seconds;
+}
+
+uint32_t clockNow() {
+  uint32_t seconds;
+  uint16_t ticks;
+  int32_t  carry;
+  clockAt(clockTicks(), seconds, ticks, carry);
+  return seconds;
+}
+
+bool clockValid() {
+  return clkValid;
+}
+
+int32_t clockRead(uint8_t reg) {
+  switch (reg) {
+    case clockFracReg: {                        // read ahead of 0x62 by the cache refresh, latches both
+      uint16_t ticks;
+      int32_t  carry;
+      clockAt(clockTicks(), clkLatchSeconds, ticks, carry);
+      clkLatchMs = (uint16_t) (((uint32_t) ticks * 1000) >> clockHzShift);
+      return clkLatchMs;
+    }
+    case clockDriftReg: return clkState.driftPpb;
+    case 0x61:          return clkState.firstSync;
+    case 0x62:          return clkLatchSeconds;
+    case 0x63:          return clkState.lastSync ? clockNow() - clkState.lastSync : 0;
+    case 0x64:          return (int32_t) (clockTicks() >> clockHzShift);
+  }
+  return 0;
+}
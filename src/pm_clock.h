@@ -0,0 +1,69 @@
+#ifndef pm_clock_h
+#define pm_clock_h
+
+#include <Arduino.h>
+#include "pm_fram.h"
+#include "pm_log.h"
+
+// Wall clock on a 32.768kHz timebase. The raw count is a monotonic tick count
+// since reset that never steps:
+//
+//   4808/4809  RTC counter on the 32.768kHz oscillator the PIT also runs from,
+//              extended past 16 bits by its overflow interrupt. Keeps counting
+//              in standby, pm_power.h measures its sleeps on it.
+//   328P       micros() on the crystal scaled to 32.768kHz ticks, no RTC here
+//   native     simulated micros(), scaled the same way
+//
+// The wall clock follows the raw count through a drift correction. A 0x60
+// sync steps the clock to the host time, sub-second when the host sends a
+// fraction, and once clockDriftMinS have gone by since the sync it is
+// measured against, the difference between the two intervals gives the
+// oscillator error. The first estimate replaces the correction, later ones
+// move it a 2^clockDriftShift of the way, a bad sync outside clockDriftMaxPpb
+// only steps the clock.
+//
+// Time, first and last sync and the correction live in a CRC'd record between
+// the state of charge record and the log. After a reset the clock carries on
+// from the last time written, the correction from the last estimate, and the
+// next sync restarts the measurement.
+
+const uint16_t clockBase         = 0x01E0;      // clock record, between the soc record and the log
+const uint8_t  clockMagic        = 0xC1;
+const uint32_t clockHz           = 32768;       // timebase ticks per second
+const uint8_t  clockHzShift      = 15;
+const uint16_t clockDriftMinS    = 600;         // syncs closer than this to the reference only step the clock
+const int32_t  clockDriftMaxPpb  = 50000000;    // 5%, the internal oscillators are well inside this
+const uint8_t  clockDriftShift   = 1;           // later estimates move the correction half way
+const uint8_t  clockFracReg      = 0x1D;        // sub-second part of 0x62, ms
+const uint8_t  clockDriftReg     = 0x1E;        // drift correction, ppb
+
+const uint8_t  clockFlagDrift    = 0x01;        // the correction comes from a measurement
+
+struct __attribute__((packed)) CLOCK_RECORD {
+  uint8_t  magic;                               // clockMagic
+  uint8_t  flags;
+  uint32_t time;                                // unix seconds when written, 0 while never set
+  uint32_t firstSync;                           // first 0x60 ever
+  uint32_t lastSync;                            // newest 0x60
+  int32_t  driftPpb;                            // correction, positive when the timebase runs slow
+  uint8_t  crc;                                 // crc8 over everything before it
+};
+
+static_assert(clockBase + sizeof(CLOCK_RECORD) <= logBase, "clock record runs into the log");
+
+void     clockBegin(FramBus &bus);              // after framBegin(), starts the timebase and restores the record
+void     clockService();                        // loop: at least once a second, folds the elapsed ticks in
+void     clockPersist();                        // loop: write the record back if it changed
+bool     clockParse(const char *text, uint32_t &seconds, uint16_t &ms);   // "seconds[.fraction]", false at 1000000000 or below
+void     clockSync(uint32_t seconds, uint16_t ms);
+uint32_t clockNow();                            // unix seconds, seconds since reset while never set
+bool     clockValid();                          // set by a sync, now or before the last reset
+uint64_t clockTicks();                          // raw ticks since reset, safe with interrupts off
+int32_t  clockRead(uint8_t reg);                // 0x1D, 0x1E and 0x61 to 0x64
+
+#if defined(__AVR_ATmega4808__) || defined(__AVR_ATmega4809__)
+void     clockWakeIn(uint16_t ticks);           // one-shot RTC compare interrupt, ends a standby sleep
+void     clockWakeCancel();
+#endif
+
+#endif
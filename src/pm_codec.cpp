@@ -0,0 +1,103 @@
+#include <string.h>
+#include "pm_codec.h"
+
+uint8_t crc8(const uint8_t *data, uint8_t len, uint8_t crc) {
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (uint8_t) ((crc << 1) ^ 0x07) : (uint8_t) (crc << 1);
+    }
+  }
+  return crc;
+}
+
+// little-endian groups of seven bits, bit 7 set on every byte but the last
+uint8_t codecPutVarint(uint8_t *out, uint8_t room, uint32_t value) {
+  uint8_t len = 0;
+  do {
+    if (len >= room) return 0;
+    uint8_t low = value & 0x7F;
+    value >>= 7;
+    out[len++] = value ? (low | 0x80) : low;
+  } while (value);
+  return len;
+}
+
+uint8_t codecGetVarint(const uint8_t *in, uint8_t len, uint32_t &value) {
+  uint32_t result = 0;
+  for (uint8_t pos = 0; pos < len && pos < codecVarintMax; pos++) {
+    result |= (uint32_t) (in[pos] & 0x7F) << (7 * pos);
+    if (!(in[pos] & 0x80)) {
+      value = result;
+      return pos + 1;
+    }
+  }
+  return 0;
+}
+
+void codecKey(CODEC_STREAM &stream, const int32_t *key, uint8_t fields) {
+  stream.fields = (fields > codecFieldsMax) ? codecFieldsMax : fields;
+  memcpy(stream.last, key, stream.fields * sizeof(int32_t));
+  stream.repeat = codecNoRepeat;
+}
+
+bool codecAppend(CODEC_STREAM &stream, uint8_t *buf, uint8_t &used, uint8_t size, const int32_t *cur) {
+  uint8_t mask = 0;
+  for (uint8_t field = 0; field < stream.fields; field++) {
+    if (cur[field] != stream.last[field]) mask |= 1 << field;
+  }
+
+  if (!mask) {                                                // same again, count it into the open repeat token
+    if (stream.repeat != codecNoRepeat && buf[stream.repeat] < codecTokRepeatMax) {
+      buf[stream.repeat]++;
+      return true;
+    }
+    if (used >= size) return false;
+    stream.repeat = used;
+    buf[used++]   = codecTokRepeat;
+    return true;
+  }
+
+  uint8_t tok[1 + codecFieldsMax * codecVarintMax];
+  uint8_t len = 1;
+  tok[0] = codecTokDelta | mask;
+  for (uint8_t field = 0; field < stream.fields; field++) {
+    if (!(mask & (1 << field))) continue;
+    int32_t delta = (int32_t) ((uint32_t) cur[field] - (uint32_t) stream.last[field]);   // wraps, the decoder wraps back
+    len += codecPutVarint(&tok[len], sizeof(tok) - len, codecZigzag(delta));
+  }
+  if ((uint16_t) used + len > size) return false;
+
+  memcpy(&buf[used], tok, len);
+  used += len;
+  memcpy(stream.last, cur, stream.fields * sizeof(int32_t));
+  stream.repeat = codecNoRepeat;
+  return true;
+}
+
+uint8_t codecNext(CODEC_STREAM &stream, const uint8_t *in, uint8_t len, uint8_t &samples) {
+  if (!len || in[0] >= codecTokUser) return 0;
+  uint8_t tok = in[0];
+  if (tok < codecTokDelta) {
+    samples = (tok & codecTokRepeatMax) + 1;
+    return 1;
+  }
+
+  uint8_t mask = tok & ~codecTokDelta;
+  if (mask >> stream.fields) return 0;                        // names a field the stream does not have
+
+  int32_t next[codecFieldsMax];
+  uint8_t pos = 1;
+  memcpy(next, stream.last, sizeof(next));
+  for (uint8_t field = 0; field < stream.fields; field++) {
+    if (!(mask & (1 << field))) continue;
+    uint32_t zigzag;
+    uint8_t  read = codecGetVarint(&in[pos], len - pos, zigzag);
+    if (!read) return 0;
+    next[field] = (int32_t) ((uint32_t) next[field] + (uint32_t) codecUnzigzag(zigzag));
+    pos += read;
+  }
+  memcpy(stream.last, next, sizeof(next));
+  samples = 1;
+  return pos;
+}
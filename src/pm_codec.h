@@ -0,0 +1,54 @@
+#ifndef pm_codec_h
+#define pm_codec_h
+
+#include <stdint.h>
+
+// Delta codec for telemetry samples, shared by the FRAM log, the 0x78 bulk
+// readout that serves its blocks verbatim, and host side decoders. A stream
+// starts from a keyframe the caller stores at full width, every later sample
+// is one token:
+//
+//   0x00-0x3F  previous sample repeated 1 to 64 times
+//   0x40|mask  one sample, a zigzag varint delta for every field set in mask
+//
+// Fields that did not change cost nothing and a small change costs one byte,
+// a delta of any size still fits, so only a full block forces a new keyframe.
+// Tokens 0x80 and up are left to the caller, the log uses them for events.
+// This header only needs <stdint.h> so the host library and the benchmark in
+// bench/codec_bench.cpp build the same encoder and decoder.
+
+const uint8_t codecFieldsMax    = 6;     // mask bits in a delta token
+const uint8_t codecTokRepeat    = 0x00;  // low bits count repeats minus one
+const uint8_t codecTokRepeatMax = 0x3F;
+const uint8_t codecTokDelta     = 0x40;
+const uint8_t codecTokUser      = 0x80;  // first token the codec never writes
+const uint8_t codecNoRepeat     = 0xFF;
+const uint8_t codecVarintMax    = 5;     // bytes of a 32-bit varint
+
+struct CODEC_STREAM {
+  int32_t last[codecFieldsMax];         // previous sample
+  uint8_t fields;                       // values per sample, 1 to codecFieldsMax
+  uint8_t repeat;                       // index of a repeat token that can still count up
+};
+
+inline uint32_t codecZigzag(int32_t value) {
+  return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+inline int32_t codecUnzigzag(uint32_t value) {
+  return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+uint8_t crc8(const uint8_t *data, uint8_t len, uint8_t crc = 0);    // SMBus PEC polynomial x^8 + x^2 + x + 1
+
+uint8_t codecPutVarint(uint8_t *out, uint8_t room, uint32_t value);        // bytes written, 0 if it does not fit
+uint8_t codecGetVarint(const uint8_t *in, uint8_t len, uint32_t &value);   // bytes read, 0 if cut short or too long
+
+void    codecKey(CODEC_STREAM &stream, const int32_t *key, uint8_t fields);  // start over from a keyframe
+// encoder: append cur to buf[used..size), false and nothing written if the token does not fit
+bool    codecAppend(CODEC_STREAM &stream, uint8_t *buf, uint8_t &used, uint8_t size, const int32_t *cur);
+// decoder: apply the token at in to stream.last, returns bytes read and the samples it stands for,
+// 0 for a caller token or a token cut short
+uint8_t codecNext(CODEC_STREAM &stream, const uint8_t *in, uint8_t len, uint8_t &samples);
+
+#endif
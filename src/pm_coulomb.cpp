@@ -0,0 +1,101 @@
+#include <Arduino.h>
+#include "pm_coulomb.h"
+#include "pm_fram.h"
+#include "pm_calib.h"
+
+static volatile uint16_t zeroLsb    = CAL_ZERO_LSB;                 // raw reading at zero current
+static int32_t           uaPerLsb   = (calDefaults[0].gainQ16 * 1000LL + 0x8000) >> 16;
+static volatile uint32_t lsbIn      = 0;    // sum of positive offsets, one per sample
+static volatile uint32_t lsbOut     = 0;    // sum of negative offsets, magnitude only
+static volatile uint16_t lsbSamples = 0;    // full rate sample periods since the last coulombUpdate()
+
+// charge not yet counted as a whole mAh, in uA-s scaled by adcSampleRateHz so nothing is ever truncated
+static uint64_t chargeIn   = 0;
+static uint64_t chargeOut  = 0;
+static const uint64_t chargePerMah = (uint64_t) coulombUasPerMah * adcSampleRateHz;
+static int32_t  lastCurrentUa = 0;
+static volatile bool precision = false;     // NAU7802 feeds the counter, the ISR samples are ignored
+static uint16_t precisionRem[2] = {};       // in and out remainders of the rate conversion below
+
+void coulombCalibrate(uint16_t zero, int32_t gain) {
+  coulombUpdate();                          // charge so far was measured with the old calibration
+  noInterrupts();                           // 16-bit store must not tear against the ISR
+  zeroLsb  = zero;
+  interrupts();
+  uaPerLsb = gain;
+}
+
+void coulombSample(uint16_t raw, uint8_t shift) {
+  if (precision) return;
+  uint16_t zero = zeroLsb;
+  if (raw >= zero) {
+    lsbIn += (uint32_t) (raw - zero) << shift;              // a divided rate sample spans 2^shift full rate ones
+  } else {
+    lsbOut += (uint32_t) (zero - raw) << shift;
+  }
+  lsbSamples += 1 << shift;
+}
+
+// add whole mAh to a counter register
+static void addMah(uint8_t reg, uint32_t mah) {
+  framWrite32(reg, framRead32(reg) + mah);
+}
+
+void coulombUpdate() {
+  uint32_t in, out;
+  uint16_t samples;
+
+  noInterrupts();                           // grab and reset the ISR accumulators together
+  in         = lsbIn;
+  out        = lsbOut;
+  samples    = lsbSamples;
+  lsbIn      = 0;
+  lsbOut     = 0;
+  lsbSamples = 0;
+  interrupts();
+
+  if (samples) {
+    // each lsb-sample is uaPerLsb for adcRoundSlots / adcSampleRateHz seconds
+    chargeIn  += (uint64_t) in  * uaPerLsb * adcRoundSlots;
+    chargeOut += (uint64_t) out * uaPerLsb * adcRoundSlots;
+    lastCurrentUa = (int32_t) (((int64_t) in - (int64_t) out) * uaPerLsb / samples);
+  }
+
+  uint32_t mahIn  = 0;
+  uint32_t mahOut = 0;
+  while (chargeIn >= chargePerMah)  { chargeIn  -= chargePerMah; mahIn++; }    // at most a few per call
+  while (chargeOut >= chargePerMah) { chargeOut -= chargePerMah; mahOut++; }
+  if (mahIn) {
+    addMah(0x34, mahIn);                    // total in
+    addMah(0x36, mahIn);                    // lifetime in
+  }
+  if (mahOut) {
+    addMah(0x35, mahOut);                   // total out
+    addMah(0x37, mahOut);                   // lifetime out
+  }
+  if (mahIn != mahOut) {                    // net counter, signed
+    framWrite32(0x31, (uint32_t) ((int32_t) framRead32(0x31) + (int32_t) mahIn - (int32_t) mahOut));
+  }
+}
+
+void coulombUsePrecision(bool enable) {
+  coulombUpdate();                          // whatever the ISR gathered so far still counts
+  precision = enable;
+}
+
+void coulombSamplePrecise(int32_t ua, uint16_t rateHz) {
+  // one sample spans 1 / rateHz seconds, the accumulators are in uA-s scaled by adcSampleRateHz
+  uint8_t  dir    = ua < 0;
+  uint64_t scaled = (uint64_t) (dir ? -(int64_t) ua : ua) * adcSampleRateHz + precisionRem[dir];
+  precisionRem[dir] = scaled % rateHz;      // carried so the rates that do not divide evenly lose nothing
+  if (dir) {
+    chargeOut += scaled / rateHz;
+  } else {
+    chargeIn  += scaled / rateHz;
+  }
+  lastCurrentUa = ua;
+}
+
+int32_t coulombCurrentUa() {
+  return lastCurrentUa;
+}
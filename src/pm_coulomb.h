@@ -0,0 +1,26 @@
+#ifndef pm_coulomb_h
+#define pm_coulomb_h
+
+#include <Arduino.h>
+#include "pm_adc.h"
+
+// Fixed-point coulomb counter. The ADC ISR hands every current-channel
+// conversion to coulombSample(), which only adds the signed offset from the
+// zero-current reading into a charge-in or charge-out accumulator. Because the
+// conversions are hardware triggered each sample spans exactly
+// adcRoundSlots / adcSampleRateHz seconds, times two to the rate shift in
+// effect when it was taken, so loop() can turn the accumulated LSB-samples
+// into micro-amp-seconds with integer math and no timestamps. With a NAU7802
+// fitted loop() feeds its conversions through coulombSamplePrecise() instead
+// and the ISR samples are ignored.
+
+const uint32_t coulombUasPerMah = 3600000UL;   // uA-s in one mAh
+
+void coulombCalibrate(uint16_t zeroLsb, int32_t uaPerLsb);   // set from the calibration module
+void coulombSample(uint16_t raw, uint8_t shift);   // ISR: accumulate one current-channel conversion at adcSampleRateHz >> shift
+void coulombUpdate();                   // loop: fold the ISR accumulators into the counter registers
+void coulombUsePrecision(bool enable);  // switch the integrator to the NAU7802
+void coulombSamplePrecise(int32_t ua, uint16_t rateHz);    // loop: one precision conversion in uA
+int32_t coulombCurrentUa();             // average current over the last coulombUpdate(), uA
+
+#endif
@@ -0,0 +1,118 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include "pm_fram.h"
+
+static FramBus *framDevice = nullptr;
+static uint8_t  framCache[framRegCount * framSlotSize];     // RAM copy of the register slots
+static uint8_t  framDirtyBits[(framRegCount + 7) / 8];      // one bit per slot
+static bool     framHeaderDue = false;                       // header goes on after the defaults are flushed
+
+bool FramI2C::write(uint16_t addr, const uint8_t *data, uint16_t len) {
+  while (len) {
+    uint8_t chunk = (len > framChunk) ? framChunk : len;
+    _wire.beginTransmission(_devAddr);
+    _wire.write((uint8_t) (addr >> 8));                 // 13-bit address, high byte first
+    _wire.write((uint8_t) addr);
+    _wire.write(data, chunk);
+    if (_wire.endTransmission(true) != 0) return false;
+    addr += chunk;
+    data += chunk;
+    len  -= chunk;
+  }
+  return true;
+}
+
+bool FramI2C::read(uint16_t addr, uint8_t *data, uint16_t len) {
+  while (len) {
+    uint8_t chunk = (len > framChunk) ? framChunk : len;
+    _wire.beginTransmission(_devAddr);
+    _wire.write((uint8_t) (addr >> 8));
+    _wire.write((uint8_t) addr);
+    if (_wire.endTransmission(false) != 0) return false;  // repeated start into the read
+    if (_wire.requestFrom((int) _devAddr, (int) chunk) != chunk) return false;  // int overload exists on every core
+    for (uint8_t x = 0; x < chunk; x++) data[x] = _wire.read();
+    addr += chunk;
+    data += chunk;
+    len  -= chunk;
+  }
+  return true;
+}
+
+static inline bool slotDirty(uint8_t slot) {
+  return framDirtyBits[slot >> 3] & (1 << (slot & 7));
+}
+
+bool framBegin(FramBus &bus) {
+  uint8_t header[4];
+  framDevice = &bus;
+  memset(framDirtyBits, 0, sizeof(framDirtyBits));
+  framHeaderDue = false;
+
+  if (!bus.read(framHeaderAddr, header, sizeof(header)) ||
+      header[0] != framMagic0 || header[1] != framMagic1 || header[2] != framVersion) {
+    memset(framCache, 0, sizeof(framCache));              // blank or foreign layout, caller loads defaults
+    for (uint8_t slot = 0; slot < framRegCount; slot++) framDirtyBits[slot >> 3] |= (1 << (slot & 7));
+    framHeaderDue = true;                                 // a valid header over unwritten slots would skip the defaults
+    return false;
+  }
+  return bus.read(framRegBase, framCache, sizeof(framCache));
+}
+
+bool framFlush() {
+  if (!framDevice) return false;
+  uint8_t slot = 0;
+  while (slot < framRegCount) {
+    if (!slotDirty(slot)) {
+      slot++;
+      continue;
+    }
+    uint8_t first = slot;                                 // coalesce the run of dirty slots into one write
+    while (slot < framRegCount && slotDirty(slot)) {
+      framDirtyBits[slot >> 3] &= ~(1 << (slot & 7));
+      slot++;
+    }
+    uint16_t offset = first * framSlotSize;
+    if (!framDevice->write(framRegBase + offset, &framCache[offset], (slot - first) * framSlotSize)) {
+      for (uint8_t x = first; x < slot; x++) framDirtyBits[x >> 3] |= (1 << (x & 7));  // retry next flush
+      return false;
+    }
+  }
+
+  if (framHeaderDue) {                                    // every slot is on the part, the layout can be claimed
+    const uint8_t header[4] = { framMagic0, framMagic1, framVersion, 0 };
+    if (!framDevice->write(framHeaderAddr, header, sizeof(header))) return false;
+    framHeaderDue = false;
+  }
+  return true;
+}
+
+bool framDirty() {
+  if (framHeaderDue) return true;
+  for (uint8_t x = 0; x < sizeof(framDirtyBits); x++) {
+    if (framDirtyBits[x]) return true;
+  }
+  return false;
+}
+
+void framWrite32(uint8_t reg, uint32_t value) {
+  if (reg < framRegFirst || reg > framRegLast) return;
+  uint8_t  slot = reg - framRegFirst;
+  uint8_t *dst  = &framCache[slot * framSlotSize];
+  if ((uint32_t) (dst[0] | (dst[1] << 8) | ((uint32_t) dst[2] << 16) | ((uint32_t) dst[3] << 24)) == value) return;
+
+  for (uint8_t x = 0; x < framSlotSize; x++) {            // little-endian, same as the binary replies
+    dst[x] = (uint8_t) value;
+    value >>= 8;
+  }
+  framDirtyBits[slot >> 3] |= (1 << (slot & 7));
+}
+
+uint32_t framRead32(uint8_t reg) {
+  if (reg < framRegFirst || reg > framRegLast) return 0;
+  const uint8_t *src = &framCache[(reg - framRegFirst) * framSlotSize];
+  return (uint32_t) src[0] | ((uint32_t) src[1] << 8) | ((uint32_t) src[2] << 16) | ((uint32_t) src[3] << 24);
+}
+
+FramBus *framBus() {
+  return framDevice;
+}
@@ -0,0 +1,62 @@
+#ifndef pm_fram_h
+#define pm_fram_h
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "pm_registers.h"
+
+// FM24C64B storage layer. Every register from framRegFirst to framRegLast owns
+// a fixed 4-byte slot, mirrored in RAM. Writes only touch the RAM copy and mark the
+// slot dirty, framFlush() writes runs of dirty slots back in as few bus
+// transactions as possible. FRAM has no page boundaries or write delay, the
+// only limit on a transaction is the Wire buffer. On a blank or foreign part
+// the header is only written by the first framFlush() that gets every slot
+// out, a power cut before that loads the defaults again on the next boot.
+
+const uint8_t  framI2CAddr    = 0x50;   // A2..A0 tied low
+const uint16_t framSize       = 8192;   // 64 Kbit
+const uint8_t  framChunk      = 30;     // data bytes per transaction, Wire buffer minus the address bytes
+
+// fixed memory map
+const uint16_t framHeaderAddr = 0x0000; // magic and layout version
+const uint16_t framRegBase    = 0x0010; // register slots, framSlotSize bytes each from framRegFirst
+const uint8_t  framSlotSize   = 4;
+const uint8_t  framRegFirst   = 0x21;   // registers below this are live values only, no slot
+const uint8_t  framRegLast    = 0x64;   // registers above this are live values only, no slot
+const uint8_t  framRegCount   = framRegLast - framRegFirst + 1;
+const uint16_t framRegEnd     = framRegBase + framRegCount * framSlotSize;
+const uint16_t framJournalA   = 0x0140; // counter journal, two alternating records, see pm_journal.h
+const uint16_t framJournalB   = 0x0180;
+
+const uint8_t  framMagic0     = 'P';
+const uint8_t  framMagic1     = 'M';
+const uint8_t  framVersion    = 1;      // bump when the memory map changes, forces defaults on next boot
+
+static_assert(framRegFirst >= regFirst && framRegLast <= regLast, "register slots outside the register table");
+static_assert(framRegEnd <= framJournalA, "register slots run into the journal");
+
+// transport, the real device is on I2C and the native build swaps in a mock
+class FramBus {
+  public:
+    virtual bool write(uint16_t addr, const uint8_t *data, uint16_t len) = 0;
+    virtual bool read(uint16_t addr, uint8_t *data, uint16_t len) = 0;
+};
+
+class FramI2C : public FramBus {
+  public:
+    FramI2C(TwoWire &wire, uint8_t devAddr = framI2CAddr) : _wire(wire), _devAddr(devAddr) {}
+    bool write(uint16_t addr, const uint8_t *data, uint16_t len);
+    bool read(uint16_t addr, uint8_t *data, uint16_t len);
+  private:
+    TwoWire &_wire;
+    uint8_t  _devAddr;
+};
+
+bool     framBegin(FramBus &bus);                 // load the register slots, false if the header did not match
+bool     framFlush();                             // write dirty slots back, then a pending header, false on a bus error
+bool     framDirty();                             // true if any slot or the header is waiting for framFlush()
+void     framWrite32(uint8_t reg, uint32_t value);
+uint32_t framRead32(uint8_t reg);
+FramBus *framBus();                               // raw access for modules with their own region of the map
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef pm_fram_mock_h
+#define pm_fram_mock_h
+
+#include "pm_fram.h"
+
+// In-memory FM24C64B for native builds. Addresses wrap at framSize like the
+// real part. writeBudget simulates a brown-out: once that many bytes have been
+// written every further write fails, so a caller can cut power at any byte.
+
+class FramMock : public FramBus {
+  public:
+    uint8_t  mem[framSize];
+    uint32_t writeCalls  = 0;               // transactions, to check batching
+    uint32_t bytesWritten = 0;
+    int32_t  writeBudget = -1;              // bytes left before the simulated power cut, -1 for unlimited
+
+    FramMock() { memset(mem, 0, sizeof(mem)); }
+
+    bool write(uint16_t addr, const uint8_t *data, uint16_t len) {
+      writeCalls++;
+      for (uint16_t x = 0; x < len; x++) {
+        if (writeBudget == 0) return false;
+        if (writeBudget > 0) writeBudget--;
+        mem[(addr + x) % framSize] = data[x];
+        bytesWritten++;
+      }
+      return true;
+    }
+
+    bool read(uint16_t addr, uint8_t *data, uint16_t len) {
+      for (uint16_t x = 0; x < len; x++) data[x] = mem[(addr + x) % framSize];
+      return true;
+    }
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include <Arduino.h>
+#include "pm_journal.h"
+
+static uint16_t journalSeq  = 0;        // sequence number of the newest record on the part
+static uint8_t  journalNext = 0;        // slot the next commit overwrites, 0 = A, 1 = B
+static uint32_t journalLast[journalCount];
+
+static uint16_t crc16(const uint8_t *data, uint8_t len) {
+  uint16_t crc = 0xFFFF;
+  while (len--) {
+    crc ^= (uint16_t) *data++ << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ 0x1021) : (uint16_t) (crc << 1);
+    }
+  }
+  return crc;
+}
+
+static bool journalValid(const JOURNAL_RECORD &rec) {
+  return rec.crc == crc16((const uint8_t *) &rec, sizeof(rec) - sizeof(rec.crc));
+}
+
+bool journalRestore(FramBus &bus) {
+  JOURNAL_RECORD rec[2];
+  bool valid[2];
+
+  valid[0] = bus.read(framJournalA, (uint8_t *) &rec[0], sizeof(JOURNAL_RECORD)) && journalValid(rec[0]);
+  valid[1] = bus.read(framJournalB, (uint8_t *) &rec[1], sizeof(JOURNAL_RECORD)) && journalValid(rec[1]);
+
+  uint8_t newest;
+  if (valid[0] && valid[1]) {
+    newest = ((int16_t) (rec[1].seq - rec[0].seq) > 0) ? 1 : 0;
+  } else if (valid[0] || valid[1]) {
+    newest = valid[1] ? 1 : 0;
+  } else {
+    journalSeq  = 0;                    // fresh part, first commit goes to A
+    journalNext = 0;
+    for (uint8_t x = 0; x < journalCount; x++) journalLast[x] = framRead32(journalRegs[x]);
+    return false;
+  }
+
+  journalSeq  = rec[newest].seq;
+  journalNext = newest ^ 1;             // never overwrite the record we just trusted
+  for (uint8_t x = 0; x < journalCount; x++) {
+    journalLast[x] = rec[newest].value[x];
+    framWrite32(journalRegs[x], rec[newest].value[x]);
+  }
+  return true;
+}
+
+bool journalCommit(FramBus &bus) {
+  JOURNAL_RECORD rec;
+  bool changed = false;
+
+  for (uint8_t x = 0; x < journalCount; x++) {
+    rec.value[x] = framRead32(journalRegs[x]);
+    if (rec.value[x] != journalLast[x]) changed = true;
+  }
+  if (!changed) return true;
+
+  rec.seq = journalSeq + 1;
+  rec.crc = crc16((const uint8_t *) &rec, sizeof(rec) - sizeof(rec.crc));
+  if (!bus.write(journalNext ? framJournalB : framJournalA, (const uint8_t *) &rec, sizeof(rec))) {
+    return false;                       // slot is now suspect, retry into the same one next time
+  }
+
+  journalSeq  = rec.seq;
+  journalNext ^= 1;
+  memcpy(journalLast, rec.value, sizeof(journalLast));
+  return true;
+}
@@ -0,0 +1,27 @@
+#ifndef pm_journal_h
+#define pm_journal_h
+
+#include <Arduino.h>
+#include "pm_fram.h"
+
+// Brown-out safe storage for the counters that must never go backwards or
+// corrupt: coulomb counter, amp totals, lifetime amps and disconnect counts.
+// Each commit writes a complete record with a sequence number and CRC-16 into
+// whichever of the A/B slots is older, so a power cut mid-write can only ever
+// damage the record being replaced. At boot the newest valid record wins.
+
+const uint8_t journalRegs[] = { 0x31, 0x34, 0x35, 0x36, 0x37, 0x51, 0x52, 0x53, 0x54, 0x55 };
+const uint8_t journalCount  = sizeof(journalRegs);
+
+struct __attribute__((packed)) JOURNAL_RECORD {
+  uint16_t seq;                         // wraps, compared with serial number arithmetic
+  uint32_t value[journalCount];         // register values in journalRegs order
+  uint16_t crc;                         // CRC-16/CCITT over seq and value[]
+};
+
+static_assert(sizeof(JOURNAL_RECORD) <= framJournalB - framJournalA, "journal record overlaps the B slot");
+
+bool journalRestore(FramBus &bus);      // load the newest valid record into the register slots, false if neither is valid
+bool journalCommit(FramBus &bus);       // write the current counter values if they changed, false on a bus error
+
+#endif
@@ -0,0 +1,207 @@
+#include <Arduino.h>
+#include "pm_clock.h"
+#include "pm_log.h"
+#include "pm_registers.h"
+
+static FramBus  *logBus      = nullptr;
+static LOG_BLOCK logOpen;                           // block being filled, rewritten to FRAM on every append
+static uint8_t   logOpenIdx  = 0;                   // ring slot of logOpen
+static uint8_t   logHeld     = 0;                   // blocks in the ring holding data, logOpen included
+static CODEC_STREAM logStream;                     // previous sample, quantised like the keyframe
+static uint16_t  logInterval = logIntervalDefault;
+static uint32_t  logNextMs   = 0;                   // millis() of the next sample
+
+static uint8_t          logReadout[logBlockSize];   // block the host is draining, filled by logService()
+static volatile uint8_t logHalf     = 0;            // half of logReadout the next 0x78 read gets
+static volatile bool    logReady    = false;        // logReadout holds a block for the ISR
+static bool             logDraining = false;
+static uint16_t         logCursor   = 0;            // seq logService() fetches next
+
+static inline uint16_t logAddr(uint8_t idx) {
+  return logBase + (uint16_t) idx * logBlockSize;
+}
+
+static void logWriteOpen() {
+  logOpen.crc = crc8((const uint8_t *) &logOpen, sizeof(LOG_BLOCK) - 1);
+  logBus->write(logAddr(logOpenIdx), (const uint8_t *) &logOpen, sizeof(LOG_BLOCK));
+}
+
+// the next ring slot becomes the open block, the oldest block goes once the ring is full
+static void logOpenBlock() {
+  uint16_t seq = logOpen.hdr.seq + 1;
+  logOpenIdx = (logOpenIdx + 1) % logBlocks;
+  if (logHeld < logBlocks) logHeld++;
+
+  memset(&logOpen, 0, sizeof(logOpen));
+  logOpen.hdr.magic    = logMagic;
+  logOpen.hdr.seq      = seq;
+  logOpen.hdr.time     = clockNow();
+  logOpen.hdr.interval = logInterval;
+  logStream.repeat     = codecNoRepeat;
+  logWriteOpen();                                   // a reset before the first append must not revive the old slot
+}
+
+static bool logAppend(const uint8_t *tok, uint8_t len) {
+  if (logOpen.hdr.used + len > logPayloadSize) return false;
+  memcpy(&logOpen.payload[logOpen.hdr.used], tok, len);
+  logOpen.hdr.used += len;
+  return true;
+}
+
+// seconds from the open block's time, a new block once that no longer fits the token
+static uint16_t logOffset() {
+  uint32_t offset = clockNow() - logOpen.hdr.time;
+  if (offset > UINT16_MAX) {
+    logOpenBlock();
+    offset = 0;
+  }
+  return (uint16_t) offset;
+}
+
+static int16_t logClamp16(int32_t value) {
+  return value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : (int16_t) value;
+}
+
+void logBegin(FramBus &bus) {
+  logBus = &bus;
+
+  bool     found   = false;
+  uint16_t newest  = 0;
+  uint8_t  held    = 0;
+  for (uint8_t idx = 0; idx < logBlocks; idx++) {   // logOpen doubles as the scratch buffer
+    if (!bus.read(logAddr(idx), (uint8_t *) &logOpen, sizeof(LOG_BLOCK))) continue;
+    if (logOpen.hdr.magic != logMagic) continue;
+    if (logOpen.crc != crc8((const uint8_t *) &logOpen, sizeof(LOG_BLOCK) - 1)) continue;
+    held++;
+    if (!found || (int16_t) (logOpen.hdr.seq - newest) > 0) {
+      found       = true;
+      newest      = logOpen.hdr.seq;
+      logOpenIdx  = idx;
+      logInterval = logOpen.hdr.interval ? logOpen.hdr.interval : logIntervalDefault;
+    }
+  }
+  if (!found) logOpenIdx = logBlocks - 1;           // first block goes to slot 0
+
+  logOpen.hdr.seq = newest;
+  logHeld   = held;
+  logOpenBlock();
+  logNextMs = millis();
+  logEvent(LOG_EV_BOOT, 0);
+}
+
+bool logSampleDue() {
+  uint32_t nowMs = millis();
+  if ((int32_t) (nowMs - logNextMs) < 0) return false;
+  logNextMs += (uint32_t) logInterval * 1000;
+  if ((int32_t) (nowMs - logNextMs) >= 0) logNextMs = nowMs + (uint32_t) logInterval * 1000;   // fell behind, no catch up burst
+  return true;
+}
+
+void logSample(int32_t currentMa, int32_t packMv, int32_t tempMdeg) {
+  if (!logBus) return;
+  int16_t  current = logClamp16(currentMa / 10);
+  uint16_t pack    = (packMv <= 0) ? 0 : (packMv / 10 > UINT16_MAX) ? UINT16_MAX : (uint16_t) (packMv / 10);
+  int16_t  temp    = logClamp16(tempMdeg / 100);
+  uint16_t offset  = logOffset();
+  const int32_t sample[logFields] = { current, pack, temp };
+
+  bool stored = logOpen.hdr.keyValid
+                && codecAppend(logStream, logOpen.payload, logOpen.hdr.used, logPayloadSize, sample);
+
+  if (!stored) {                                    // keyframe, in a fresh block unless this one has none yet
+    if (logOpen.hdr.keyValid) {
+      logOpenBlock();
+      offset = 0;
+    }
+    logOpen.hdr.keyValid  = 1;
+    logOpen.hdr.keyOffset = offset;
+    logOpen.hdr.current   = current;
+    logOpen.hdr.pack      = pack;
+    logOpen.hdr.temp      = temp;
+    codecKey(logStream, sample, logFields);
+  }
+  logWriteOpen();
+}
+
+void logEvent(uint8_t type, uint32_t value) {
+  if (!logBus) return;
+  uint16_t offset = logOffset();
+  uint8_t  tok[logEventSize] = { (uint8_t) (logTokEvent | type), (uint8_t) offset, (uint8_t) (offset >> 8),
+                                 (uint8_t) value, (uint8_t) (value >> 8), (uint8_t) (value >> 16), (uint8_t) (value >> 24) };
+  if (!logAppend(tok, sizeof(tok))) {
+    logOpenBlock();
+    tok[1] = tok[2] = 0;                            // first thing in the new block
+    logAppend(tok, sizeof(tok));
+  }
+  logStream.repeat = codecNoRepeat;                 // later samples must not count into a token ahead of the event
+  logWriteOpen();
+}
+
+void logRestart() {
+  if (!logBus) return;
+  if (logOpen.hdr.used || logOpen.hdr.keyValid) {
+    logOpenBlock();
+  } else {                                          // nothing in it yet, restamp instead of leaving an empty block
+    logOpen.hdr.time     = clockNow();
+    logOpen.hdr.interval = logInterval;
+    logWriteOpen();
+  }
+}
+
+void logSetInterval(uint16_t seconds) {
+  if (!seconds) seconds = logIntervalDefault;
+  if (seconds == logInterval) return;
+  logInterval = seconds;
+  logRestart();                                     // sample times in a block assume one interval
+  logNextMs = millis();
+}
+
+void logSeek(uint16_t seq) {
+  uint16_t head = logOpen.hdr.seq;
+  if (!seq || (uint16_t) (head - seq) >= logHeld) seq = head - (logHeld - 1);    // oldest held
+  noInterrupts();                                   // drop whatever the ISR was about to serve
+  logReady = false;
+  interrupts();
+  logCursor   = seq;
+  logDraining = true;
+}
+
+void logService() {
+  if (logReady || !logDraining) return;
+  uint16_t head = logOpen.hdr.seq;
+  if ((int16_t) (logCursor - head) > 0) {           // served the open block, done
+    logDraining = false;
+    return;
+  }
+  uint16_t back = head - logCursor;                 // blocks behind the open one
+  if (back >= logHeld) {                            // the ring wrapped past the cursor, skip to the oldest
+    back      = logHeld - 1;
+    logCursor = head - back;
+  }
+  if (back == 0) {
+    memcpy(logReadout, &logOpen, sizeof(LOG_BLOCK));
+  } else if (!logBus->read(logAddr((logOpenIdx + logBlocks - back) % logBlocks), logReadout, sizeof(logReadout))) {
+    return;                                         // bus error, try again next pass
+  }
+  logCursor++;
+  noInterrupts();                                   // block contents land before the ISR sees the flag
+  logHalf  = 0;
+  logReady = true;
+  interrupts();
+}
+
+uint8_t logCopyChunk(uint8_t *out) {
+  if (!logReady) return 0;
+  memcpy(out, &logReadout[logHalf * logChunkSize], logChunkSize);
+  if (++logHalf >= logBlockSize / logChunkSize) logReady = false;
+  return logChunkSize;
+}
+
+int32_t logRead(uint8_t reg) {
+  switch (reg) {
+    case logCursorReg:   return logCursor;
+    case logHeadReg:     return logOpen.hdr.seq;
+    case logIntervalReg: return logInterval;
+  }
+  return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef pm_log_h
+#define pm_log_h
+
+#include <Arduino.h>
+#include "pm_fram.h"
+#include "pm_journal.h"
+#include "pm_logblock.h"
+
+// Circular telemetry and event log in the FRAM above the counter journal.
+// The log is a ring of the fixed 64-byte blocks laid out in pm_logblock.h. A
+// block is closed and a new keyframe opened when the next token does not fit,
+// the interval changes or the clock is set. The open block is rewritten to
+// FRAM on every append, so a reset loses nothing, and the newest valid block
+// is found again at boot by its sequence number.
+//
+// The host drains the log through a cursor: set it with 0x77, then every
+// read of 0x78 returns the next half block. The receive ISR only copies a
+// half that loop() fetched ahead of time, a read that finds nothing ready
+// gets the idle reply and should be retried.
+
+const uint16_t logBase        = 0x0200;           // first block, the journal ends below
+const uint8_t  logBlocks      = (framSize - logBase) / logBlockSize;
+const uint16_t logIntervalDefault = 120;          // s, two days of a busy pack, weeks of a quiet one
+
+static_assert(logBase >= framJournalB + sizeof(JOURNAL_RECORD), "log runs into the journal");
+
+void     logBegin(FramBus &bus);                  // find the newest block and open a new one with a boot event
+bool     logSampleDue();                          // loop: true once per interval
+void     logSample(int32_t currentMa, int32_t packMv, int32_t tempMdeg);
+void     logEvent(uint8_t type, uint32_t value);
+void     logRestart();                            // loop: close the open block, call after clockSync()
+void     logSetInterval(uint16_t seconds);        // 0 restores logIntervalDefault
+void     logSeek(uint16_t seq);                   // 0 or a block no longer held starts from the oldest
+void     logService();                            // loop: fetch the half blocks the host reads next
+uint8_t  logCopyChunk(uint8_t *out);              // ISR: next half block for 0x78, 0 if none is ready
+int32_t  logRead(uint8_t reg);                    // 0x77, 0x79 and 0x7A for the register cache
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef pm_logblock_h
+#define pm_logblock_h
+
+#include <stdint.h>
+#include "pm_codec.h"
+
+// Layout of a telemetry log block, as kept in the FRAM ring by pm_log.cpp and
+// served verbatim through 0x78. Each block opens with a keyframe: full current,
+// pack voltage and hottest temperature readings and the clockNow() time they
+// count from. After that come the pm_codec.h tokens with the fields in that
+// order, and events:
+//
+//   0x00-0x7F  samples, repeats or zigzag varint deltas, see pm_codec.h
+//   0x80|type  event, uint16 seconds from the block time and a uint32 value
+//
+// Sample n of a block was taken at time + keyOffset + n * interval, the
+// keyframe is sample 0. This header only needs <stdint.h>, the log reader in
+// host/ decodes the same struct.
+
+const uint8_t  logBlockSize   = 64;
+const uint8_t  logChunkSize   = 32;               // one Wire buffer per 0x78 read
+const uint8_t  logMagic       = 0xB2;             // layout version 2, varint deltas
+const uint8_t  logCursorReg   = 0x77;
+const uint8_t  logReadReg     = 0x78;
+const uint8_t  logHeadReg     = 0x79;
+const uint8_t  logIntervalReg = 0x7A;
+
+const uint8_t  logFields      = 3;                // current, pack voltage, temperature
+const uint8_t  logTokEvent    = codecTokUser;
+const uint8_t  logEventSize   = 7;                // token, uint16 offset, uint32 value
+
+enum LOG_EVENT : uint8_t {
+  LOG_EV_BOOT       = 1,                          // value: 0
+  LOG_EV_DISCONNECT = 2,                          // value: reason code as in 0x57
+  LOG_EV_RECONNECT  = 3,                          // value: reason code that cleared
+  LOG_EV_SETTING    = 4,                          // value: register << 24 | low 24 bits of the new value
+  LOG_EV_TIME       = 5,                          // value: the time the master set, a new block starts from it
+  LOG_EV_CLEAR      = 6,                          // value: the clear command
+};
+
+struct __attribute__((packed)) LOG_BLOCK_HEADER {
+  uint8_t  magic;                                 // logMagic, erased or foreign blocks fail this before the crc
+  uint8_t  keyValid;                              // 1 once the keyframe fields hold a sample
+  uint16_t seq;                                   // increments per block, wraps
+  uint32_t time;                                  // clockNow() when the block opened
+  uint16_t keyOffset;                             // s from time to the keyframe sample
+  uint16_t interval;                              // s between samples
+  int16_t  current;                               // keyframe, 10 mA
+  uint16_t pack;                                  // keyframe, 10 mV
+  int16_t  temp;                                  // keyframe, 0.1 degC
+  uint8_t  used;                                  // payload bytes in use
+};
+
+const uint8_t logPayloadSize = logBlockSize - sizeof(LOG_BLOCK_HEADER) - 1;
+
+struct __attribute__((packed)) LOG_BLOCK {
+  LOG_BLOCK_HEADER hdr;
+  uint8_t          payload[logPayloadSize];
+  uint8_t          crc;                           // crc8 over everything before it
+};
+
+static_assert(sizeof(LOG_BLOCK) == logBlockSize, "log block must fill its slot");
+static_assert(logBlockSize == 2 * logChunkSize, "readout serves a block in two halves");
+
+#endif
@@ -0,0 +1,136 @@
+#include <Arduino.h>
+#include "pm_nau7802.h"
+#include "pm_adc.h"
+
+static NauBus          *nauBus      = nullptr;
+static int8_t           nauDrdyPin  = -1;
+static uint8_t          nauActive   = 0;              // config byte in use
+static volatile bool    nauDrdyFlag = false;          // set by the DRDY edge
+static uint32_t         nauLastPoll = 0;              // millis() of the last CR check, polled mode only
+static uint32_t         nauSamples  = 0;
+
+bool NauI2C::writeReg(uint8_t reg, uint8_t value) {
+  _wire.beginTransmission(_devAddr);
+  _wire.write(reg);
+  _wire.write(value);
+  return _wire.endTransmission(true) == 0;
+}
+
+bool NauI2C::readRegs(uint8_t reg, uint8_t *data, uint8_t len) {
+  _wire.beginTransmission(_devAddr);
+  _wire.write(reg);
+  if (_wire.endTransmission(false) != 0) return false;  // repeated start into the read
+  if (_wire.requestFrom((int) _devAddr, (int) len) != len) return false;
+  for (uint8_t x = 0; x < len; x++) data[x] = _wire.read();
+  return true;
+}
+
+static void nauDrdyIsr() {
+  nauDrdyFlag = true;
+}
+
+static bool nauRead(uint8_t reg, uint8_t &value) {
+  return nauBus->readRegs(reg, &value, 1);
+}
+
+// poll a register until the masked bits match, the part answers within a few ms
+static bool nauWaitFor(uint8_t reg, uint8_t mask, uint8_t want) {
+  for (uint8_t tries = 0; tries < 20; tries++) {
+    uint8_t value;
+    if (nauRead(reg, value) && (value & mask) == want) return true;
+    delay(1);
+  }
+  return false;
+}
+
+bool nauConfigure(uint8_t config) {
+  if (!nauBus) return false;
+  uint8_t rate = nauConfigRate(config);
+  if (!nauRateHz(rate)) return false;
+
+  if (!nauBus->writeReg(nauRegCtrl1, nauLdo3v3 | nauConfigGain(config))) return false;
+  if (!nauBus->writeReg(nauRegCtrl2, rate << 4)) return false;
+  if (!nauBus->writeReg(nauRegCtrl2, (rate << 4) | nauCtrl2CALS)) return false;  // internal offset calibration
+  if (!nauWaitFor(nauRegCtrl2, nauCtrl2CALS, 0)) return false;
+
+  uint8_t ctrl2;
+  if (!nauRead(nauRegCtrl2, ctrl2) || (ctrl2 & nauCtrl2CalErr)) return false;
+  nauActive = config;
+  return true;
+}
+
+bool nauBegin(NauBus &bus, int8_t drdyPin, uint8_t config) {
+  nauBus     = &bus;
+  nauDrdyPin = drdyPin;
+  nauActive  = 0;
+  nauSamples = 0;
+  if (!config) config = nauConfigDefault;
+
+  uint8_t rev;
+  if (!nauRead(nauRegRevision, rev) || (rev & 0x0F) != 0x0F) {   // nothing answering, or not a NAU7802
+    nauBus = nullptr;
+    return false;
+  }
+
+  bus.writeReg(nauRegPuCtrl, nauPuRR);                 // all registers to power-on defaults
+  bus.writeReg(nauRegPuCtrl, nauPuPUD);
+  if (!nauWaitFor(nauRegPuCtrl, nauPuPUR, nauPuPUR)) {
+    nauBus = nullptr;
+    return false;
+  }
+  bus.writeReg(nauRegPuCtrl, nauPuPUD | nauPuPUA | nauPuAVDDS);
+  bus.writeReg(nauRegAdc, nauChopperOff);
+  delay(1);                                            // ldo settles before the offset calibration
+
+  if (!nauConfigure(config)) {
+    nauBus = nullptr;
+    return false;
+  }
+
+  if (drdyPin >= 0) {
+    pinMode(drdyPin, INPUT);
+    attachInterrupt(digitalPinToInterrupt(drdyPin), nauDrdyIsr, RISING);
+  }
+  nauDrdyFlag = false;
+  nauLastPoll = millis();
+  return bus.writeReg(nauRegPuCtrl, nauPuPUD | nauPuPUA | nauPuAVDDS | nauPuCS);   // continuous conversion
+}
+
+bool nauPresent() {
+  return nauBus != nullptr;
+}
+
+uint8_t nauConfig() {
+  return nauActive;
+}
+
+bool nauPoll(int32_t &sample) {
+  if (!nauBus) return false;
+
+  if (nauDrdyPin >= 0) {
+    // DRDY stays high until ADCO is read, so a level check catches an edge that fired before attachInterrupt()
+    if (!nauDrdyFlag && !digitalRead(nauDrdyPin)) return false;
+    nauDrdyFlag = false;
+  } else {
+    uint32_t nowMillis = millis();
+    if ((uint32_t) (nowMillis - nauLastPoll) < 500U / nauRateHz(nauConfigRate(nauActive))) return false;
+    nauLastPoll = nowMillis;
+    uint8_t pu;
+    if (!nauRead(nauRegPuCtrl, pu) || !(pu & nauPuCR)) return false;
+  }
+
+  uint8_t raw[3];
+  if (!nauBus->readRegs(nauRegAdcoB2, raw, sizeof(raw))) return false;    // single burst, clears CR and DRDY
+
+  uint32_t value = ((uint32_t) raw[0] << 16) | ((uint16_t) raw[1] << 8) | raw[2];
+  if (value & 0x800000UL) value |= 0xFF000000UL;      // sign extend the 24-bit two's complement result
+  sample = (int32_t) value;
+
+  adcPushPrecision(sample);
+  nauSamples++;
+  return true;
+}
+
+uint32_t nauSampleCount() {
+  return nauSamples;
+}
@@ -0,0 +1,100 @@
+#ifndef pm_nau7802_h
+#define pm_nau7802_h
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// NAU7802 24-bit precision ADC on the master I2C bus. The part converts
+// continuously at the configured rate and raises DRDY when a result is ready,
+// the pin interrupt only sets a flag and nauPoll() fetches the sample from
+// loop() with one burst read of ADCO_B2..ADCO_B0. Without a DRDY pin the
+// driver checks the CR bit at most once per conversion period instead.
+
+const uint8_t nauI2CAddr      = 0x2A;   // fixed address
+const uint8_t nauRegPuCtrl    = 0x00;
+const uint8_t nauRegCtrl1     = 0x01;
+const uint8_t nauRegCtrl2     = 0x02;
+const uint8_t nauRegAdcoB2    = 0x12;   // conversion result, msb first, B2..B0 auto-increment
+const uint8_t nauRegAdc       = 0x15;   // adc control, chopper clock
+const uint8_t nauRegPga       = 0x1B;
+const uint8_t nauRegPwrCtrl   = 0x1C;
+const uint8_t nauRegRevision  = 0x1F;   // low nibble reads 0xF
+const uint8_t nauRegCount     = 0x20;
+
+// PU_CTRL bits
+const uint8_t nauPuRR         = 0x01;   // register reset
+const uint8_t nauPuPUD        = 0x02;   // power up digital
+const uint8_t nauPuPUA        = 0x04;   // power up analog
+const uint8_t nauPuPUR        = 0x08;   // power up ready, read only
+const uint8_t nauPuCS         = 0x10;   // cycle start, continuous conversion
+const uint8_t nauPuCR         = 0x20;   // cycle ready, read only, cleared by reading ADCO
+const uint8_t nauPuAVDDS      = 0x80;   // avdd from the internal ldo
+
+// CTRL2 bits
+const uint8_t nauCtrl2CALS    = 0x04;   // start calibration, self clearing
+const uint8_t nauCtrl2CalErr  = 0x08;
+
+const uint8_t nauLdo3v3       = 0x04 << 3;  // CTRL1 VLDO field, 3.3V reference
+const uint8_t nauChopperOff   = 0x30;       // ADC REG_CHPS, datasheet recommends the chopper clock off
+
+// config byte for register 0x4D: bits 0-2 rate (CTRL2 CRS), bits 4-6 PGA gain (CTRL1 GAINS)
+enum NAU_RATE : uint8_t {
+  NAU_SPS_10  = 0,
+  NAU_SPS_20  = 1,
+  NAU_SPS_40  = 2,
+  NAU_SPS_80  = 3,
+  NAU_SPS_320 = 7,
+};
+
+enum NAU_GAIN : uint8_t {
+  NAU_GAIN_1   = 0,
+  NAU_GAIN_2   = 1,
+  NAU_GAIN_4   = 2,
+  NAU_GAIN_8   = 3,
+  NAU_GAIN_16  = 4,
+  NAU_GAIN_32  = 5,
+  NAU_GAIN_64  = 6,
+  NAU_GAIN_128 = 7,                     // 2^code
+};
+
+#ifndef NAU_RATE_DEFAULT
+#define NAU_RATE_DEFAULT NAU_SPS_80
+#endif
+#ifndef NAU_GAIN_DEFAULT
+#define NAU_GAIN_DEFAULT NAU_GAIN_128
+#endif
+
+const uint8_t nauRegConfig    = 0x4D;   // pm register holding the config byte, 0 selects the build default
+const uint8_t nauConfigDefault = NAU_RATE_DEFAULT | (NAU_GAIN_DEFAULT << 4);
+
+constexpr uint8_t  nauConfigRate(uint8_t config) { return config & 0x07; }
+constexpr uint8_t  nauConfigGain(uint8_t config) { return (config >> 4) & 0x07; }
+constexpr uint16_t nauRateHz(uint8_t rate) {
+  return rate == NAU_SPS_320 ? 320 : rate <= NAU_SPS_80 ? (10 << rate) : 0;   // CRS 4..6 are not defined
+}
+
+// transport, the real part is on I2C and the native build swaps in a simulated register file
+class NauBus {
+  public:
+    virtual bool writeReg(uint8_t reg, uint8_t value) = 0;
+    virtual bool readRegs(uint8_t reg, uint8_t *data, uint8_t len) = 0;  // one transaction, auto-increment
+};
+
+class NauI2C : public NauBus {
+  public:
+    NauI2C(TwoWire &wire, uint8_t devAddr = nauI2CAddr) : _wire(wire), _devAddr(devAddr) {}
+    bool writeReg(uint8_t reg, uint8_t value);
+    bool readRegs(uint8_t reg, uint8_t *data, uint8_t len);
+  private:
+    TwoWire &_wire;
+    uint8_t  _devAddr;
+};
+
+bool     nauBegin(NauBus &bus, int8_t drdyPin, uint8_t config);   // reset, power up, calibrate, start; false if absent
+bool     nauConfigure(uint8_t config);  // change rate and gain, recalibrates the offset
+bool     nauPresent();
+uint8_t  nauConfig();                   // active config byte
+bool     nauPoll(int32_t &sample);      // loop: true with a signed 24-bit sample when a conversion was fetched
+uint32_t nauSampleCount();              // conversions fetched since nauBegin()
+
+#endif
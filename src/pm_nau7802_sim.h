@@ -0,0 +1,88 @@
+#ifndef pm_nau7802_sim_h
+#define pm_nau7802_sim_h
+
+#include "pm_nau7802.h"
+
+// Register-level NAU7802 model for native builds. Power-up and calibration
+// complete instantly, convert() loads a result into ADCO and raises CR and
+// DRDY the way a finished conversion would, and a read that touches ADCO
+// clears them again. Counters let a test check the burst-read behaviour.
+
+class Nau7802Sim : public NauBus {
+  public:
+    uint8_t  regs[nauRegCount];
+    bool     drdy         = false;          // level of the DRDY pin
+    bool     present      = true;           // false makes every transaction NAK
+    uint32_t readCalls    = 0;              // transactions, one per nauPoll() when DRDY is wired
+    uint32_t writeCalls   = 0;
+    uint32_t overwritten  = 0;              // results replaced before they were read
+
+    Nau7802Sim() { reset(); }
+
+    void reset() {
+      memset(regs, 0, sizeof(regs));
+      regs[nauRegRevision] = 0x0F;
+      drdy = false;
+    }
+
+    bool running() const {
+      const uint8_t on = nauPuPUD | nauPuPUA | nauPuCS;
+      return (regs[nauRegPuCtrl] & on) == on;
+    }
+
+    uint8_t gainCode() const { return regs[nauRegCtrl1] & 0x07; }
+    uint8_t rateCode() const { return (regs[nauRegCtrl2] >> 4) & 0x07; }
+
+    // finish a conversion, sample is clamped to the signed 24-bit range
+    void convert(int32_t sample) {
+      if (!running()) return;
+      if (sample >  0x7FFFFF) sample =  0x7FFFFF;
+      if (sample < -0x800000) sample = -0x800000;
+      if (regs[nauRegPuCtrl] & nauPuCR) overwritten++;
+      regs[nauRegAdcoB2]     = (uint8_t) (sample >> 16);
+      regs[nauRegAdcoB2 + 1] = (uint8_t) (sample >> 8);
+      regs[nauRegAdcoB2 + 2] = (uint8_t) sample;
+      regs[nauRegPuCtrl] |= nauPuCR;
+      drdy = true;
+    }
+
+    bool writeReg(uint8_t reg, uint8_t value) {
+      if (!present || reg >= nauRegCount) return false;
+      writeCalls++;
+      if (reg == nauRegPuCtrl) {
+        if (value & nauPuRR) {
+          reset();
+          regs[nauRegPuCtrl] = nauPuRR;
+          return true;
+        }
+        uint8_t status = regs[nauRegPuCtrl] & nauPuCR;            // read-only bits
+        if (value & nauPuPUD) status |= nauPuPUR;                 // digital powers up at once
+        regs[nauRegPuCtrl] = (value & ~(nauPuPUR | nauPuCR)) | status;
+      } else if (reg == nauRegCtrl2) {
+        regs[reg] = value & ~(nauCtrl2CALS | nauCtrl2CalErr);     // calibration completes instantly
+      } else if (reg == nauRegRevision || (reg >= nauRegAdcoB2 && reg < nauRegAdcoB2 + 3)) {
+        // read only
+      } else {
+        regs[reg] = value;
+      }
+      return true;
+    }
+
+    bool readRegs(uint8_t reg, uint8_t *data, uint8_t len) {
+      if (!present) return false;
+      readCalls++;
+      bool adco = false;
+      for (uint8_t x = 0; x < len; x++) {
+        uint8_t r = (reg + x) % nauRegCount;
+        data[x] = regs[r];
+        if (r >= nauRegAdcoB2 && r < nauRegAdcoB2 + 3) adco = true;
+      }
+      if (adco) {
+        regs[nauRegPuCtrl] &= ~nauPuCR;
+        drdy = false;
+      }
+      return true;
+    }
+};
+
+#endif
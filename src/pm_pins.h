@@ -13,18 +13,31 @@
 #define ADC0 A1
 #define ADC1 A2
 #define ADC2 A3
+
+#define TEMP0 A0
+#define TEMP1 A6 // adc only, TQFP/QFN packages
+#define TEMP2 A7
+
+#define NAU_DRDY -1 // INT0/INT1 are taken by LED1/LED2, the driver polls instead
+#define PACK_DISC 9 // PB1, open drain, released opens the pack disconnect
 #elif MCU_ATMEGA4808
 #define LED1 PF2
-#define LED2 PF3
-#define LED3 PF4
+#define LED2 PA6 // PF3 is MVAOUT, the current sense amplifier output
+#define LED3 PA7 // PF4 is GATEDRV, see PACK_DISC
 #define LED4 PF5
 
-#define ADC0 A0
-#define ADC1 A2
-#define ADC2 A2
+#define ADC0 PF3 // AIN13, MVAOUT, the current sense amplifier
+#define ADC1 A0 // PD0, VBUS
+#define ADC2 A7 // PD7, VBAT, the pack voltage
+#define TEMP0 A4 // PD4, TS0
+#define TEMP1 A5 // PD5, TS1
+#define TEMP2 A6 // PD6, TS2
 // Nano Every: SDA 4 SCL 5 
 #define SCL PA3 
 #define SDA PA2 
+
+#define NAU_DRDY PA4 // NAU7802 data ready
+#define PACK_DISC PF4 // GATEDRV through RGATE, open drain: low holds Q1 on, released RG-PU to VPACK opens it
 #elif MCU_AVR128DA28
 #define LED1 7 // PA0
 #define LED2 8 // PA1
@@ -35,9 +48,15 @@
 #define ADC1 14 // PD2
 #define ADC2 15 // PD3
 #define ADC3 16 // PD4
+#define TEMP0 17 // PD5
+#define TEMP1 18 // PD6
+#define TEMP2 19 // PD7
 // Nano Every: SDA 4 SCL 5 
 #define SCL 3 // PA3
 #define SDA 2 // PA2
+
+#define NAU_DRDY 11 // PA4
+#define PACK_DISC 12 // PA5
 #elif MCU_AVR128DA32
 #define LED1 4 // PA0
 #define LED2 5 // PA1
@@ -48,9 +67,15 @@
 #define ADC1 16 // PD2
 #define ADC2 17 // PD3
 #define ADC3 18 // PD3
+#define TEMP0 19 // PD5
+#define TEMP1 20 // PD6
+#define TEMP2 21 // PD7
 // Nano Every: SDA 4 SCL 5 
 //#define SCL 3 // PA3
 //#define SDA 2 // PA2
+
+#define NAU_DRDY 8 // PA4
+#define PACK_DISC 9 // PA5
 #elif MCU_NANOEVERY
 #define LED1 5 
 #define LED2 4
@@ -61,8 +86,34 @@
 #define ADC1 16
 #define ADC2 17
 #define ADC3 18
+#define TEMP0 14 // A0
+#define TEMP1 20 // A6
+#define TEMP2 21 // A7
 
 // Nano Every: SDA 4 SCL 5 
 #define SDA 18 
 #define SCL 19 
+
+#define NAU_DRDY 6 // NAU7802 data ready
+#define PACK_DISC 7 // open drain, released opens the pack disconnect
+#elif PM_NATIVE
+// env:native, pin numbers only index the simulated pins in src/native
+#define LED1 2
+#define LED2 3
+#define LED3 4
+#define LED4 5
+
+#define ADC0 A0
+#define ADC1 A1
+#define ADC2 A2
+#define ADC3 A3
+#define TEMP0 A3
+#define TEMP1 A6
+#define TEMP2 A7
+
+#define SDA A4
+#define SCL A5
+
+#define NAU_DRDY 6
+#define PACK_DISC 7
 #endif
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include <Arduino.h>
+#include "pm_power.h"
+#include "pm_clock.h"
+
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#endif
+#ifdef PM_NATIVE
+#include "pm_native_hal.h"
+#endif
+
+static bool     pwrIdleOnly    = false;     // config2 bit 1
+static uint32_t pwrWakeups     = 0;
+static uint32_t pwrStandbyUs   = 0;         // in standby in the window so far
+static uint16_t pwrWindowStart = 0;         // millis() the window opened, low 16 bits
+static uint32_t pwrDuty        = 100000;    // share of the last full window out of standby, milli-percent
+
+static uint32_t powerSleepHardware(uint16_t ms);   // per target below, us in standby
+
+#if defined(__AVR_ATmega4808__) || defined(__AVR_ATmega4809__)
+
+// the millis() timer, a TCB that stops in standby. Each of its overflows is one
+// millisecond, micros() counts on from the overflows.
+extern volatile uint32_t timer_millis;
+extern volatile uint32_t timer_overflow_count;
+
+static int32_t pwrCarry      = 0;           // standby time not yet added to millis(), 1/512 us
+static int     pwrSerialIdle = 0;           // Serial.availableForWrite() with nothing queued
+
+static void powerBeginHardware() {
+  ADC0.CTRLA |= ADC_RUNSTBY_bm;             // pit-triggered conversions carry on in standby
+  pwrSerialIdle = Serial.availableForWrite();
+}
+
+// standby stops the TWI data stage and the USART, only go there between transactions
+static bool powerStandbyAllowed() {
+  if (TWI0.SSTATUS & TWI_AP_bm) return false;                 // address seen, no stop yet
+  if (Serial.availableForWrite() < pwrSerialIdle) return false;
+  Serial.flush();                                             // last byte out of the shift register
+  return true;
+}
+
+static uint32_t powerSleepHardware(uint16_t ms) {
+  if (pwrIdleOnly || !powerStandbyAllowed()) {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    interrupts();
+    sleep_cpu();
+    sleep_disable();
+    return 0;
+  }
+
+  uint64_t startTicks = clockTicks();
+  clockWakeIn((uint32_t) ms * clockHz / 1000);
+  uint32_t startUs = micros();
+
+  set_sleep_mode(SLEEP_MODE_STANDBY);
+  sleep_enable();
+  interrupts();                             // sei takes effect after the next instruction, the sleep
+  sleep_cpu();                              // adc result, rtc compare or twi address match
+  sleep_disable();
+
+  noInterrupts();
+  clockWakeCancel();
+  uint16_t rtcTicks = clockTicks() - startTicks;
+  uint32_t rtcUs    = (uint32_t) rtcTicks * 15625 / 512;
+  uint32_t awakeUs  = micros() - startUs;   // the wake-up isr ran on the millis() timer
+  pwrCarry += (int32_t) rtcTicks * 15625 - (int32_t) awakeUs * 512;
+  if (pwrCarry >= 512000L) {                // whole milliseconds the millis() timer missed
+    uint16_t lostMs = pwrCarry / 512000L;
+    timer_millis         += lostMs;
+    timer_overflow_count += lostMs;
+    pwrCarry             -= (int32_t) lostMs * 512000L;
+  }
+  interrupts();
+  return rtcUs > awakeUs ? rtcUs - awakeUs : 0;
+}
+
+#elif defined(__AVR__)
+
+static void powerBeginHardware() { }
+
+// Timer0 is millis() and the adc trigger, idle is as deep as this part goes
+static uint32_t powerSleepHardware(uint16_t ms) {
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_enable();
+  interrupts();
+  sleep_cpu();
+  sleep_disable();
+  return 0;
+}
+
+#elif defined(PM_NATIVE)
+
+static void powerBeginHardware() { }
+
+// idle is modelled as the 1ms timer tick waking the core, standby as one sleep to the release
+static uint32_t powerSleepHardware(uint16_t ms) {
+  interrupts();
+  if (pwrIdleOnly) {
+    nativeSleep(1000);
+    return 0;
+  }
+  return (uint32_t) nativeSleep((uint64_t) ms * 1000);
+}
+
+#else
+
+static void powerBeginHardware() { }
+
+static uint32_t powerSleepHardware(uint16_t ms) {
+  interrupts();                             // no sleep on this target
+  return 0;
+}
+
+#endif
+
+void powerBegin() {
+  pwrWakeups     = 0;
+  pwrStandbyUs   = 0;
+  pwrWindowStart = millis();
+  powerBeginHardware();
+}
+
+void powerConfigure(uint8_t config2) {
+  pwrIdleOnly = config2 & pwrCfgIdle;
+}
+
+void powerSleep(uint16_t ms) {
+  if (ms > pwrSleepMaxMs) ms = pwrSleepMaxMs;
+  pwrStandbyUs += powerSleepHardware(ms);
+  pwrWakeups++;
+
+  uint16_t windowMs = (uint16_t) millis() - pwrWindowStart;
+  if (windowMs < pwrWindowMs) return;
+  uint32_t windowUs = (uint32_t) windowMs * 1000;
+  uint32_t awakeUs  = pwrStandbyUs < windowUs ? windowUs - pwrStandbyUs : 0;
+  pwrDuty        = (uint64_t) awakeUs * 100 / windowMs;   // us * 100 / ms, milli-percent
+  pwrStandbyUs   = 0;
+  pwrWindowStart += windowMs;
+}
+
+uint32_t powerWakeups() {
+  return pwrWakeups;
+}
+
+int32_t powerRead(uint8_t reg) {
+  return (reg == pwrDutyReg) ? (int32_t) pwrDuty : 0;
+}
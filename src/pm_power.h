@@ -0,0 +1,39 @@
+#ifndef pm_power_h
+#define pm_power_h
+
+#include <Arduino.h>
+
+// Sleep between scheduler releases. schedIdle() hands over the time to the
+// next release and powerSleep() picks the deepest mode that keeps everything
+// running that has to:
+//
+//   4808/4809  standby. The RTC PIT keeps triggering conversions through the
+//              event system, the ADC runs in standby and its result interrupt
+//              wakes the core for the ISR, an RTC compare wakes it for the
+//              next release and a TWI address match for the host. The millis()
+//              timer stops in standby, the time slept is measured on the RTC
+//              counter and added back, so the scheduler, the integrator and
+//              the state of charge never see the gap. Falls back to idle while
+//              a host transaction is open or the serial port is still sending.
+//   328P       idle. Timer0 is both millis() and the ADC trigger and stops in
+//              any deeper mode.
+//   native     simulated time jumps to the next release, a host transaction
+//              or pin interrupt ends the sleep early, see nativeSleep().
+//
+// SRAM and the peripherals keep their state in standby, the ADC rings and the
+// coulomb accumulators carry on across a sleep. Register 0x1F reports the
+// share of the last second spent out of standby, running or in idle, which is
+// what sets the draw on the battery side. config2 bit 1 keeps the part at idle.
+
+const uint8_t  pwrCfgIdle    = 0x02;    // config2 bit 1, idle sleep only
+const uint8_t  pwrDutyReg    = 0x1F;    // duty cycle out of standby, milli-percent
+const uint16_t pwrSleepMaxMs = 1000;    // longest sleep, within the 2s the 16-bit RTC compare spans
+const uint16_t pwrWindowMs   = 1000;    // duty cycle window
+
+void     powerBegin();                  // after clockBegin(), which starts the RTC counter
+void     powerConfigure(uint8_t config2);   // integration task, picks up config2 bit 1
+void     powerSleep(uint16_t ms);       // schedIdle(): called with interrupts off, returns with them on
+uint32_t powerWakeups();                // sleeps ended since boot
+int32_t  powerRead(uint8_t reg);
+
+#endif
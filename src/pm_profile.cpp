@@ -0,0 +1,104 @@
+#include <Arduino.h>
+#include "pm_profile.h"
+#include "pm_adc.h"
+#include "pm_buffers.h"
+
+volatile PROF_STAT profStat[PROF_HANDLERS];
+
+static uint32_t          loopLast     = 0;    // micros() at the previous profileLoop()
+static uint32_t          loopMax      = 0;    // longest loop() period, us
+static uint32_t          rateMillis   = 0;    // start of the current rate window
+static uint32_t          rateSamples  = 0;    // adcSampleCount() at that start
+static uint16_t          adcRate      = 0;    // conversions per second over the last window
+static uint16_t          unknownCmds  = 0;
+static volatile uint16_t droppedReqs  = 0;
+static uint16_t          rxBase       = 0;    // rxOverruns() at the last clear
+
+void profileBegin() {
+#if PM_PROFILE
+#if defined(__AVR_ATmega4808__) || defined(__AVR_ATmega4809__)
+  TCB1.CCMP  = 0xFFFF;                                    // free running over the full 16 bits
+  TCB1.CTRLB = TCB_CNTMODE_INT_gc;
+  TCB1.CTRLA = TCB_CLKSEL_CLKDIV2_gc | TCB_ENABLE_bm;
+#elif defined(__AVR_ATmega328P__)
+  TCCR1A = 0;
+  TCCR1B = (1<<CS11);                                     // normal mode, CLK / 8
+#endif
+#endif
+  profileClear();
+}
+
+void profileLoop() {
+#if PM_PROFILE
+  uint32_t nowMicros = micros();
+  uint32_t period    = nowMicros - loopLast;
+  if (loopLast && period > loopMax) loopMax = period;
+  loopLast = nowMicros;
+
+  uint32_t nowMillis = millis();
+  if ((uint32_t) (nowMillis - rateMillis) >= 1000) {      // one second windows
+    uint32_t samples = adcSampleCount();
+    adcRate     = (uint16_t) ((samples - rateSamples) * 1000UL / (nowMillis - rateMillis));
+    rateSamples = samples;
+    rateMillis  = nowMillis;
+  }
+#endif
+}
+
+void profileDropped() {
+  droppedReqs++;
+}
+
+void profileUnknown() {
+  unknownCmds++;
+}
+
+void profileClear() {
+  noInterrupts();
+  for (uint8_t x = 0; x < PROF_HANDLERS; x++) {
+    profStat[x].max = 0;
+    profStat[x].avg = 0;
+  }
+  droppedReqs = 0;
+  interrupts();
+  loopLast    = 0;
+  loopMax     = 0;
+  unknownCmds = 0;
+  rxBase      = rxOverruns();
+  rateMillis  = millis();
+  rateSamples = adcSampleCount();
+}
+
+static int32_t ticksToNs(uint32_t ticks) {
+  return (int32_t) (ticks * 1000UL / profTicksPerUs);
+}
+
+int32_t profileRead(uint8_t reg) {
+  if (reg < profRegFirst || reg > profRegLast) return 0;
+  uint8_t offset = reg - profRegFirst;
+
+  if (offset < PROF_HANDLERS * 2) {                       // max and average per handler, ns
+    uint16_t max;
+    uint32_t avg;
+    noInterrupts();
+    max = profStat[offset >> 1].max;
+    avg = profStat[offset >> 1].avg;
+    interrupts();
+    return (offset & 1) ? ticksToNs(avg) >> profAvgShift : ticksToNs(max);   // scale before the shift keeps the fraction
+  }
+
+  switch (reg) {
+    case 0x6B: return (int32_t) loopMax;
+    case 0x6C: return adcRate;
+    case 0x6D: return unknownCmds;
+    case 0x6E: return (uint16_t) (rxOverruns() - rxBase);
+    case 0x6F: {
+      uint16_t dropped;
+      noInterrupts();
+      dropped = droppedReqs;
+      interrupts();
+      return dropped;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,78 @@
+#ifndef pm_profile_h
+#define pm_profile_h
+
+#include <Arduino.h>
+
+// Profiling counters for registers 0x65-0x70. The ISRs stamp entry and exit
+// from a free-running 16-bit hardware timer (TCB1 at CLK / 2 on the
+// 4808/4809, Timer1 at CLK / 8 on the 328P) and keep a max and a running
+// average in timer ticks, about 30 cycles per handler. loop() records its own
+// period and the achieved ADC conversion rate. Build with -D PM_PROFILE=0 to
+// compile the hooks out, the registers then read 0.
+
+#ifndef PM_PROFILE
+#define PM_PROFILE 1
+#endif
+
+#if defined(__AVR_ATmega4808__) || defined(__AVR_ATmega4809__)
+const uint8_t profTicksPerUs = F_CPU / 2000000UL;
+#elif defined(__AVR_ATmega328P__)
+const uint8_t profTicksPerUs = F_CPU / 8000000UL;
+#else
+const uint8_t profTicksPerUs = 1;       // micros()
+#endif
+
+const uint8_t profRegFirst  = 0x65;     // first profiling register
+const uint8_t profRegLast   = 0x6F;     // last readable one
+const uint8_t profRegClear  = 0x70;     // command: reset every counter
+const uint8_t profAvgShift  = 4;        // running average weight, 1 / 16 per sample
+
+enum PROF_HANDLER : uint8_t {
+  PROF_RECEIVE = 0,                     // Wire receive, receiveEvent()
+  PROF_REQUEST = 1,                     // Wire request, requestEvent()
+  PROF_ADC     = 2,                     // adc result ready
+  PROF_HANDLERS
+};
+
+struct PROF_STAT {
+  uint16_t max = 0;                     // ticks
+  uint32_t avg = 0;                     // ticks << profAvgShift
+};
+
+extern volatile PROF_STAT profStat[PROF_HANDLERS];
+
+#if PM_PROFILE
+
+static inline uint16_t profileTicks() {
+#if defined(__AVR_ATmega4808__) || defined(__AVR_ATmega4809__)
+  return TCB1.CNT;
+#elif defined(__AVR_ATmega328P__)
+  return TCNT1;
+#else
+  return (uint16_t) micros();
+#endif
+}
+
+// ISR exit: fold the duration since start into the handler's stats
+static inline void profileEnd(uint8_t handler, uint16_t start) {
+  uint16_t ticks = profileTicks() - start;              // wrap-safe below 65536 ticks
+  volatile PROF_STAT &stat = profStat[handler];
+  if (ticks > stat.max) stat.max = ticks;
+  stat.avg += ticks - (stat.avg >> profAvgShift);       // avg converges on ticks << profAvgShift
+}
+
+#else
+
+static inline uint16_t profileTicks() { return 0; }
+static inline void     profileEnd(uint8_t handler, uint16_t start) { }
+
+#endif
+
+void    profileBegin();                 // start the timer, call once from setup()
+void    profileLoop();                  // loop: record the period since the last call
+void    profileDropped();               // ISR: a master read found no reply pending
+void    profileUnknown();               // loop: a command byte nobody handles
+void    profileClear();
+int32_t profileRead(uint8_t reg);       // loop: value of a profiling register, for the response cache
+
+#endif
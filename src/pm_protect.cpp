@@ -0,0 +1,199 @@
+#include <Arduino.h>
+#include "pm_clock.h"
+#include "pm_protect.h"
+#include "pm_adc.h"
+#include "pm_calib.h"
+#include "pm_fram.h"
+#include "pm_therm.h"
+#include "pm_log.h"
+
+#if defined(PROT_AC_MUXPOS) && (defined(__AVR_ATmega4808__) || defined(__AVR_ATmega4809__))
+#define PROT_AC 1
+const uint16_t protAcRefMv = 4340;                  // VREF AC0REFSEL 4V34, DACREF is 1/256 of it
+#endif
+
+static int8_t            discPin     = -1;
+static volatile uint16_t ocTripLsb   = 0;           // discharge: current conversions below this are over the limit, 0 disarms
+static volatile uint16_t ocTripHiLsb = 0xFFFF;      // charge: conversions above this are over the limit, 0xFFFF disarms
+static volatile uint8_t  ocRun       = 0;           // consecutive conversions over the limit
+static volatile bool     ocTripped   = false;       // set by the ISRs, cleared when the hold off ends
+static bool              ocHandled   = false;       // trip counted, hold off running
+static uint32_t          ocSince     = 0;           // millis() of the trip
+static uint8_t           faultRun[PROT_FAULTS];     // consecutive checks towards the opposite state
+static uint8_t           faultActive = 0;           // bit per slow fault
+static bool              discOpen    = false;
+
+// open drain: low holds the P-MOSFET on, released the gate pull-up to the pack turns it off.
+// Never driven high, the supply on the gate still leaves the MOSFET on and fights the pull-up.
+static void protectOutput(bool open) {
+  discOpen = open;
+  if (discPin < 0) return;
+  if (open) {
+    pinMode(discPin, INPUT);
+  } else {
+    digitalWrite(discPin, LOW);                     // latch low before the driver turns on
+    pinMode(discPin, OUTPUT);
+  }
+}
+
+static void protectTrip() {
+  ocTripped = true;
+  protectOutput(true);
+}
+
+#ifdef PROT_AC
+ISR(AC0_AC_vect) {
+  AC0.STATUS  = AC_CMP_bm;
+  AC0.INTCTRL = 0;                                  // one trip, protectArm() enables it again after the hold off
+  protectTrip();
+}
+#endif
+
+void protectCurrentSample(uint16_t raw) {
+  if (raw >= ocTripLsb && raw <= ocTripHiLsb) {
+    ocRun = 0;
+  } else if (++ocRun >= protFastCount && !ocTripped) {
+    protectTrip();
+  }
+}
+
+void protectBegin(int8_t disconnectPin) {
+  discPin = disconnectPin;
+  memset(faultRun, 0, sizeof(faultRun));
+  faultActive = 0;
+  protectOutput(false);
+  protectArm();
+}
+
+void protectArm() {
+  uint8_t  config = (uint8_t) framRead32(0x29);
+  uint16_t trip   = 0;
+  uint16_t tripHi = 0xFFFF;
+
+  if (!(config & protCfgDisable) && (config & protCfgOC)) {
+    const CAL_CHANNEL &cal = calChannel(0);
+    int32_t limitLsb = (int32_t) (((int64_t) framRead32(0x21) << 16) / cal.gainQ16);   // mA to lsb either side of the zero
+    int32_t lsb      = (int32_t) cal.offset - limitLsb;
+    int32_t lsbHi    = (int32_t) cal.offset + limitLsb;
+    trip   = (lsb > 0) ? (uint16_t) lsb : 0;
+    tripHi = (lsbHi < 1023) ? (uint16_t) lsbHi : 0xFFFF;   // beyond full scale the charge side cannot trip
+  }
+
+  noInterrupts();                                   // 16-bit stores must not tear against the ISR
+  ocTripLsb   = trip;
+  ocTripHiLsb = tripHi;
+  ocRun       = 0;
+  interrupts();
+
+#ifdef PROT_AC
+  if (trip && !ocTripped) {
+    uint32_t dac = (uint32_t) trip * CAL_VCC_MV / (4UL * protAcRefMv);    // lsb * vcc / 1024 in units of ref / 256
+    VREF.CTRLA   = (VREF.CTRLA & ~VREF_AC0REFSEL_gm) | VREF_AC0REFSEL_4V34_gc;
+    AC0.DACREF   = (dac > 255) ? 255 : (uint8_t) dac;
+    AC0.MUXCTRLA = PROT_AC_MUXPOS | AC_MUXNEG_DACREF_gc;
+    AC0.CTRLA    = AC_ENABLE_bm | AC_INTMODE_NEGEDGE_gc | AC_HYSMODE_25mV_gc;   // sensor falling through the reference
+    AC0.STATUS   = AC_CMP_bm;
+    AC0.INTCTRL  = AC_CMP_bm;
+  } else {
+    AC0.INTCTRL  = 0;
+  }
+#endif
+}
+
+static void protectRecord(uint8_t fault) {
+  framWrite32(0x51 + fault, framRead32(0x51 + fault) + 1);  // disconnect counter
+  framWrite32(0x56, clockNow());                            // last disconnect timestamp
+  framWrite32(0x57, fault + 1);                             // last disconnect reason
+  logEvent(LOG_EV_DISCONNECT, fault + 1);
+}
+
+// debounce a slow fault in both directions, beyond and inside are never both true
+static void protectDebounce(uint8_t fault, bool beyond, bool inside) {
+  uint8_t bit    = 1 << fault;
+  bool    active = faultActive & bit;
+  if ((active && !inside) || (!active && !beyond)) {
+    faultRun[fault] = 0;
+    return;
+  }
+  if (++faultRun[fault] < protDebounce) return;
+  faultRun[fault] = 0;
+  faultActive ^= bit;
+  if (!active) {
+    protectRecord(fault);
+  } else {
+    logEvent(LOG_EV_RECONNECT, fault + 1);
+  }
+}
+
+void protectCheck() {
+  uint8_t config  = (uint8_t) framRead32(0x29);
+  bool    enabled = !(config & protCfgDisable);
+
+  // the fast path only opens the output, counting happens here
+  if (ocTripped && !ocHandled) {
+    ocHandled = true;
+    ocSince   = millis();
+    protectRecord(PROT_OC);
+  }
+  if (ocHandled && (uint32_t) (millis() - ocSince) >= protRetryMs) {
+    ocHandled = false;
+    noInterrupts();
+    ocTripped = false;
+    interrupts();
+    logEvent(LOG_EV_RECONNECT, PROT_OC + 1);
+    protectArm();                                   // still over the limit trips again straight away
+  }
+
+  uint16_t rawCurrent = adcAverage(0);
+  uint16_t rawPack    = adcAverage(2);
+  int32_t  current    = calToMilli(0, rawCurrent);
+  int32_t  pack       = calToMilli(2, rawPack);
+  int32_t  tHigh      = INT32_MIN;
+  int32_t  tLow       = INT32_MAX;
+  bool     tRange     = true;
+  for (uint8_t t = 0; t < thermSensors; t++) {             // hottest and coldest sensor
+    uint16_t rawTemp = adcAverage(adcThermFirst + t);
+    int32_t  temp    = thermToMilli(rawTemp);
+    if (temp > tHigh) tHigh = temp;
+    if (temp < tLow)  tLow  = temp;
+    tRange = tRange && thermInRange(rawTemp);
+  }
+
+  int32_t  iLimit     = (int32_t) framRead32(0x21);
+  int32_t  tHiLimit   = (int32_t) framRead32(0x22);
+  int32_t  tLoLimit   = (int32_t) framRead32(0x23);
+  int32_t  vHiLimit   = (int32_t) framRead32(0x24);
+  int32_t  vLoLimit   = (int32_t) framRead32(0x25);
+
+  bool uv = enabled && (config & protCfgUV);
+  bool ov = enabled && (config & protCfgOV);
+  bool ut = enabled && (config & protCfgUT);
+  bool ot = enabled && (config & protCfgOT);
+  bool oc = enabled && (config & protCfgOC);
+
+  protectDebounce(PROT_UV, uv && pack < vLoLimit,  !uv || pack > vLoLimit + protHystVoltage);
+  protectDebounce(PROT_OV, ov && pack > vHiLimit,  !ov || pack < vHiLimit - protHystVoltage);
+  protectDebounce(PROT_UT, ut && tLow < tLoLimit,  !ut || tLow > tLoLimit + protHystTemp);
+  protectDebounce(PROT_OT, ot && tHigh > tHiLimit, !ot || tHigh < tHiLimit - protHystTemp);
+
+  bool open = ocTripped || faultActive;
+  if (open != discOpen) protectOutput(open);
+
+  uint8_t status0 = 0;
+  if (config)                                                          status0 |= protStConfig;
+  if (clockValid())                                                    status0 |= protStTime;
+  if ((ot && tHigh > tHiLimit - protHystTemp) || (ut && tLow < tLoLimit + protHystTemp)) status0 |= protStTempWarn;
+  if (oc && (current < 0 ? -current : current) > iLimit - protHystCurrent)            status0 |= protStCurrWarn;
+  if ((uv && pack < vLoLimit + protHystVoltage) || (ov && pack > vHiLimit - protHystVoltage)) status0 |= protStVoltWarn;
+  if (!tRange)                                                         status0 |= protStTempRange;
+  if (rawCurrent == 0 || rawCurrent >= 1023)                           status0 |= protStCurrRange;
+  if (rawPack == 0 || rawPack >= 1023)                                 status0 |= protStVoltRange;
+  framWrite32(0x2C, status0);                       // only dirties the slot when a bit changed
+
+  uint8_t status1 = (uint8_t) ((faultActive | (ocTripped ? (1 << PROT_OC) : 0)) << 1) | (discOpen ? 0x01 : 0);
+  framWrite32(0x2D, status1);
+}
+
+bool protectDisconnected() {
+  return discOpen;
+}
@@ -0,0 +1,61 @@
+#ifndef pm_protect_h
+#define pm_protect_h
+
+#include <Arduino.h>
+
+// Protection engine for the config0 disconnects. Over-current has a fast path:
+// the ADC ISR compares every current-channel conversion against precomputed
+// raw thresholds, the limit either side of the zero so charge and discharge
+// both count, and opens the disconnect after two in a row. On the 4808/4809
+// the analog comparator can watch the sensor directly against DACREF for a
+// discharge trip within microseconds. That needs the sensor on an AC input, so
+// build with -D PROT_AC_MUXPOS=AC_MUXPOS_PINn_gc to enable it.
+//
+// The voltage and temperature faults are checked by a scheduler task from the
+// running ring averages, the temperature faults on the hottest and coldest
+// of the three thermistors, with hysteresis and a debounce in both directions.
+// They reconnect once the reading is back inside the hysteresis band. An
+// over-current trip holds the pack off for protRetryMs, then re-arms.
+
+const uint8_t  protDebounce     = 20;       // consecutive checks to trip or clear, 100ms at the 5ms task period
+const uint8_t  protFastCount    = 2;        // consecutive current samples over the limit for the ISR trip
+const uint16_t protRetryMs      = 10000;    // over-current hold off
+const int32_t  protHystCurrent  = 1000;     // mA, also the status0 current warning band
+const int32_t  protHystVoltage  = 250;      // mV, also the status0 voltage warning band
+const int32_t  protHystTemp     = 3000;     // mdegC, also the status0 temperature warning band
+
+// config0 bits
+const uint8_t  protCfgDisable   = 0x80;
+const uint8_t  protCfgOC        = 0x40;
+const uint8_t  protCfgOT        = 0x20;
+const uint8_t  protCfgUT        = 0x10;
+const uint8_t  protCfgUV        = 0x08;
+const uint8_t  protCfgOV        = 0x04;
+
+// status0 bits
+const uint8_t  protStConfig     = 0x80;
+const uint8_t  protStTime       = 0x40;
+const uint8_t  protStTempWarn   = 0x20;
+const uint8_t  protStCurrWarn   = 0x10;
+const uint8_t  protStVoltWarn   = 0x08;
+const uint8_t  protStTempRange  = 0x04;
+const uint8_t  protStCurrRange  = 0x02;
+const uint8_t  protStVoltRange  = 0x01;
+
+// fault index, the disconnect reason code in 0x57 is index + 1 and the counter is 0x51 + index
+enum PROT_FAULT : uint8_t {
+  PROT_OC = 0,                          // over-current
+  PROT_UV = 1,                          // under-voltage
+  PROT_OV = 2,                          // over-voltage
+  PROT_UT = 3,                          // under-temperature
+  PROT_OT = 4,                          // over-temperature
+  PROT_FAULTS
+};
+
+void protectBegin(int8_t disconnectPin);    // call after calBegin(), pulls the open-drain disconnect output low
+void protectArm();                          // recompute thresholds after a limit, config0 or calibration change
+void protectCurrentSample(uint16_t raw);    // ISR: fast over-current check for one current conversion
+void protectCheck();                        // loop: slow faults, status0/status1 and the counters
+bool protectDisconnected();
+
+#endif
@@ -0,0 +1,85 @@
+#include <Arduino.h>
+#include "pm_rate.h"
+#include "pm_calib.h"
+#include "pm_protect.h"
+
+static const uint8_t rateWarnBits = protStTempWarn | protStCurrWarn | protStVoltWarn;
+static const uint8_t rateAvgShift = 2;      // recent average for the step test, a quarter of the way per update
+static const int32_t rateStepMa   = 1000;   // current this far off its recent average counts as changing fast
+
+static RATE_LEVEL rateLevel   = RATE_FAST;
+static RATE_LEVEL rateSlowest = RATE_FAST;  // fastest level asked for while a slower one qualifies
+static uint32_t   rateLastMs  = 0;
+static uint32_t   rateSlowMs  = 0;          // time a slower level has qualified
+static int32_t    rateAvgMa   = 0;
+
+// put the adc on the level, the wake window is rateFastMa either side of the current zero
+static void rateApply() {
+  const CAL_CHANNEL &cal     = calChannel(0);
+  int32_t            wakeLsb = (int32_t) (((int64_t) rateFastMa << 16) / cal.gainQ16);
+  int32_t            lo      = (int32_t) cal.offset - wakeLsb;
+  int32_t            hi      = (int32_t) cal.offset + wakeLsb;
+  adcSetRate(rateProfiles[rateLevel].adcShift, lo > 0 ? lo : 0, hi < 1023 ? hi : 1023);
+}
+
+static RATE_LEVEL rateWanted(int32_t currentMa, uint8_t status0, uint8_t config2) {
+  int32_t mag  = currentMa < 0 ? -currentMa : currentMa;
+  int32_t step = currentMa - rateAvgMa;
+  if ((config2 & rateCfgFixed) || (status0 & rateWarnBits)) return RATE_FAST;
+  if (mag >= rateFastMa || step >= rateStepMa || step <= -rateStepMa) return RATE_FAST;
+  return (mag <= rateRestMa) ? RATE_REST : RATE_NORMAL;
+}
+
+void rateBegin() {
+  rateLevel   = RATE_FAST;                  // start at the full rate until the load is known
+  rateSlowest = RATE_FAST;
+  rateSlowMs  = 0;
+  rateLastMs  = millis();
+  rateApply();
+}
+
+bool rateWake() {
+  if (rateLevel == RATE_FAST || adcRateShift() == rateProfiles[rateLevel].adcShift) return false;
+  rateLevel   = RATE_FAST;
+  rateSlowMs  = 0;
+  return true;
+}
+
+bool rateUpdate(int32_t currentMa, uint8_t status0, uint8_t config2) {
+  uint32_t nowMs   = millis();
+  uint32_t elapsed = nowMs - rateLastMs;
+  rateLastMs = nowMs;
+
+  bool       changed = rateWake();
+  RATE_LEVEL want    = rateWanted(currentMa, status0, config2);
+  rateAvgMa += (currentMa - rateAvgMa) / (1 << rateAvgShift);
+
+  if (want < rateLevel) {                   // faster, right away
+    rateLevel  = want;
+    rateSlowMs = 0;
+    rateApply();
+    return true;
+  }
+  if (want == rateLevel) {
+    rateSlowMs = 0;
+    return changed;
+  }
+
+  if (!rateSlowMs || want < rateSlowest) rateSlowest = want;
+  rateSlowMs += elapsed;
+  if (rateSlowMs < rateHoldMs) return changed;
+  rateLevel  = rateSlowest;
+  rateSlowMs = 0;
+  rateApply();
+  return true;
+}
+
+const RATE_PROFILE &rateProfile() {
+  return rateProfiles[rateLevel];
+}
+
+// snapshot interval: a frame is adcRingSize scan rounds at the conversion rate in effect
+int32_t rateRead(uint8_t reg) {
+  if (reg != rateReg) return 0;
+  return (int32_t) (((uint32_t) adcRingSize * adcRoundSlots * 1000UL << adcRateShift()) / adcSampleRateHz);
+}
@@ -0,0 +1,62 @@
+#ifndef pm_rate_h
+#define pm_rate_h
+
+#include <Arduino.h>
+#include "pm_adc.h"
+
+// Adaptive acquisition rate. A pack spends most of its life at rest and the
+// rest of it under a load that can change fast, so the conversion rate, the
+// integration period and the acquisition task period follow the load instead
+// of staying at the worst case:
+//
+//   fast    |current| at rateFastMa or more, current changing by rateSlopeMa
+//           per second or more, or a status0 warning bit set: full conversion
+//           rate and a 20ms integration period
+//   normal  anything between: half rate, 100ms integration
+//   rest    |current| within rateRestMa: an eighth of the rate, 1s integration
+//
+// A faster level takes effect at the next evaluation, a slower one only after
+// rateHoldMs of qualifying readings. While divided down the ADC ISR watches a
+// wake window of rateFastMa around the current zero and goes back to the full
+// rate on the first conversion outside it, rateWake() lets loop() catch up.
+// config2 bit 0 pins the fast level. The NAU7802 rate is its own setting
+// (0x4D) and is left alone, with it fitted the acquisition task keeps polling
+// at rateNauAcquireMs.
+//
+// Register 0x20 reports the snapshot interval in effect, a host matches its
+// polling cadence to it.
+
+enum RATE_LEVEL : uint8_t {
+  RATE_FAST   = 0,
+  RATE_NORMAL = 1,
+  RATE_REST   = 2,
+  RATE_LEVELS
+};
+
+struct RATE_PROFILE {
+  uint8_t  adcShift;                    // conversion rate is adcSampleRateHz >> adcShift
+  uint16_t integrateMs;                 // integration task period
+  uint16_t acquireMs;                   // acquisition task period, the adc frame fills 2^adcShift times slower
+};
+
+const RATE_PROFILE rateProfiles[RATE_LEVELS] = {
+  { 0, 20,   2 },
+  { 1, 100,  4 },
+  { 3, 1000, 16 },
+};
+
+const int32_t  rateFastMa       = 5000;     // |current| for the fast level, also the wake window
+const int32_t  rateSlopeMa      = 2000;     // mA per second of change for the fast level
+const int32_t  rateRestMa       = 100;      // |current| counted as rest, same band as the state of charge
+const uint16_t rateHoldMs       = 5000;     // a slower level has to qualify this long
+const uint16_t rateNauAcquireMs = 2;        // ahead of the NAU7802 at 320 SPS
+const uint8_t  rateCfgFixed     = 0x01;     // config2 bit 0, always the fast level
+const uint8_t  rateReg          = 0x20;     // snapshot interval, ms
+
+void                rateBegin();
+bool                rateUpdate(int32_t currentMa, uint8_t status0, uint8_t config2);   // integration task, true if the level changed
+bool                rateWake();             // acquisition task, true if the ISR went back to the full rate
+const RATE_PROFILE &rateProfile();          // profile of the level in effect
+int32_t             rateRead(uint8_t reg);
+
+#endif
@@ -0,0 +1,98 @@
+#include <Arduino.h>
+#include "pm_registers.h"
+
+static volatile int32_t regCache[regCount];                 // last value of every readable register
+static char             regFloatText[regFloatSlots][regFloatLen];
+static uint8_t          regFloatReg[regFloatSlots];         // register rendered into each text slot
+
+// fetch the flash entry for a register, false if reg is outside the table
+static bool regEntry(const REG_ENTRY *table, uint8_t reg, REG_ENTRY &entry) {
+  if (reg < regFirst || reg > regLast) return false;
+  memcpy_P(&entry, &table[reg - regFirst], sizeof(entry));  // table lives in flash
+  return true;
+}
+
+void regCacheRefresh(const REG_ENTRY *table) {
+  uint8_t floatSlot = 0;
+  for (uint8_t idx = 0; idx < regCount; idx++) {
+    REG_ENTRY entry;
+    memcpy_P(&entry, &table[idx], sizeof(entry));
+    if (!entry.read) continue;
+
+    int32_t value = entry.read(entry.reg);                  // may be slow, runs with interrupts enabled
+    noInterrupts();
+    regCache[idx] = value;
+    interrupts();
+
+    if (entry.ascii == ASC_FLOAT && floatSlot < regFloatSlots) {
+      char text[regFloatLen];
+      dtostrf(value / 1000.0, 3, 2, text);
+      noInterrupts();                                       // the receive ISR may be copying this slot
+      memcpy(regFloatText[floatSlot], text, regFloatLen);
+      regFloatReg[floatSlot] = entry.reg;
+      interrupts();
+      floatSlot++;
+    }
+  }
+}
+
+int32_t regCached(uint8_t reg) {
+  if (reg < regFirst || reg > regLast) return 0;
+  int32_t value;
+  noInterrupts();
+  value = regCache[reg - regFirst];
+  interrupts();
+  return value;
+}
+
+uint8_t regEncodeBinary(const REG_ENTRY *table, uint8_t cmd, uint8_t slaveAddr, uint8_t *out) {
+  REG_ENTRY entry;
+  if (!(cmd & regBinaryFlag) || !regEntry(table, cmd & ~regBinaryFlag, entry)) return 0;
+  uint8_t width = regWidth(entry.type);
+  if (!width) return 0;
+
+  uint32_t value = (uint32_t) regCache[entry.reg - regFirst];
+  for (uint8_t x = 0; x < width; x++) {                     // little-endian, truncated to the register width
+    out[x] = (uint8_t) value;
+    value >>= 8;
+  }
+
+  if (regCache[regConfig1 - regFirst] & regPecEnable) {     // PEC covers addr+W, command, addr+R and the data
+    uint8_t header[3] = { (uint8_t) (slaveAddr << 1), cmd, (uint8_t) ((slaveAddr << 1) | 1) };
+    out[width] = crc8(out, width, crc8(header, sizeof(header)));
+    width++;
+  }
+  return width;
+}
+
+uint8_t regEncodeAscii(const REG_ENTRY *table, uint8_t cmd, uint8_t *out) {
+  REG_ENTRY entry;
+  if (!regEntry(table, cmd, entry)) return 0;
+  int32_t value = regCache[cmd - regFirst];
+
+  switch (entry.ascii) {
+    case ASC_BYTE:
+      out[0] = (uint8_t) value;
+      return 1;
+    case ASC_INT:
+      ltoa(value, (char *) out, 10);
+      return 6;
+    case ASC_LONG:
+      if (regSigned(entry.type)) {
+        ltoa(value, (char *) out, 10);
+      } else {
+        ultoa((uint32_t) value, (char *) out, 10);
+      }
+      return 11;
+    case ASC_FLOAT:
+      for (uint8_t slot = 0; slot < regFloatSlots; slot++) {
+        if (regFloatReg[slot] == cmd) {
+          memcpy(out, regFloatText[slot], regFloatLen);
+          return 6;
+        }
+      }
+      return 0;                                             // not rendered yet
+    default:
+      return 0;
+  }
+}
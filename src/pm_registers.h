@@ -0,0 +1,71 @@
+#ifndef pm_registers_h
+#define pm_registers_h
+
+#include <Arduino.h>
+#include "pm_codec.h"
+
+// Register table and response cache. loop() re-reads every readable register
+// into the cache with regCacheRefresh(), the receive ISR only renders replies
+// from the cache and never touches FRAM, the clock or float formatting.
+//
+// Setting bit 7 of the command byte asks for the register in binary instead
+// of ASCII: a fixed-width little-endian value in milli-units, optionally
+// followed by an SMBus PEC byte. The plain command bytes in registers.md keep
+// their ASCII replies.
+
+const uint8_t regBinaryFlag = 0x80;     // command bit 7 selects a binary reply
+const uint8_t regFirst      = 0x1D;     // first register in the dispatch table
+const uint8_t regLast       = 0x7F;     // last register in the dispatch table
+const uint8_t regCount      = regLast - regFirst + 1;
+const uint8_t regConfig1    = 0x2A;     // read config1, holds the PEC enable bit
+const uint8_t regPecEnable  = 0x01;     // config1 bit 0, append PEC to binary replies
+const uint8_t regFloatSlots = 4;        // registers with a pre-rendered float reply
+const uint8_t regFloatLen   = 8;        // room for "-xx.xx" plus the null
+
+// low nibble is the width on the wire, high nibble the signedness
+enum REG_TYPE : uint8_t {
+  REG_NONE = 0x00,                      // write-only or reserved, no binary reply
+  REG_U8   = 0x01,
+  REG_U16  = 0x02,
+  REG_I16  = 0x12,
+  REG_I32  = 0x14,
+  REG_U32  = 0x04,
+};
+
+// ascii reply formats, matching the replies documented in registers.md
+enum REG_ASCII : uint8_t {
+  ASC_NONE  = 0,                        // not readable in ascii, the command is executed by loop()
+  ASC_BYTE  = 1,                        // single raw byte
+  ASC_INT   = 2,                        // ltoa, 6 bytes on the wire
+  ASC_LONG  = 3,                        // ltoa or ultoa by the type, 11 bytes on the wire
+  ASC_FLOAT = 4,                        // milli-units as x.xx, pre-rendered by regCacheRefresh()
+};
+
+struct REG_ENTRY {
+  uint8_t reg;                          // command byte, must equal regFirst + table index
+  uint8_t type;                         // REG_TYPE
+  uint8_t ascii;                        // REG_ASCII
+  int32_t (*read)(uint8_t reg);         // value in milli-units, unsigned types are cast through int32_t
+};
+
+constexpr uint8_t regWidth(uint8_t type) { return type & 0x0F; }
+constexpr bool    regSigned(uint8_t type) { return type & 0xF0; }
+
+// compile time check that a table holds exactly one entry per register, in order
+constexpr bool regTableOrdered(const REG_ENTRY *table, uint8_t entries, uint8_t idx = 0) {
+  return (idx >= entries) || ((table[idx].reg == regFirst + idx) && regTableOrdered(table, entries, idx + 1));
+}
+
+// compile time count of entries with a given ascii format
+constexpr uint8_t regAsciiCount(const REG_ENTRY *table, uint8_t entries, uint8_t ascii, uint8_t idx = 0) {
+  return (idx >= entries) ? 0 : (table[idx].ascii == ascii) + regAsciiCount(table, entries, ascii, idx + 1);
+}
+
+void    regCacheRefresh(const REG_ENTRY *table);                     // loop: re-read every register into the cache
+int32_t regCached(uint8_t reg);                                      // loop: cached value of a register, 0 if not readable
+
+// ISR: render a reply for cmd from the cache into out, returns the number of bytes or 0 if cmd is not a read
+uint8_t regEncodeBinary(const REG_ENTRY *table, uint8_t cmd, uint8_t slaveAddr, uint8_t *out);
+uint8_t regEncodeAscii(const REG_ENTRY *table, uint8_t cmd, uint8_t *out);
+
+#endif
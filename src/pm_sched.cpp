@@ -0,0 +1,63 @@
+#include <Arduino.h>
+#include "pm_sched.h"
+#include "pm_buffers.h"
+#include "pm_power.h"
+
+static inline bool schedDue(const SCHED_TASK &task, uint16_t nowMs) {
+  return (int16_t) (nowMs - task.next) >= 0;            // wrap-safe for periods under 32s
+}
+
+void schedBegin(SCHED_TASK *tasks, uint8_t count) {
+  uint16_t nowMs = millis();
+  for (uint8_t x = 0; x < count; x++) {
+    tasks[x].next   = nowMs + tasks[x].period;
+    tasks[x].misses = 0;
+  }
+}
+
+bool schedRun(SCHED_TASK *tasks, uint8_t count) {
+  bool ran = false;
+  for (uint8_t x = 0; x < count; x++) {
+    SCHED_TASK &task = tasks[x];
+    uint16_t nowMs = millis();
+    if (!schedDue(task, nowMs)) continue;
+
+    uint16_t late = nowMs - task.next;
+    if (late >= task.period) {                          // whole periods went by without a run
+      uint16_t skipped = late / task.period;
+      task.misses = (task.misses > UINT16_MAX - skipped) ? UINT16_MAX : task.misses + skipped;
+      task.next  += skipped * task.period;              // keep the phase
+    }
+    task.next += task.period;
+    task.run();
+    ran = true;
+  }
+  return ran;
+}
+
+void schedIdle(SCHED_TASK *tasks, uint8_t count) {
+  noInterrupts();                                       // nothing may slip in between the checks and sleep
+  uint16_t nowMs = millis();
+  int16_t  wait  = INT16_MAX;
+  for (uint8_t x = 0; x < count; x++) {
+    int16_t left = tasks[x].next - nowMs;
+    if (left < wait) wait = left;
+  }
+  if (wait <= 0 || rxPeek() != nullptr) {               // due, or a command arrived while the tasks ran
+    interrupts();
+    return;
+  }
+  powerSleep(wait);                                     // returns with interrupts on
+}
+
+void schedSetPeriod(SCHED_TASK *tasks, uint8_t count, uint8_t task, uint16_t period) {
+  if (task >= count || !period) return;
+  SCHED_TASK &t    = tasks[task];
+  uint16_t   first = millis() + period;
+  t.period = period;
+  if ((int16_t) (t.next - first) > 0) t.next = first;   // do not sit out the rest of a long period
+}
+
+uint16_t schedMisses(const SCHED_TASK *tasks, uint8_t count, uint8_t task) {
+  return (task < count) ? tasks[task].misses : 0;
+}
@@ -0,0 +1,26 @@
+#ifndef pm_sched_h
+#define pm_sched_h
+
+#include <Arduino.h>
+
+// Cooperative tick scheduler. Each task runs at a fixed period on the millis()
+// tick and keeps its phase: a task that is released late runs once and the
+// releases it skipped are counted as deadline misses instead of being run back
+// to back. Between releases schedIdle() hands the time to the next one to
+// powerSleep(), any interrupt that wakes the core early ends the sleep and
+// loop() comes round again.
+
+struct SCHED_TASK {
+  void   (*run)();                      // task body, runs to completion
+  uint16_t period;                      // ms
+  uint16_t next;                        // millis() of the next release, low 16 bits, set by schedBegin()
+  uint16_t misses;                      // releases skipped because the task ran too late, saturates
+};
+
+void     schedBegin(SCHED_TASK *tasks, uint8_t count);  // first release of every task one period from now
+bool     schedRun(SCHED_TASK *tasks, uint8_t count);    // run every task that is due, true if any ran
+void     schedIdle(SCHED_TASK *tasks, uint8_t count);   // sleep until the next release or interrupt unless a task is due
+void     schedSetPeriod(SCHED_TASK *tasks, uint8_t count, uint8_t task, uint16_t period);   // a shorter period starts with the next tick
+uint16_t schedMisses(const SCHED_TASK *tasks, uint8_t count, uint8_t task);
+
+#endif
@@ -0,0 +1,22 @@
+#include <Arduino.h>
+#include "pm_snapshot.h"
+#include "pm_registers.h"
+
+static PM_SNAPSHOT           snapshotBuffer[2];
+static volatile uint8_t      snapshotFront = 0;          // index the ISR reads from, loop() writes the other one
+static uint16_t              snapshotSeq   = 0;
+
+void snapshotPublish(PM_SNAPSHOT &frame) {
+  uint8_t back = snapshotFront ^ 1;
+
+  frame.version = snapshotVersion;
+  frame.seq     = ++snapshotSeq;
+  frame.crc     = crc8((const uint8_t *) &frame, sizeof(PM_SNAPSHOT) - 1);
+  snapshotBuffer[back] = frame;
+  snapshotFront = back;                                  // single byte store, atomic against the ISR
+}
+
+uint8_t snapshotCopy(uint8_t *out) {
+  memcpy(out, &snapshotBuffer[snapshotFront], sizeof(PM_SNAPSHOT));
+  return sizeof(PM_SNAPSHOT);
+}
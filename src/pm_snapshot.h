@@ -0,0 +1,35 @@
+#ifndef pm_snapshot_h
+#define pm_snapshot_h
+
+#include <stdint.h>
+
+// Telemetry snapshot served by register 0x4B. loop() captures a complete frame
+// into the back buffer and publishes it with a pointer swap, so the request
+// ISR always copies one consistent frame. The sequence number increments on
+// every capture and the trailing CRC-8 lets the host reject torn reads.
+// This header only needs <stdint.h>, the host poller in host/ decodes the
+// same struct.
+
+const uint8_t snapshotRegister = 0x4B;
+const uint8_t snapshotVersion  = 2;     // bump whenever the frame layout changes
+
+struct __attribute__((packed)) PM_SNAPSHOT {
+  uint8_t  version      = snapshotVersion;
+  uint16_t seq          = 0;            // capture sequence number, wraps
+  uint32_t timestamp    = 0;            // clockNow() at capture
+  int32_t  current      = 0;            // load current, mA
+  uint16_t packVoltage  = 0;            // mV
+  uint16_t busVoltage   = 0;            // mV
+  int16_t  t0           = 0;            // cdegC, mdegC would overflow above 32 degC
+  int16_t  t1           = 0;            // cdegC
+  int16_t  t2           = 0;            // cdegC
+  int32_t  coulomb      = 0;            // coulomb counter
+  uint8_t  status0      = 0;
+  uint8_t  status1      = 0;
+  uint8_t  crc          = 0;            // crc8 over every preceding byte
+};
+
+void    snapshotPublish(PM_SNAPSHOT &frame);    // stamp seq and crc, then make it the frame served to the host
+uint8_t snapshotCopy(uint8_t *out);             // copy the published frame, called from the request ISR
+
+#endif
@@ -0,0 +1,179 @@
+#include <Arduino.h>
+#include "pm_soc.h"
+#include "pm_fram.h"
+
+// rested LiFePO4 cell voltage at 0% to 100% in 10% steps, mV
+static const int16_t socOcv[socOcvPoints] PROGMEM = { 2500, 3000, 3200, 3220, 3250, 3260, 3270, 3290, 3310, 3330, 3400 };
+
+static FramBus       *socBus   = nullptr;
+static const uint8_t *socPins  = nullptr;
+static SOC_RECORD     socState;
+static SOC_RECORD     socSaved;             // record as last written to FRAM
+static bool           socSeed  = false;     // no valid record, the first pack reading seeds the charge
+static uint32_t       lastIn   = 0;         // lifetime charge registers at the previous update
+static uint32_t       lastOut  = 0;
+static uint32_t       socLastMs = 0;
+static uint32_t       restMs   = 0;         // time the current has stayed within socRestMa
+static uint32_t       fullMs   = 0;         // time the charge has stayed tapered at the full voltage
+static int32_t        avgMa    = 0;         // filtered current for the time to empty
+
+static uint32_t socFull() {
+  return socState.learnedMah ? socState.learnedMah : socState.designMah;
+}
+
+static uint32_t socPercent() {
+  uint32_t full = socFull();
+  return full ? (uint32_t) ((uint64_t) socState.remainMah * 100000 / full) : 0;
+}
+
+static uint32_t socCharge(uint32_t milliPercent) {
+  return (uint32_t) ((uint64_t) socFull() * milliPercent / 100000);
+}
+
+// milli-percent at a rested cell voltage, slope is the mV span of the segment it falls on
+static uint32_t socFromOcv(int32_t cellMv, int16_t &slope) {
+  int16_t lo = (int16_t) pgm_read_word(&socOcv[0]);
+  for (uint8_t idx = 1; idx < socOcvPoints; idx++) {
+    int16_t hi = (int16_t) pgm_read_word(&socOcv[idx]);
+    slope = hi - lo;
+    if (cellMv < hi) {
+      if (cellMv < lo) return 0;            // below the table
+      return (idx - 1) * (uint32_t) socOcvStep + (uint32_t) (cellMv - lo) * socOcvStep / slope;
+    }
+    lo = hi;
+  }
+  return 100000;
+}
+
+// end of charge, the cycle the next learning step measures starts here
+static void socMarkFull() {
+  socState.remainMah   = socFull();
+  socState.fullSeen    = 1;
+  socState.cycleOutMah = 0;
+  socState.cycleInMah  = 0;
+}
+
+// the pack has rested long enough for its voltage to be the OCV
+static void socRested(int32_t cellMv) {
+  int16_t  slope;
+  uint32_t ocv = socFromOcv(cellMv, slope);
+  if (slope < socOcvSlopeMin) return;       // on the plateau, the count is the better estimate
+
+  if (socState.fullSeen && ocv <= 100000 - socLearnDepth && socState.cycleOutMah > socState.cycleInMah) {
+    uint32_t used     = socState.cycleOutMah - socState.cycleInMah;
+    uint32_t measured = (uint32_t) ((uint64_t) used * 100000 / (100000 - ocv));
+    if (measured <= 2 * socState.designMah) {                 // a miscounted cycle must not wreck the estimate
+      int32_t step = ((int32_t) measured - (int32_t) socState.learnedMah) / (1 << socLearnShift);
+      socState.learnedMah += step;
+    }
+    socState.fullSeen = 0;                  // one measurement per cycle
+  }
+  socState.remainMah = socCharge(ocv);
+}
+
+void socBegin(FramBus &bus, const uint8_t *ledPins) {
+  socBus  = &bus;
+  socPins = ledPins;
+  lastIn  = framRead32(0x36);               // lifetime in and out, restored by the journal
+  lastOut = framRead32(0x37);
+
+  bool valid = bus.read(socBase, (uint8_t *) &socState, sizeof(socState)) && socState.magic == socMagic
+               && socState.crc == crc8((const uint8_t *) &socState, sizeof(socState) - 1);
+  if (!valid) {
+    memset(&socState, 0, sizeof(socState));
+    socState.magic      = socMagic;
+    socState.designMah  = SOC_DESIGN_MAH;
+    socState.learnedMah = SOC_DESIGN_MAH;
+    socSeed = true;
+  }
+  socSaved       = socState;
+  socSaved.magic = valid ? socMagic : 0;    // a fresh record is written on the first persist
+  socLastMs      = millis();
+}
+
+void socUpdate(int32_t currentMa, int32_t packMv) {
+  if (!socBus) return;
+  uint32_t nowMs   = millis();
+  uint32_t elapsed = nowMs - socLastMs;
+  socLastMs = nowMs;
+
+  uint32_t in    = framRead32(0x36);
+  uint32_t out   = framRead32(0x37);
+  uint32_t dIn   = in - lastIn;
+  uint32_t dOut  = out - lastOut;
+  uint32_t full  = socFull();
+  lastIn  = in;
+  lastOut = out;
+
+  uint32_t remain = socState.remainMah + dIn;
+  remain = (remain > dOut) ? remain - dOut : 0;
+  socState.remainMah = (remain > full) ? full : remain;
+  if (socState.fullSeen) {
+    socState.cycleInMah  += dIn;
+    socState.cycleOutMah += dOut;
+  }
+  avgMa += (currentMa - avgMa) / (1 << socTteFilter);
+
+  int32_t cellMv = packMv / SOC_CELLS;
+  if (socSeed) {                            // best guess until the first rest or end of charge
+    if (packMv <= 0) return;
+    int16_t slope;
+    socState.remainMah = socCharge(socFromOcv(cellMv, slope));
+    socSeed = false;
+  }
+
+  if (cellMv >= socFullMv && currentMa > 0 && currentMa < (int32_t) (socState.designMah / 20)) {
+    if (fullMs < socFullSeconds * 1000UL && (fullMs += elapsed) >= socFullSeconds * 1000UL) socMarkFull();
+  } else {
+    fullMs = 0;
+  }
+
+  if (currentMa >= -socRestMa && currentMa <= socRestMa) {
+    if (restMs < socRestSeconds * 1000UL && (restMs += elapsed) >= socRestSeconds * 1000UL) socRested(cellMv);
+  } else {
+    restMs = 0;
+  }
+}
+
+void socPersist() {
+  if (!socBus || !memcmp(&socState, &socSaved, sizeof(SOC_RECORD) - 1)) return;
+  socState.crc = crc8((const uint8_t *) &socState, sizeof(SOC_RECORD) - 1);
+  if (socBus->write(socBase, (const uint8_t *) &socState, sizeof(SOC_RECORD))) socSaved = socState;
+}
+
+void socSetDesign(uint32_t mah) {
+  uint32_t soc = socPercent();
+  socState.designMah   = mah ? mah : SOC_DESIGN_MAH;
+  socState.learnedMah  = socState.designMah;                  // a new pack, learning starts over
+  socState.fullSeen    = 0;
+  socState.cycleOutMah = 0;
+  socState.cycleInMah  = 0;
+  socState.remainMah   = socCharge(soc);
+}
+
+void socShowLeds(bool blink) {
+  if (!socPins) return;
+  uint32_t soc = socPercent();
+  uint8_t  lit = (soc >= 67000) ? 3 : (soc >= 34000) ? 2 : (soc >= 10000) ? 1 : 0;
+  for (uint8_t led = 0; led < socLeds; led++) {
+    digitalWrite(socPins[led], (led < lit || (!lit && !led && blink)) ? HIGH : LOW);   // below 10% the first led flashes
+  }
+}
+
+int32_t socRead(uint8_t reg) {
+  switch (reg) {
+    case socReg:       return socPercent();
+    case socRemainReg: return socState.remainMah;
+    case socTteReg:
+      if (avgMa >= -socRestMa) return socTteNone;
+      {
+        uint32_t minutes = socState.remainMah * 60UL / (uint32_t) -avgMa;
+        return (minutes < socTteNone) ? minutes : socTteNone - 1;
+      }
+    case socDesignReg: return socState.designMah;
+    case socHealthReg:
+      if (!socState.designMah) return 0;                      // before socBegin()
+      return (uint32_t) ((uint64_t) socState.learnedMah * 100000 / socState.designMah);
+  }
+  return 0;
+}
@@ -0,0 +1,78 @@
+#ifndef pm_soc_h
+#define pm_soc_h
+
+#include <Arduino.h>
+#include "pm_journal.h"
+#include "pm_log.h"
+
+// State of charge and health for LiFePO4 packs. The coulomb counter is the
+// primary estimate: socUpdate() follows the lifetime charge registers in whole
+// mAh and moves the remaining charge with them. Coulomb counting drifts, so two
+// events pin it back:
+//
+//   end of charge  pack at socFullMv per cell with the charge current tapered
+//                  below C/20 for socFullSeconds: the pack is full
+//   rest           current within socRestMa for socRestSeconds: the cell
+//                  voltage is the open circuit voltage, looked up in socOcv[]
+//
+// The LiFePO4 curve is flat between about 20% and 90%, a rest reading there
+// says little, so the OCV only replaces the count on the steep segments at
+// either end. A rest near empty after a full charge closes a cycle: the charge
+// taken out since the full point, divided by the depth the OCV says was used,
+// is a measured capacity and is blended into the learned capacity. State of
+// health is the learned capacity over the design capacity.
+//
+// The estimator state lives in its own CRC'd record between the journal and
+// the log, written back by the persist task when it changed.
+
+#ifndef SOC_CELLS
+#define SOC_CELLS 4                     // cells in series, 4S matches the default voltage limits
+#endif
+#ifndef SOC_DESIGN_MAH
+#define SOC_DESIGN_MAH 100000           // rated capacity, 0x7E overrides it at runtime
+#endif
+
+const uint16_t socBase        = 0x01C0;   // estimator record, between the journal and the log
+const uint8_t  socMagic       = 0x5C;
+const uint8_t  socOcvPoints   = 11;       // 0% to 100% in 10% steps
+const uint16_t socOcvStep     = 10000;    // milli-percent between points
+const int16_t  socOcvSlopeMin = 40;       // mV per cell over a segment, flatter segments keep the count
+const uint16_t socFullMv      = 3550;     // per cell, end of charge voltage
+const uint16_t socFullSeconds = 60;
+const int32_t  socRestMa      = 100;      // |current| counted as rest
+const uint16_t socRestSeconds = 1800;     // LiFePO4 relaxes slowly, 30 minutes before the OCV is trusted
+const uint32_t socLearnDepth  = 80000;    // milli-percent of a full charge a cycle must cover to learn from
+const uint8_t  socLearnShift  = 2;        // each measured capacity moves the learned one a quarter of the way
+const uint8_t  socTteFilter   = 4;        // current average for time to empty, 2^4 updates
+const uint16_t socTteNone     = 0xFFFF;   // time to empty while not discharging
+const uint8_t  socCfgLeds     = 0x01;     // config0 bit 0, LED1 to LED3 show the state of charge
+const uint8_t  socLeds        = 3;
+
+const uint8_t  socReg         = 0x7B;     // state of charge, milli-percent
+const uint8_t  socRemainReg   = 0x7C;     // remaining charge, mAh
+const uint8_t  socTteReg      = 0x7D;     // time to empty, minutes
+const uint8_t  socDesignReg   = 0x7E;     // design capacity, mAh
+const uint8_t  socHealthReg   = 0x7F;     // state of health, milli-percent
+
+struct __attribute__((packed)) SOC_RECORD {
+  uint8_t  magic;                         // socMagic
+  uint8_t  fullSeen;                      // 1 once an end of charge started the current cycle
+  uint32_t remainMah;
+  uint32_t designMah;
+  uint32_t learnedMah;                    // full charge capacity
+  uint32_t cycleOutMah;                   // charge out since the last end of charge
+  uint32_t cycleInMah;                    // charge in since the last end of charge
+  uint8_t  crc;                           // crc8 over everything before it
+};
+
+static_assert(socBase >= framJournalB + sizeof(JOURNAL_RECORD), "soc record runs into the journal");
+static_assert(socBase + sizeof(SOC_RECORD) <= logBase, "soc record runs into the log");
+
+void    socBegin(FramBus &bus, const uint8_t *ledPins);   // call after journalRestore(), a blank record seeds from the OCV
+void    socUpdate(int32_t currentMa, int32_t packMv);     // loop: after coulombUpdate(), every integration period
+void    socPersist();                                     // loop: write the record back if it changed
+void    socSetDesign(uint32_t mah);                       // 0 restores SOC_DESIGN_MAH, restarts learning
+void    socShowLeds(bool blink);                          // loop: bar graph on the SOC LEDs, blink flashes a low pack
+int32_t socRead(uint8_t reg);                             // 0x7B to 0x7F for the register cache
+
+#endif
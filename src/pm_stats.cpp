@@ -0,0 +1,115 @@
+#include <Arduino.h>
+#include "pm_clock.h"
+#include "pm_stats.h"
+#include "pm_fram.h"
+
+struct STAT_ACC {
+  int32_t  min;
+  int32_t  max;
+  int32_t  meanQ8;                      // milli-units << 8
+  uint64_t m2Q16;                       // sum of squared deviations, (milli-units << 8)^2
+  int32_t  meanRem;                     // full window: part of delta / statWindow not yet in meanQ8
+  uint16_t m2Rem;                       // full window: part of m2Q16 / statWindow not yet decayed
+  uint16_t count;                       // samples in the mean, stops at statWindow
+  bool     seeded;                      // min and max hold a real reading
+};
+
+static STAT_ACC statAcc[STAT_CHANNELS];
+static uint8_t  statSelected = STAT_PACK;
+
+void statsBegin() {
+  for (uint8_t ch = 0; ch < STAT_CHANNELS; ch++) {
+    const STAT_REGS &regs = statRegs[ch];
+    STAT_ACC &acc = statAcc[ch];
+    acc.min     = (int32_t) framRead32(regs.min);
+    acc.max     = (int32_t) framRead32(regs.max);
+    acc.seeded  = acc.min || acc.max || framRead32(regs.minTime) || framRead32(regs.maxTime);   // all zero after a clear
+    acc.meanQ8  = 0;
+    acc.m2Q16   = 0;
+    acc.meanRem = 0;
+    acc.m2Rem   = 0;
+    acc.count   = 0;
+  }
+}
+
+void statsSample(uint8_t channel, int32_t milli) {
+  if (channel >= STAT_CHANNELS) return;
+  STAT_ACC &acc = statAcc[channel];
+  const STAT_REGS &regs = statRegs[channel];
+
+  if (!acc.seeded || milli < acc.min) {           // FRAM only sees a moved extreme
+    acc.min = milli;
+    framWrite32(regs.min, milli);
+    framWrite32(regs.minTime, clockNow());
+  }
+  if (!acc.seeded || milli > acc.max) {
+    acc.max = milli;
+    framWrite32(regs.max, milli);
+    framWrite32(regs.maxTime, clockNow());
+  }
+  acc.seeded = true;
+
+  // Welford: mean += delta / n, m2 += delta * (x - new mean)
+  int32_t xQ8   = milli * 256;
+  int32_t delta = xQ8 - acc.meanQ8;
+  if (acc.count < statWindow) {
+    acc.count++;
+    acc.meanQ8 += delta / acc.count;
+    acc.m2Q16  += (int64_t) delta * (xQ8 - acc.meanQ8);
+  } else {                                        // full window, the oldest weight decays instead
+    acc.meanRem += delta;                         // remainders carry over, a drift under one step still moves the mean
+    int32_t step = acc.meanRem / statWindow;
+    acc.meanRem -= step * (int32_t) statWindow;
+    acc.meanQ8  += step;
+
+    uint64_t decay = acc.m2Q16 + acc.m2Rem;
+    acc.m2Rem  = decay % statWindow;
+    acc.m2Q16 += (int64_t) delta * (xQ8 - acc.meanQ8) - (int64_t) (decay / statWindow);
+  }
+}
+
+void statsClear(uint8_t channel) {
+  if (channel >= STAT_CHANNELS) return;
+  const STAT_REGS &regs = statRegs[channel];
+  memset(&statAcc[channel], 0, sizeof(STAT_ACC));
+  framWrite32(regs.min, 0);
+  framWrite32(regs.minTime, 0);
+  framWrite32(regs.max, 0);
+  framWrite32(regs.maxTime, 0);
+}
+
+void statsSelect(uint8_t channel) {
+  statSelected = (channel < STAT_CHANNELS) ? channel : STAT_PACK;
+}
+
+static uint16_t isqrt32(uint32_t x) {
+  uint32_t root = 0;
+  uint32_t bit  = 1UL << 30;
+  while (bit > x) bit >>= 2;
+  while (bit) {
+    if (x >= root + bit) {
+      x   -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint16_t) root;
+}
+
+int32_t statsRead(uint8_t reg) {
+  const STAT_ACC &acc = statAcc[statSelected];
+  switch (reg) {
+    case statSelectReg:
+      return statSelected;
+    case statMeanReg:
+      return (acc.meanQ8 + 0x80) >> 8;
+    case statDevReg: {
+      if (acc.count < 2) return 0;
+      uint64_t variance = (acc.m2Q16 / (acc.count - 1)) >> 16;      // milli-units squared
+      return isqrt32(variance > UINT32_MAX ? UINT32_MAX : (uint32_t) variance);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef pm_stats_h
+#define pm_stats_h
+
+#include <Arduino.h>
+
+// Running statistics for the voltage and temperature memories. loop() feeds
+// every converted frame through statsSample(), which updates min, max, mean
+// and variance in O(1) with a fixed-point Welford step and no sample history.
+// The extremes and their clockNow() timestamps live in RAM and are only written to
+// their FRAM registers when an extreme actually moves, so a steady pack costs
+// no FRAM traffic. Mean and variance are RAM only and start over at boot.
+//
+// Once statWindow samples are in the mean and variance stop growing their
+// weight and track the last few thousand samples instead. The remainders of
+// the divisions by statWindow are carried to the next sample, so a drift
+// smaller than one fixed-point step per sample still moves the mean.
+
+const uint16_t statWindow    = 4096;    // samples, about three minutes of frames
+const uint8_t  statSelectReg = 0x5C;    // channel served by the mean and deviation registers
+const uint8_t  statMeanReg   = 0x5D;
+const uint8_t  statDevReg    = 0x5E;
+
+enum STAT_CHANNEL : uint8_t {
+  STAT_PACK = 0,                        // pack voltage, mV
+  STAT_T0   = 1,                        // mdegC
+  STAT_T1   = 2,                        // mdegC
+  STAT_T2   = 3,                        // mdegC
+  STAT_CHANNELS
+};
+
+// FRAM registers of one channel's memories
+struct STAT_REGS {
+  uint8_t min;
+  uint8_t minTime;
+  uint8_t max;
+  uint8_t maxTime;
+};
+
+const STAT_REGS statRegs[STAT_CHANNELS] = {
+  { 0x3A, 0x3B, 0x3C, 0x3D },
+  { 0x42, 0x47, 0x43, 0x49 },
+  { 0x45, 0x48, 0x46, 0x4A },
+  { 0x4F, 0,    0x5F, 0    },           // T2, no free register left for its timestamps
+};
+
+void    statsBegin();                           // pick the extremes up from FRAM, call after journalRestore()
+void    statsSample(uint8_t channel, int32_t milli);
+void    statsClear(uint8_t channel);            // forget the extremes and the mean, zeroes the FRAM registers
+void    statsSelect(uint8_t channel);           // out of range selects STAT_PACK
+int32_t statsRead(uint8_t reg);                 // 0x5C to 0x5E for the register cache
+
+#endif
@@ -1,8 +1,11 @@
+#ifndef pm_struct_h
+#define pm_struct_h
+
 #include <Arduino.h>
 
 const uint8_t txBufferSize = 50;
 const uint8_t rxBufferSize = 50;
-const uint8_t adcBufferSize = 4;        // adc1 current, adc2 pack voltage, adc3 bus voltage, adc4 coulumb counter
+const uint8_t adcBufferSize = 7;        // current, bus voltage, pack voltage, NAU7802 precision current, T0, T1, T2
 
 struct I2C_RX_DATA {
   uint8_t cmdAddr               = 0;    // single byte command register
@@ -20,13 +23,10 @@ struct ADC_DATA {
   int32_t adcRaw   = 0;                 // raw value
   int32_t adcMin   = 0;                 // raw value
   int32_t adcMax   = 0;                 // raw value
-  double  Amps     = 0.0;               // formatted value
-  double  Volts    = 0.0;               // formatted value
+  int32_t milli    = 0;                 // calibrated value, mA, mV or mdegC
 };
 
-volatile I2C_RX_DATA rxData;
-volatile I2C_TX_DATA txData;
-volatile ADC_DATA    adcDataBuffer[adcBufferSize];  // Enough room to store three adc readings
+extern volatile ADC_DATA adcDataBuffer[adcBufferSize];  // converted readings, defined in main.cpp
 
 union ulongArray
 {
@@ -39,3 +39,5 @@ union floatArray
     float   floatNumber=0.0;
     uint8_t byteArray[4];
 };
+
+#endif
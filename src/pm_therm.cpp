@@ -0,0 +1,27 @@
+#include <Arduino.h>
+#include "pm_therm.h"
+
+// index sequence for building the table in one constant expression, C++11 has none of its own
+template <uint16_t... I> struct ThermSeq {};
+template <uint16_t N, uint16_t... I> struct ThermMakeSeq : ThermMakeSeq<N - 1, N - 1, I...> {};
+template <uint16_t... I> struct ThermMakeSeq<0, I...> { typedef ThermSeq<I...> type; };
+
+template <uint16_t... I>
+constexpr THERM_TABLE thermBuild(ThermSeq<I...>) {
+  return THERM_TABLE { { thermPoint(I)... } };
+}
+
+static constexpr THERM_TABLE thermTable PROGMEM = thermBuild(ThermMakeSeq<thermTableSize>::type());
+
+int32_t thermToMilli(uint16_t raw) {
+  if (raw > 1023) raw = 1023;
+  uint8_t idx  = raw >> thermSegShift;
+  int32_t frac = raw & ((1 << thermSegShift) - 1);
+  int32_t lo   = (int32_t) pgm_read_dword(&thermTable.mdeg[idx]);
+  int32_t hi   = (int32_t) pgm_read_dword(&thermTable.mdeg[idx + 1]);
+  return lo + (((hi - lo) * frac) >> thermSegShift);
+}
+
+bool thermInRange(uint16_t raw) {
+  return raw > 0 && raw < 1023;
+}
@@ -0,0 +1,62 @@
+#ifndef pm_therm_h
+#define pm_therm_h
+
+#include <Arduino.h>
+
+// NTC thermistor kernel. Each thermistor sits between its ADC pin and ground
+// with a fixed resistor up to the ADC reference, so the reading is ratiometric
+// and does not depend on vcc. The beta equation is evaluated at compile time
+// into a PROGMEM table of thermTableSize points spread evenly over the 10-bit
+// range, at runtime a reading costs one table lookup and a linear
+// interpolation between two neighbours, no floats or log().
+
+#ifndef THERM_BETA
+#define THERM_BETA 3950                 // NRL1504F3950B1F, B25/50
+#endif
+#ifndef THERM_R25_OHM
+#define THERM_R25_OHM 100000            // thermistor resistance at 25 degC, match the fitted part
+#endif
+#ifndef THERM_SERIES_OHM
+#define THERM_SERIES_OHM 50000          // divider resistor to the reference, TR1 to TR3 on the board
+#endif
+
+const uint8_t  thermSensors    = 3;     // T0, T1, T2
+const uint8_t  thermSegShift   = 4;     // 16 lsb between table points
+const uint8_t  thermTableSize  = (1024 >> thermSegShift) + 1;
+const int32_t  thermMinMdeg    = -40000;            // table is clamped to the thermistor's rated range
+const int32_t  thermMaxMdeg    = 125000;
+
+// compile-time natural log, atanh series on [0.5, 2] after pulling out powers of two
+constexpr double thermAtanh(double y2, double term, uint8_t n) {
+  return n > 41 ? 0 : term / n + thermAtanh(y2, term * y2, n + 2);
+}
+constexpr double thermLnNear1(double y) {
+  return 2 * thermAtanh(y * y, y, 1);
+}
+constexpr double thermLn(double x, int8_t k = 0) {
+  return x > 2 ? thermLn(x / 2, k + 1) : x < 0.5 ? thermLn(x * 2, k - 1)
+       : thermLnNear1((x - 1) / (x + 1)) + k * 0.69314718055994531;
+}
+
+// mdegC at a raw reading, the ends use half an lsb in from the rails where the divider has no solution
+constexpr int32_t thermClamp(double mdeg) {
+  return mdeg < thermMinMdeg ? thermMinMdeg : mdeg > thermMaxMdeg ? thermMaxMdeg : (int32_t) (mdeg + (mdeg < 0 ? -0.5 : 0.5));
+}
+constexpr int32_t thermPointAt(double raw) {
+  return thermClamp(1000.0 / (1.0 / 298.15 + thermLn((double) THERM_SERIES_OHM / THERM_R25_OHM * raw / (1024 - raw)) / THERM_BETA) - 273150.0);
+}
+constexpr int32_t thermPoint(uint16_t index) {
+  return thermPointAt(index == 0 ? 0.5 : (index << thermSegShift) >= 1024 ? 1023.5 : (double) (index << thermSegShift));
+}
+
+struct THERM_TABLE {
+  int32_t mdeg[thermTableSize];
+};
+
+static_assert(THERM_SERIES_OHM != THERM_R25_OHM || (thermPoint(thermTableSize / 2) > 24990 && thermPoint(thermTableSize / 2) < 25010),
+              "thermistor table does not put 25 degC at mid scale");
+
+int32_t thermToMilli(uint16_t raw);     // averaged raw reading to mdegC
+bool    thermInRange(uint16_t raw);     // false for an open or shorted thermistor
+
+#endif
@@ -0,0 +1,219 @@
+// The whole firmware on the native HAL: setup() and loop() against simulated
+// pins and an in-memory FRAM, the host side through receiveEvent() and
+// requestEvent() the way a master on the bus reaches them. The pack sits at
+// 13.2V inside the default limits, so a run starts in the normal state.
+//
+//   pio test -e native -f test_firmware
+
+#include <unity.h>
+#include "Arduino.h"
+#include "pm_pins.h"
+#include "pm_native_hal.h"
+#include "pm_native_devices.h"
+#include "pm_codec.h"
+#include "pm_snapshot.h"
+#include "pm_fram.h"
+
+void setup();
+void loop();
+
+static FramMock   framMem;
+static FramTarget framTarget(framMem);
+
+static const int packRestLsb = 610;             // 13.2V with the default 0.2 divider
+static const int packLowLsb  = 450;             // 9.7V, under the 10.8V default limit
+
+// the open-drain gate output: pulled low holds the pack on, released the board pull-up opens it
+static bool gateHeld() {
+  return nativePinMode(PACK_DISC) == OUTPUT && nativePinLevel(PACK_DISC) == LOW;
+}
+
+static bool gateReleased() {
+  return nativePinMode(PACK_DISC) == INPUT;
+}
+
+static void runFor(uint32_t ms) {
+  uint64_t end = nativeMicros() + (uint64_t) ms * 1000;
+  while (nativeMicros() < end) loop();
+}
+
+static void command(uint8_t reg, const char *data) {
+  uint8_t frame[32];
+  uint8_t len = strlen(data);
+  frame[0] = reg;
+  memcpy(frame + 1, data, len);
+  nativeMasterWrite(frame, len + 1);
+  runFor(10);                                   // loop() executes the queued command
+}
+
+static uint32_t readBinary(uint8_t reg, uint8_t len) {
+  uint8_t cmd      = reg | 0x80;
+  uint8_t reply[8] = {};
+  nativeMasterWrite(&cmd, 1);
+  nativeMasterRead(reply, len);
+  return (uint32_t) reply[0] | (uint32_t) reply[1] << 8 | (uint32_t) reply[2] << 16 | (uint32_t) reply[3] << 24;
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_pack_connected_at_rest() {
+  TEST_ASSERT_EQUAL_UINT8(0, readBinary(0x2D, 1));                  // status1, no fault, not disconnected
+  TEST_ASSERT_TRUE(gateHeld());
+  TEST_ASSERT_INT32_WITHIN(50, 13200, readBinary(0x39, 2));
+  TEST_ASSERT_INT32_WITHIN(100, 25000, (int32_t) readBinary(0x41, 4));   // 100K NTC against the 50K divider
+  TEST_ASSERT_EQUAL_UINT32(0, readBinary(0x51, 2) + readBinary(0x52, 2));
+}
+
+void test_snapshot_frame() {
+  uint8_t     cmd = snapshotRegister;
+  PM_SNAPSHOT frame;
+  nativeMasterWrite(&cmd, 1);
+  TEST_ASSERT_EQUAL(sizeof(frame), nativeMasterRead((uint8_t *) &frame, sizeof(frame)));
+  TEST_ASSERT_EQUAL_UINT8(snapshotVersion, frame.version);
+  TEST_ASSERT_EQUAL_UINT8(crc8((const uint8_t *) &frame, sizeof(frame) - 1), frame.crc);
+  TEST_ASSERT_TRUE(frame.seq > 0);
+  TEST_ASSERT_EQUAL_UINT8(0, frame.status1);
+}
+
+void test_ascii_reply() {
+  uint8_t cmd       = 0x39;
+  char    reply[32] = {};
+  nativeMasterWrite(&cmd, 1);
+  nativeMasterRead((uint8_t *) reply, sizeof(reply) - 1);
+  TEST_ASSERT_INT32_WITHIN(50, 13200, (int32_t) (atof(reply) * 1000));
+}
+
+void test_ascii_coulomb_counter_is_whole() {
+  framWrite32(0x31, (uint32_t) -100000);       // a 100Ah pack run flat
+  runFor(100);
+  uint8_t cmd       = 0x31;
+  char    reply[32] = {};
+  nativeMasterWrite(&cmd, 1);
+  nativeMasterRead((uint8_t *) reply, sizeof(reply) - 1);
+  TEST_ASSERT_INT32_WITHIN(10, -100000, atol(reply));
+  command(0x30, "");
+}
+
+void test_under_voltage_trips_and_clears() {
+  nativeAnalogSet(ADC2, packLowLsb);
+  runFor(1000);
+  TEST_ASSERT_EQUAL_HEX8(0x05, readBinary(0x2D, 1));                // under-voltage, disconnected
+  TEST_ASSERT_TRUE(gateReleased());
+  TEST_ASSERT_EQUAL_UINT8(2, readBinary(0x57, 1));
+  TEST_ASSERT_EQUAL_UINT32(1, readBinary(0x52, 2));
+
+  nativeAnalogSet(ADC2, packRestLsb);
+  runFor(1000);
+  TEST_ASSERT_EQUAL_UINT8(0, readBinary(0x2D, 1));
+  TEST_ASSERT_TRUE(gateHeld());
+}
+
+void test_limit_write() {
+  command(0x25, "9000");
+  TEST_ASSERT_EQUAL_UINT32(9000, readBinary(0x25, 2));
+  command(0x25, "10800");
+  TEST_ASSERT_EQUAL_UINT32(10800, readBinary(0x25, 2));
+}
+
+void test_bare_setter_keeps_the_setting() {
+  uint32_t limit  = readBinary(0x21, 2);
+  uint32_t config = readBinary(0x29, 1);
+  command(0x21, "");
+  command(0x26, "");
+  TEST_ASSERT_EQUAL_UINT32(limit, readBinary(0x21, 2));
+  TEST_ASSERT_EQUAL_UINT32(config, readBinary(0x29, 1));
+
+  nativeAnalogSet(ADC0, 450);                   // a 2A discharge, well under the limit
+  runFor(1000);
+  nativeAnalogSet(ADC0, 512);
+  TEST_ASSERT_EQUAL_UINT8(0, readBinary(0x2D, 1));
+  TEST_ASSERT_EQUAL_UINT32(0, readBinary(0x51, 2));
+}
+
+void test_limit_out_of_range_is_ignored() {
+  command(0x24, "5000");                        // below 9600
+  TEST_ASSERT_EQUAL_UINT32(14800, readBinary(0x24, 2));
+  command(0x25, "30000");                       // above 26000
+  TEST_ASSERT_EQUAL_UINT32(10800, readBinary(0x25, 2));
+  command(0x21, "70000");                       // does not fit 16 bits
+  TEST_ASSERT_EQUAL_UINT32(10000, readBinary(0x21, 2));
+  command(0x22, "hot");
+  TEST_ASSERT_EQUAL_UINT32(45000, readBinary(0x22, 2));
+}
+
+void test_bare_calibration_write_keeps_the_gain() {
+  command(0x5A, "123456");
+  command(0x5A, "");                            // what an ascii read of 0x5A sends
+  TEST_ASSERT_EQUAL_UINT32(123456, readBinary(0x5A, 4));
+  command(0x5A, "0");
+}
+
+void test_bare_precision_config_keeps_the_setting() {
+  command(0x4D, "\x23");                       // 80 SPS at x4
+  command(0x4D, "");
+  TEST_ASSERT_EQUAL_HEX8(0x23, readBinary(0x4D, 1));
+  framWrite32(0x4D, 0);                         // a 0 byte cannot go through command()
+}
+
+void test_bare_log_interval_keeps_the_interval() {
+  command(0x7A, "60");
+  command(0x7A, "");
+  TEST_ASSERT_EQUAL_UINT32(60, readBinary(0x7A, 2));
+  command(0x7A, "0");
+}
+
+void test_soc_leds_leave_the_gate_alone() {
+  uint8_t config  = readBinary(0x29, 1);
+  char    leds[2] = { (char) (config | 0x01), 0 };  // config0 bit 0, set in the 0x69 default too
+  command(0x26, leds);
+  runFor(2000);
+  TEST_ASSERT_TRUE(gateHeld());
+  TEST_ASSERT_EQUAL_UINT8(0, readBinary(0x2D, 1));
+}
+
+void test_charge_over_current_trips() {
+  uint32_t trips = readBinary(0x51, 2);
+  nativeAnalogSet(ADC0, 850);                   // about 11A of charge, over the 10A default
+  runFor(100);
+  TEST_ASSERT_TRUE(gateReleased());
+  TEST_ASSERT_EQUAL_HEX8(0x03, readBinary(0x2D, 1));                // over-current, disconnected
+  TEST_ASSERT_EQUAL_UINT32(trips + 1, readBinary(0x51, 2));
+
+  nativeAnalogSet(ADC0, 512);
+  runFor(11000);                                // the hold off ends and the pack reconnects
+  TEST_ASSERT_TRUE(gateHeld());
+  TEST_ASSERT_EQUAL_UINT8(0, readBinary(0x2D, 1));
+}
+
+int main(int argc, char **argv) {
+  nativeI2cAttach(framI2CAddr, &framTarget);
+  nativeAnalogSet(ADC0, 512);                   // no load
+  nativeAnalogSet(ADC1, 700);
+  nativeAnalogSet(ADC2, packRestLsb);
+  nativeAnalogSet(TEMP0, 683);                  // 25 degC
+  nativeAnalogSet(TEMP1, 683);
+  nativeAnalogSet(TEMP2, 683);
+  nativeSerialQuiet(true);
+  setup();
+  runFor(2000);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_pack_connected_at_rest);
+  RUN_TEST(test_snapshot_frame);
+  RUN_TEST(test_ascii_reply);
+  RUN_TEST(test_ascii_coulomb_counter_is_whole);
+  RUN_TEST(test_under_voltage_trips_and_clears);
+  RUN_TEST(test_limit_write);
+  RUN_TEST(test_bare_setter_keeps_the_setting);
+  RUN_TEST(test_limit_out_of_range_is_ignored);
+  RUN_TEST(test_bare_calibration_write_keeps_the_gain);
+  RUN_TEST(test_bare_precision_config_keeps_the_setting);
+  RUN_TEST(test_bare_log_interval_keeps_the_interval);
+  RUN_TEST(test_soc_leds_leave_the_gate_alone);
+  RUN_TEST(test_charge_over_current_trips);
+  return UNITY_END();
+}
@@ -0,0 +1,175 @@
+// pm_fram against the in-memory part: the register cache, dirty tracking,
+// batched write-back and when the layout header goes on.
+//
+//   pio test -e native -f test_fram
+
+#include <unity.h>
+#include "pm_fram.h"
+#include "pm_fram_mock.h"
+
+static FramMock mem;
+
+static uint16_t slotAddr(uint8_t reg) {
+  return framRegBase + (reg - framRegFirst) * framSlotSize;
+}
+
+static uint32_t partRead32(uint8_t reg) {
+  const uint8_t *src = &mem.mem[slotAddr(reg)];
+  return (uint32_t) src[0] | ((uint32_t) src[1] << 8) | ((uint32_t) src[2] << 16) | ((uint32_t) src[3] << 24);
+}
+
+static bool headerValid() {
+  return mem.mem[framHeaderAddr] == framMagic0 && mem.mem[framHeaderAddr + 1] == framMagic1
+         && mem.mem[framHeaderAddr + 2] == framVersion;
+}
+
+// a part that has been through a first boot, header and every slot written
+static void formatPart() {
+  framBegin(mem);
+  framFlush();
+  mem.writeCalls   = 0;
+  mem.bytesWritten = 0;
+}
+
+void setUp() {
+  mem = FramMock();                              // blank part
+}
+
+void tearDown() {
+}
+
+void test_blank_part_writes_nothing_at_begin() {
+  TEST_ASSERT_FALSE(framBegin(mem));
+  TEST_ASSERT_EQUAL_UINT32(0, mem.writeCalls);
+  TEST_ASSERT_FALSE(headerValid());
+  TEST_ASSERT_TRUE(framDirty());                 // every slot waits for the defaults
+}
+
+void test_header_follows_the_defaults() {
+  framBegin(mem);
+  framWrite32(0x21, 10000);
+  TEST_ASSERT_TRUE(framFlush());
+  TEST_ASSERT_TRUE(headerValid());
+  TEST_ASSERT_EQUAL_UINT32(10000, partRead32(0x21));
+  TEST_ASSERT_EQUAL_UINT32(2, mem.writeCalls);   // all slots as one run, then the header
+  TEST_ASSERT_FALSE(framDirty());
+}
+
+void test_power_cut_before_header_loads_defaults_again() {
+  for (int32_t budget = 0; budget <= framRegCount * framSlotSize + 4; budget++) {
+    mem = FramMock();
+    framBegin(mem);
+    framWrite32(0x21, 10000);
+    mem.writeBudget = budget;
+    bool flushed = framFlush();
+
+    mem.writeBudget = -1;                        // next boot
+    bool loaded = framBegin(mem);
+    if (flushed) TEST_ASSERT_TRUE(loaded);
+    if (loaded) TEST_ASSERT_EQUAL_UINT32(10000, framRead32(0x21));   // never a header over missing defaults
+  }
+}
+
+void test_failed_header_is_retried() {
+  framBegin(mem);
+  mem.writeBudget = framRegCount * framSlotSize;   // the slots land, the header does not
+  TEST_ASSERT_FALSE(framFlush());
+  TEST_ASSERT_FALSE(headerValid());
+  TEST_ASSERT_TRUE(framDirty());                 // the flush task comes back for it
+
+  mem.writeBudget = -1;
+  mem.writeCalls  = 0;
+  TEST_ASSERT_TRUE(framFlush());
+  TEST_ASSERT_TRUE(headerValid());
+  TEST_ASSERT_EQUAL_UINT32(1, mem.writeCalls);   // only the header, the slots were clean
+}
+
+void test_restore_from_part() {
+  formatPart();
+  framWrite32(0x24, 14800);
+  framWrite32(0x29, 0x69);
+  framFlush();
+
+  TEST_ASSERT_TRUE(framBegin(mem));
+  TEST_ASSERT_EQUAL_UINT32(14800, framRead32(0x24));
+  TEST_ASSERT_EQUAL_UINT32(0x69, framRead32(0x29));
+  TEST_ASSERT_FALSE(framDirty());
+}
+
+void test_unchanged_value_stays_clean() {
+  formatPart();
+  framWrite32(0x22, 45000);
+  framFlush();
+  mem.writeCalls = 0;
+
+  framWrite32(0x22, 45000);
+  TEST_ASSERT_FALSE(framDirty());
+  TEST_ASSERT_TRUE(framFlush());
+  TEST_ASSERT_EQUAL_UINT32(0, mem.writeCalls);
+}
+
+void test_adjacent_slots_share_a_write() {
+  formatPart();
+  framWrite32(0x34, 1);
+  framWrite32(0x35, 2);
+  framWrite32(0x36, 3);
+  TEST_ASSERT_TRUE(framFlush());
+  TEST_ASSERT_EQUAL_UINT32(1, mem.writeCalls);
+  TEST_ASSERT_EQUAL_UINT32(3 * framSlotSize, mem.bytesWritten);
+  TEST_ASSERT_EQUAL_UINT32(2, partRead32(0x35));
+}
+
+void test_separate_runs_write_separately() {
+  formatPart();
+  framWrite32(0x21, 1);
+  framWrite32(0x22, 2);
+  framWrite32(0x51, 3);
+  TEST_ASSERT_TRUE(framFlush());
+  TEST_ASSERT_EQUAL_UINT32(2, mem.writeCalls);
+  TEST_ASSERT_EQUAL_UINT32(3 * framSlotSize, mem.bytesWritten);
+}
+
+void test_failed_run_stays_dirty() {
+  formatPart();
+  framWrite32(0x21, 7);
+  mem.writeBudget = 2;                           // cut inside the slot
+  TEST_ASSERT_FALSE(framFlush());
+  TEST_ASSERT_TRUE(framDirty());
+
+  mem.writeBudget = -1;
+  TEST_ASSERT_TRUE(framFlush());
+  TEST_ASSERT_EQUAL_UINT32(7, partRead32(0x21));
+}
+
+void test_little_endian_slots() {
+  formatPart();
+  framWrite32(0x31, 0x11223344);
+  framFlush();
+  const uint8_t expect[4] = { 0x44, 0x33, 0x22, 0x11 };
+  TEST_ASSERT_EQUAL_MEMORY(expect, &mem.mem[slotAddr(0x31)], 4);
+}
+
+void test_registers_without_a_slot() {
+  formatPart();
+  framWrite32(framRegFirst - 1, 5);
+  framWrite32(framRegLast + 1, 5);
+  TEST_ASSERT_FALSE(framDirty());
+  TEST_ASSERT_EQUAL_UINT32(0, framRead32(framRegFirst - 1));
+  TEST_ASSERT_EQUAL_UINT32(0, framRead32(framRegLast + 1));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_blank_part_writes_nothing_at_begin);
+  RUN_TEST(test_header_follows_the_defaults);
+  RUN_TEST(test_power_cut_before_header_loads_defaults_again);
+  RUN_TEST(test_failed_header_is_retried);
+  RUN_TEST(test_restore_from_part);
+  RUN_TEST(test_unchanged_value_stays_clean);
+  RUN_TEST(test_adjacent_slots_share_a_write);
+  RUN_TEST(test_separate_runs_write_separately);
+  RUN_TEST(test_failed_run_stays_dirty);
+  RUN_TEST(test_little_endian_slots);
+  RUN_TEST(test_registers_without_a_slot);
+  return UNITY_END();
+}
@@ -0,0 +1,137 @@
+// pm_journal under simulated brown-outs: every commit is cut at every byte
+// offset of its record, on the first, second and third commit so both slots
+// are overwritten, and the restore has to come back with either the counters
+// before the commit or the ones it was writing, never a mix or zeros.
+//
+//   pio test -e native -f test_journal
+
+#include <unity.h>
+#include "pm_fram.h"
+#include "pm_fram_mock.h"
+#include "pm_journal.h"
+
+static FramMock mem;
+
+// distinct values per register and per commit, commit 0 is the blank part
+static uint32_t counterValue(uint8_t commit, uint8_t x) {
+  return commit ? commit * 1000 + x : 0;
+}
+
+static void setCounters(uint8_t commit) {
+  for (uint8_t x = 0; x < journalCount; x++) framWrite32(journalRegs[x], counterValue(commit, x));
+}
+
+static bool countersAre(uint8_t commit) {
+  for (uint8_t x = 0; x < journalCount; x++) {
+    if (framRead32(journalRegs[x]) != counterValue(commit, x)) return false;
+  }
+  return true;
+}
+
+// a reset: the register slots start from zero and the journal is read back
+static bool reboot() {
+  framBegin(mem);
+  setCounters(0);
+  return journalRestore(mem);
+}
+
+void setUp() {
+  mem = FramMock();
+  framBegin(mem);
+  framFlush();
+  journalRestore(mem);
+}
+
+void tearDown() {
+}
+
+void test_blank_part_restores_nothing() {
+  TEST_ASSERT_FALSE(reboot());
+  TEST_ASSERT_TRUE(countersAre(0));
+}
+
+void test_commit_and_restore() {
+  setCounters(1);
+  TEST_ASSERT_TRUE(journalCommit(mem));
+  TEST_ASSERT_TRUE(reboot());
+  TEST_ASSERT_TRUE(countersAre(1));
+}
+
+void test_unchanged_counters_write_nothing() {
+  setCounters(1);
+  journalCommit(mem);
+  mem.writeCalls = 0;
+  TEST_ASSERT_TRUE(journalCommit(mem));
+  TEST_ASSERT_EQUAL_UINT32(0, mem.writeCalls);
+}
+
+void test_commits_alternate_slots() {
+  setCounters(1);
+  journalCommit(mem);
+  uint8_t slotA[sizeof(JOURNAL_RECORD)];
+  memcpy(slotA, &mem.mem[framJournalA], sizeof(slotA));
+
+  setCounters(2);
+  journalCommit(mem);
+  TEST_ASSERT_EQUAL_MEMORY(slotA, &mem.mem[framJournalA], sizeof(slotA));   // second commit went to B
+  TEST_ASSERT_TRUE(reboot());
+  TEST_ASSERT_TRUE(countersAre(2));
+}
+
+void test_power_cut_at_every_byte() {
+  for (uint8_t cut = 1; cut <= 3; cut++) {            // the commit that loses power
+    for (int32_t budget = 0; budget <= (int32_t) sizeof(JOURNAL_RECORD); budget++) {
+      setUp();
+      for (uint8_t commit = 1; commit < cut; commit++) {
+        setCounters(commit);
+        TEST_ASSERT_TRUE(journalCommit(mem));
+      }
+
+      setCounters(cut);
+      mem.writeBudget = budget;
+      bool committed  = journalCommit(mem);
+      mem.writeBudget = -1;
+
+      bool restored = reboot();
+      char where[48];
+      snprintf(where, sizeof(where), "commit %u cut after %ld bytes", cut, (long) budget);
+      TEST_ASSERT_TRUE_MESSAGE(restored || cut == 1, where);
+      TEST_ASSERT_TRUE_MESSAGE(countersAre(cut - 1) || countersAre(cut), where);
+      if (committed) TEST_ASSERT_TRUE_MESSAGE(countersAre(cut), where);
+    }
+  }
+}
+
+void test_retry_after_power_cut() {
+  setCounters(1);
+  journalCommit(mem);
+  setCounters(2);
+  mem.writeBudget = sizeof(JOURNAL_RECORD) / 2;
+  TEST_ASSERT_FALSE(journalCommit(mem));
+  mem.writeBudget = -1;
+
+  TEST_ASSERT_TRUE(journalCommit(mem));             // same slot again, the good record stays
+  TEST_ASSERT_TRUE(reboot());
+  TEST_ASSERT_TRUE(countersAre(2));
+}
+
+void test_sequence_wraps() {
+  for (uint32_t commit = 1; commit <= 0x10002; commit++) {
+    framWrite32(journalRegs[0], commit);
+    TEST_ASSERT_TRUE(journalCommit(mem));
+  }
+  TEST_ASSERT_TRUE(reboot());
+  TEST_ASSERT_EQUAL_UINT32(0x10002, framRead32(journalRegs[0]));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_blank_part_restores_nothing);
+  RUN_TEST(test_commit_and_restore);
+  RUN_TEST(test_unchanged_counters_write_nothing);
+  RUN_TEST(test_commits_alternate_slots);
+  RUN_TEST(test_power_cut_at_every_byte);
+  RUN_TEST(test_retry_after_power_cut);
+  RUN_TEST(test_sequence_wraps);
+  return UNITY_END();
+}
@@ -0,0 +1,154 @@
+// pm_nau7802 against the register model in pm_nau7802_sim.h: detection,
+// the rate and gain bits, one burst read per DRDY and the sign extension of
+// the 24-bit result.
+//
+//   pio test -e native -f test_nau7802
+
+#include <unity.h>
+#include "pm_nau7802.h"
+#include "pm_nau7802_sim.h"
+#include "pm_native_hal.h"
+
+static const int8_t drdyPin = 6;
+
+static Nau7802Sim sim;
+
+// finish a conversion and raise DRDY on the pin the way the part would
+static void convert(int32_t counts) {
+  sim.convert(counts);
+  nativePinDrive(drdyPin, sim.drdy);
+}
+
+static int32_t pollOne() {
+  int32_t sample = 0;
+  TEST_ASSERT_TRUE(nauPoll(sample));
+  nativePinDrive(drdyPin, sim.drdy);            // the read dropped DRDY
+  return sample;
+}
+
+void setUp() {
+  sim = Nau7802Sim();
+  nativePinDrive(drdyPin, 0);
+}
+
+void tearDown() {
+}
+
+void test_absent_part() {
+  sim.present = false;
+  TEST_ASSERT_FALSE(nauBegin(sim, drdyPin, 0));
+  TEST_ASSERT_FALSE(nauPresent());
+  TEST_ASSERT_EQUAL_UINT32(0, sim.writeCalls);  // nothing written to a part that did not answer
+
+  int32_t sample;
+  TEST_ASSERT_FALSE(nauPoll(sample));
+  TEST_ASSERT_FALSE(nauConfigure(nauConfigDefault));
+}
+
+void test_wrong_revision() {
+  sim.regs[nauRegRevision] = 0x00;
+  TEST_ASSERT_FALSE(nauBegin(sim, drdyPin, 0));
+  TEST_ASSERT_FALSE(nauPresent());
+}
+
+void test_begin_powers_up_and_starts() {
+  TEST_ASSERT_TRUE(nauBegin(sim, drdyPin, 0));
+  TEST_ASSERT_TRUE(nauPresent());
+  TEST_ASSERT_TRUE(sim.running());
+  TEST_ASSERT_EQUAL_UINT8(nauConfigDefault, nauConfig());
+  TEST_ASSERT_EQUAL_UINT8(NAU_RATE_DEFAULT, sim.rateCode());
+  TEST_ASSERT_EQUAL_UINT8(NAU_GAIN_DEFAULT, sim.gainCode());
+  TEST_ASSERT_EQUAL_HEX8(nauLdo3v3, sim.regs[nauRegCtrl1] & 0x38);
+  TEST_ASSERT_EQUAL_HEX8(nauChopperOff, sim.regs[nauRegAdc]);
+}
+
+void test_configure_rate_and_gain() {
+  TEST_ASSERT_TRUE(nauBegin(sim, drdyPin, NAU_SPS_40 | (NAU_GAIN_16 << 4)));
+  TEST_ASSERT_EQUAL_UINT8(NAU_SPS_40, sim.rateCode());
+  TEST_ASSERT_EQUAL_UINT8(NAU_GAIN_16, sim.gainCode());
+
+  TEST_ASSERT_TRUE(nauConfigure(NAU_SPS_320 | (NAU_GAIN_1 << 4)));
+  TEST_ASSERT_EQUAL_UINT8(NAU_SPS_320, sim.rateCode());
+  TEST_ASSERT_EQUAL_UINT8(NAU_GAIN_1, sim.gainCode());
+  TEST_ASSERT_EQUAL_UINT8(NAU_SPS_320 | (NAU_GAIN_1 << 4), nauConfig());
+  TEST_ASSERT_EQUAL_HEX8(0, sim.regs[nauRegCtrl2] & nauCtrl2CALS);   // calibration ran and finished
+}
+
+void test_undefined_rate_is_refused() {
+  TEST_ASSERT_TRUE(nauBegin(sim, drdyPin, 0));
+  uint32_t writes = sim.writeCalls;
+  TEST_ASSERT_FALSE(nauConfigure(5 | (NAU_GAIN_2 << 4)));   // CRS 4 to 6 are not defined
+  TEST_ASSERT_EQUAL_UINT32(writes, sim.writeCalls);
+  TEST_ASSERT_EQUAL_UINT8(nauConfigDefault, nauConfig());
+  TEST_ASSERT_EQUAL_UINT8(NAU_GAIN_DEFAULT, sim.gainCode());
+}
+
+void test_no_bus_traffic_without_drdy() {
+  TEST_ASSERT_TRUE(nauBegin(sim, drdyPin, 0));
+  uint32_t reads = sim.readCalls;
+  int32_t  sample;
+  for (uint8_t x = 0; x < 10; x++) TEST_ASSERT_FALSE(nauPoll(sample));
+  TEST_ASSERT_EQUAL_UINT32(reads, sim.readCalls);
+}
+
+void test_one_burst_per_drdy() {
+  TEST_ASSERT_TRUE(nauBegin(sim, drdyPin, 0));
+  uint32_t reads   = sim.readCalls;
+  uint32_t samples = nauSampleCount();
+
+  convert(123456);
+  TEST_ASSERT_EQUAL_INT32(123456, pollOne());
+  TEST_ASSERT_EQUAL_UINT32(reads + 1, sim.readCalls);   // ADCO_B2..B0 in one transaction
+  TEST_ASSERT_FALSE(sim.drdy);                          // reading ADCO cleared CR and DRDY
+  TEST_ASSERT_EQUAL_HEX8(0, sim.regs[nauRegPuCtrl] & nauPuCR);
+
+  int32_t sample;
+  TEST_ASSERT_FALSE(nauPoll(sample));                   // nothing new, no read
+  TEST_ASSERT_EQUAL_UINT32(reads + 1, sim.readCalls);
+
+  convert(-42);
+  TEST_ASSERT_EQUAL_INT32(-42, pollOne());
+  TEST_ASSERT_EQUAL_UINT32(reads + 2, sim.readCalls);
+  TEST_ASSERT_EQUAL_UINT32(samples + 2, nauSampleCount());
+  TEST_ASSERT_EQUAL_UINT32(0, sim.overwritten);
+}
+
+void test_sign_extension() {
+  TEST_ASSERT_TRUE(nauBegin(sim, drdyPin, 0));
+  const int32_t counts[] = { 0, 1, -1, 0x7FFFFF, -0x800000, -651000, 0x400000, -0x400001 };
+  for (int32_t expect : counts) {
+    convert(expect);
+    TEST_ASSERT_EQUAL_INT32(expect, pollOne());
+  }
+}
+
+void test_polled_without_drdy_pin() {
+  TEST_ASSERT_TRUE(nauBegin(sim, -1, NAU_SPS_80 | (NAU_GAIN_128 << 4)));
+  nativeAdvance(10000);
+  sim.convert(-300000);
+  int32_t sample = 0;
+  TEST_ASSERT_TRUE(nauPoll(sample));
+  TEST_ASSERT_EQUAL_INT32(-300000, sample);
+
+  uint32_t reads = sim.readCalls;
+  sim.convert(5);
+  TEST_ASSERT_FALSE(nauPoll(sample));                   // CR is checked at most once per half period
+  TEST_ASSERT_EQUAL_UINT32(reads, sim.readCalls);
+  nativeAdvance(10000);
+  TEST_ASSERT_TRUE(nauPoll(sample));
+  TEST_ASSERT_EQUAL_INT32(5, sample);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_absent_part);
+  RUN_TEST(test_wrong_revision);
+  RUN_TEST(test_begin_powers_up_and_starts);
+  RUN_TEST(test_configure_rate_and_gain);
+  RUN_TEST(test_undefined_rate_is_refused);
+  RUN_TEST(test_no_bus_traffic_without_drdy);
+  RUN_TEST(test_one_burst_per_drdy);
+  RUN_TEST(test_sign_extension);
+  RUN_TEST(test_polled_without_drdy_pin);
+  return UNITY_END();
+}
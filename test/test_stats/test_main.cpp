@@ -0,0 +1,56 @@
+// pm_stats on its own: the Welford mean and deviation through a full window
+// and past it, where a slow drift has to keep moving the mean.
+//
+//   pio test -e native -f test_stats
+
+#include <unity.h>
+#include "pm_stats.h"
+
+static void feed(int32_t milli, uint32_t samples) {
+  while (samples--) statsSample(STAT_PACK, milli);
+}
+
+void setUp() {
+  statsClear(STAT_PACK);
+  statsSelect(STAT_PACK);
+}
+
+void tearDown() {
+}
+
+void test_mean_and_deviation() {
+  for (uint16_t n = 0; n < 1000; n++) statsSample(STAT_PACK, (n & 1) ? 13300 : 13100);
+  TEST_ASSERT_INT32_WITHIN(1, 13200, statsRead(statMeanReg));
+  TEST_ASSERT_INT32_WITHIN(1, 100, statsRead(statDevReg));
+}
+
+void test_steady_reading_has_no_deviation() {
+  feed(13200, 2 * statWindow);
+  TEST_ASSERT_EQUAL_INT32(13200, statsRead(statMeanReg));
+  TEST_ASSERT_EQUAL_INT32(0, statsRead(statDevReg));
+}
+
+void test_full_window_tracks_a_small_step() {
+  feed(13200, statWindow);
+  feed(13210, 8 * statWindow);                  // 10mV is under one statWindow step of the Q8 mean
+  TEST_ASSERT_INT32_WITHIN(1, 13210, statsRead(statMeanReg));
+}
+
+void test_full_window_tracks_a_slow_ramp() {
+  feed(13200, statWindow);
+  int32_t mv = 13200;
+  for (uint32_t n = 0; n < 16 * (uint32_t) statWindow; n++) {
+    if (!(n % 1024)) mv++;                      // 1mV every 1024 samples, 64mV in all
+    statsSample(STAT_PACK, mv);
+  }
+  TEST_ASSERT_INT32_WITHIN(6, mv, statsRead(statMeanReg));   // an average lags the ramp by a few mV
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_mean_and_deviation);
+  RUN_TEST(test_steady_reading_has_no_deviation);
+  RUN_TEST(test_full_window_tracks_a_small_step);
+  RUN_TEST(test_full_window_tracks_a_slow_ramp);
+  return UNITY_END();
+}